@@ -8,8 +8,17 @@
 *					Date:			01/09/2021																											*
 *************************************************************************************/
 
+#ifndef __MPF4279X_H__
+#define __MPF4279X_H__
+
+#include <stdint.h>
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
 #include "n32h47x_48x.h"
 #include "n32h47x_48x_i2c.h"
+#else
+/* Host builds (Tools/) only use the register layouts */
+typedef struct I2C_TypeDef I2C_TypeDef;
+#endif
 
 #define bool _Bool
 //MPF4279x Commands MAP
@@ -66,12 +75,12 @@ typedef struct __attribute__((packed)){
 	unsigned pchg_lim:  	1;
 }def_fg_intr;
 
-typedef __packed struct __attribute__((packed)){
+typedef struct __attribute__((packed)){
 
 	def_fg_intr		intr;
 
 	//	STATUS
-	def_fg_status	status;
+	uint8_t	status;	/* def_fg_status */
 
 	// 	SOC CELLS
 	unsigned char 	soc_abs_cells[SETMAX_NCELLS_SER];
@@ -81,7 +90,7 @@ typedef __packed struct __attribute__((packed)){
 	unsigned char	emty_id;
 	unsigned short 	emty_rtime;
 	signed short	emty_dT;
-	def_fg_lim		emty_lim;
+	uint8_t		emty_lim;	/* def_fg_lim */
 	
 	//	FULL
 	unsigned char	full_soc_cells[SETMAX_NCELLS_SER];
@@ -90,7 +99,7 @@ typedef __packed struct __attribute__((packed)){
 	unsigned short 	full_rtime_cc;
 	signed short	full_dT;
 	signed short	full_dT_cc;
-	def_fg_lim		full_lim;
+	uint8_t		full_lim;	/* def_fg_lim */
 
 	// 	SOC PACK
 	unsigned short	soc_pack;
@@ -102,67 +111,67 @@ typedef __packed struct __attribute__((packed)){
 
 	//	IDIS_AVG
 	unsigned short	idis_avg;
-	def_fg_lrn		idis_avg_lrn;
-	def_fg_rslt		idis_avg_rslt;
+	uint8_t		idis_avg_lrn;	/* def_fg_lrn */
+	uint8_t		idis_avg_rslt;	/* def_fg_rslt */
 
 	//	IDIS_END
 	unsigned short	idis_end;
-	def_fg_lrn		idis_end_lrn;
-	def_fg_rslt		idis_end_rslt;
+	uint8_t		idis_end_lrn;	/* def_fg_lrn */
+	uint8_t		idis_end_rslt;	/* def_fg_rslt */
 
 	//	ICHG_CC
 	unsigned short	ichg_cc;
-	def_fg_lrn		ichg_cc_lrn;
-	def_fg_rslt		ichg_cc_rslt;
+	uint8_t		ichg_cc_lrn;	/* def_fg_lrn */
+	uint8_t		ichg_cc_rslt;	/* def_fg_rslt */
 
 	//	ICHG_END
 	unsigned short	ichg_end;
-	def_fg_lrn		ichg_end_lrn;
-	def_fg_rslt		ichg_end_rslt;
+	uint8_t		ichg_end_lrn;	/* def_fg_lrn */
+	uint8_t		ichg_end_rslt;	/* def_fg_rslt */
 
 	//	VCHG_CV
 	unsigned short	vchg_cv;
-	def_fg_lrn		vchg_cv_lrn;
-	def_fg_rslt		vchg_cv_rslt;
+	uint8_t		vchg_cv_lrn;	/* def_fg_lrn */
+	uint8_t		vchg_cv_rslt;	/* def_fg_rslt */
 
 	//	ESR
 	float		 	soresr_dis_cells[SETMAX_NCELLS_SER];
 	float		 	soresr_chg_cells[SETMAX_NCELLS_SER];
-	def_fg_lrn		soresr_lrn_cells[SETMAX_NCELLS_SER];
-	def_fg_rslt		soresr_rslt_cells[SETMAX_NCELLS_SER];
+	uint8_t		soresr_lrn_cells[SETMAX_NCELLS_SER];	/* def_fg_lrn */
+	uint8_t		soresr_rslt_cells[SETMAX_NCELLS_SER];	/* def_fg_rslt */
 
 	// RCXN_CELLS
 	unsigned short 	rcxn_cells[SETMAX_NCELLS_SER];
-	def_fg_lrn		rcxn_lrn_cells[SETMAX_NCELLS_SER];
-	def_fg_rslt		rcxn_rslt_cells[SETMAX_NCELLS_SER];
+	uint8_t		rcxn_lrn_cells[SETMAX_NCELLS_SER];	/* def_fg_lrn */
+	uint8_t		rcxn_rslt_cells[SETMAX_NCELLS_SER];	/* def_fg_rslt */
 
 	// HCONV
 	unsigned short	hconv;
-	def_fg_lrn		hconv_lrn;
-	def_fg_rslt		hconv_rslt;
+	uint8_t		hconv_lrn;	/* def_fg_lrn */
+	uint8_t		hconv_rslt;	/* def_fg_rslt */
 
 	// SOH
-	unsigned long 	soh_pack;
-	unsigned long 	soh_cells[SETMAX_NCELLS_SER];
+	uint32_t 	soh_pack;
+	uint32_t 	soh_cells[SETMAX_NCELLS_SER];
 
 	// -------------------
 	// 		POWER
 	// -------------------
 
 	// POWER ESTIMATION
-	unsigned long	prdg;
-	unsigned long	pdis;
+	uint32_t	prdg;
+	uint32_t	pdis;
 	unsigned char	pdis_id;
-	def_fg_lim		pdis_lim;
-	unsigned long	pchg;
+	uint8_t		pdis_lim;	/* def_fg_lim */
+	uint32_t	pchg;
 	unsigned char	pchg_id;
-	def_fg_lim		pchg_lim;
+	uint8_t		pchg_lim;	/* def_fg_lim */
 
 	// WARNINGS
 	def_fg_OT		OT_warn;
 
 	// OTHER
-	unsigned long 	iteration;
+	uint32_t 	iteration;
 
 }def_fg_out;
 #define fg_out_size sizeof(def_fg_out)
@@ -224,13 +233,13 @@ typedef struct __attribute__((packed)){
 	unsigned char	emty_soc_cells[SETMAX_NCELLS_SER];
 	unsigned char	emty_id;
 	unsigned short 	emty_rtime;
-	def_fg_lim		emty_lim;
+	uint8_t		emty_lim;	/* def_fg_lim */
 
 	//	FULL
 	unsigned char	full_soc_cells[SETMAX_NCELLS_SER];
 	unsigned char	full_id;
 	unsigned short 	full_rtime;
-	def_fg_lim		full_lim;
+	uint8_t		full_lim;	/* def_fg_lim */
 
 	//	IDIS_AVG 
 	unsigned short	idis_avg;
@@ -254,21 +263,21 @@ typedef struct __attribute__((packed)){
 	unsigned char 	soc_abs_cells[SETMAX_NCELLS_SER];
 
 	// SOH
-	unsigned long 	soh_pack;
-	unsigned long 	soh_cells[SETMAX_NCELLS_SER];
+	uint32_t 	soh_pack;
+	uint32_t 	soh_cells[SETMAX_NCELLS_SER];
 
 	// POWER ESTIMATION
-	unsigned long	prdg;
-	unsigned long	pdis;
+	uint32_t	prdg;
+	uint32_t	pdis;
 	unsigned char	pdis_id;
-	def_fg_lim		pdis_lim;
-	unsigned long	pchg;
+	uint8_t		pdis_lim;	/* def_fg_lim */
+	uint32_t	pchg;
 	unsigned char	pchg_id;
-	def_fg_lim		pchg_lim;
+	uint8_t		pchg_lim;	/* def_fg_lim */
 
 	// OTHER (1 bytes)
-	def_fg_status	status;
-	unsigned long iteration;
+	uint8_t	status;	/* def_fg_status */
+	uint32_t iteration;
 }def_fg_out;
 #define fg_out_size sizeof(def_fg_out)
 
@@ -318,3 +327,5 @@ typedef struct __attribute__((packed)) //74		74
 uint8_t I2C_MPF4279x_Write(I2C_TypeDef* I2Cx, uint8_t Address, uint16_t Register, uint8_t *Data, uint8_t len, uint8_t Activate, uint8_t CRC_En);
 uint8_t I2C_MPF4279x_Read(I2C_TypeDef* I2Cx, uint8_t Address, uint16_t Register, uint8_t *Data, uint8_t len, uint8_t Activate, uint8_t CRC_En);
 uint8_t MPF4279x_to_Active_Mode(I2C_TypeDef* I2Cx, uint8_t Address, uint16_t Register, uint8_t len, uint8_t no_stop);
+
+#endif /* __MPF4279X_H__ */
@@ -8,14 +8,168 @@
 #include "mps_gpio.h"
 #include "mps_adc.h"
 #include "mps_hrpwm.h"
+#include "mps_sched.h"
+#include "mps_time.h"
+#include "mps_delay.h"
+#include "mps_sleep.h"
 #include <stdio.h>
 
-/* UART Echo Buffer and Variables */
-#define UART_BUFFER_SIZE 256  // Buffer size can be adjusted as needed
-uint8_t rxBuffer[UART_BUFFER_SIZE];  // Receive buffer
-volatile uint16_t rxCount = 0;       // Number of bytes received
-
 #define MPF11770_DEVICE_ADDR       (0x08 << 1) 
+
+/* Scheduler events */
+#define EVENT_UART_RX              (1u << 0)
+#define EVENT_UART_TX              (1u << 1)
+
+static sched_task_t uartTask;
+static sched_task_t adcTask;
+static sched_task_t statsTask;
+static volatile uint16_t voltage_mv;
+static volatile uint16_t cpuLoadPermille;
+static volatile uint16_t sleepPermille;
+static volatile uint16_t pwmSampleRaw;
+static volatile uint32_t dutyFloatCycles;
+static volatile uint32_t dutyQ16Cycles;
+static volatile uint32_t watchdogTrips;
+static volatile uint32_t watchdogMaxActionNs;    /* Interrupt entry to handler return */
+static volatile uint32_t watchdogTripNs;         /* Arm to handler, measured at start-up */
+static volatile uint32_t watchdogTestStart;
+static volatile uint32_t watchdogTestCycles;
+static uint16_t pwmSamples[2];
+static uint16_t guardSamples[256];
+
+/* Converted back to back, so the watchdog sees PA0 every conversion (~252 ADC clocks) */
+static const adc_scan_channel_t guardChannels[] = {
+  {ADC_CH_0, ADC_SAMP_TIME_CYCLES_239_5, GPIOA, GPIO_PIN_0},
+};
+
+/* Sampled by SHRTIM ADC trigger 1 in the middle of the Timer D on-time */
+static const adc_scan_channel_t pwmChannels[] = {
+  {ADC_CH_1, ADC_SAMP_TIME_CYCLES_7_5, GPIOA, GPIO_PIN_1},
+};
+
+/**
+ * @brief Echo received bytes, runs on new RX data and when TX space frees up
+ */
+static void uart_echo_task(void* ctx, uint32_t events)
+{
+  uint16_t rxCount;
+  const uint8_t* rxData;
+
+  (void)ctx;
+  (void)events;
+  rxData = uart_rx_peek(USART1, &rxCount);
+  if (rxCount > 0) {
+    /* Queue the received span on the transmit ring, the DMA interrupt sends it */
+    uart_rx_commit(USART1, uart_write(USART1, rxData, rxCount));
+  }
+}
+
+/**
+ * @brief PA0 out of range, cut the PWM before anything else runs
+ */
+static void pa0_protect(void* ctx, ADC_Module* ADCx, uint16_t raw)
+{
+  (void)ctx;
+  (void)ADCx;
+  (void)raw;
+  hrpwm_stop(SHRTIM1, HRPWM_TIMER_D);
+}
+
+/**
+ * @brief Start-up trip, stamps the time from arming to the handler
+ */
+static void watchdog_test_trip(void* ctx, ADC_Module* ADCx, uint16_t raw)
+{
+  (void)ctx;
+  (void)ADCx;
+  (void)raw;
+  watchdogTestCycles = time_cycles32() - watchdogTestStart;
+}
+
+/**
+ * @brief Measure the watchdog trip to action latency on the live PA0 scan
+ *
+ * Arms a window that excludes the present PA0 level, so the next completed
+ * conversion trips. The time from arming to the handler covers the
+ * conversion in progress, the interrupt entry and the dispatch, the worst
+ * case a real trip can see.
+ */
+static void watchdog_latency_test(void)
+{
+  time_deadline_t timeout;
+  uint16_t raw = guardSamples[0];
+
+  watchdogTestCycles = 0;
+  watchdogTestStart = time_cycles32();
+  adc_watchdog_init(ADC1, ADC_CH_0, NULL, (raw > 16) ? 0 : 4095, (raw > 16) ? 0 : 4095,
+                    watchdog_test_trip, NULL);
+  timeout = time_deadline_us(1000);
+  while (watchdogTestCycles == 0 && !time_expired(timeout));
+  adc_watchdog_disable(ADC1);
+  watchdogTripNs = (uint32_t)(((uint64_t)watchdogTestCycles * 1000 << 16) / time_cycles_per_us_q16());
+}
+
+/**
+ * @brief One PWM period's sample, the place for a control loop
+ */
+static void pwm_sample(void* ctx, const uint16_t* frames, uint16_t frameCount, uint8_t channels)
+{
+  (void)ctx;
+  (void)frameCount;
+  (void)channels;
+  pwmSampleRaw = frames[0];
+}
+
+/**
+ * @brief Cycles of one duty update through the float and the Q16 entry points
+ */
+static void hrpwm_duty_benchmark(void)
+{
+  uint32_t start;
+
+  start = time_cycles32();
+  hrpwm_set_duty(SHRTIM1, HRPWM_TIMER_D, 50.0f);
+  dutyFloatCycles = time_cycles32() - start;
+
+  start = time_cycles32();
+  hrpwm_set_duty_q16(SHRTIM1, HRPWM_TIMER_D, HRPWM_Q16(50));
+  dutyQ16Cycles = time_cycles32() - start;
+}
+
+/**
+ * @brief Periodic PA0 reading, the mean of the guard scan buffer
+ */
+static void adc_task(void* ctx, uint32_t events)
+{
+  uint32_t sum = 0;
+  int32_t mv;
+  uint16_t i;
+
+  (void)ctx;
+  (void)events;
+  for (i = 0; i < sizeof(guardSamples) / sizeof(guardSamples[0]); i++) {
+    sum += guardSamples[i];
+  }
+  mv = adc_scale_apply(adc_get_scale(ADC1), (uint16_t)(sum / (sizeof(guardSamples) / sizeof(guardSamples[0]))));
+  voltage_mv = (uint16_t)((mv < 0) ? 0 : mv);
+}
+
+/**
+ * @brief Close the CPU load and sleep windows once per period, copy the watchdog figures
+ */
+static void stats_task(void* ctx, uint32_t events)
+{
+  adc_watchdog_stats_t watchdog;
+
+  (void)ctx;
+  (void)events;
+  cpuLoadPermille = sched_cpu_load();
+  sleepPermille = sleep_idle_permille();
+  adc_get_watchdog_stats(ADC1, &watchdog);
+  watchdogTrips = watchdog.trips;
+  watchdogMaxActionNs = watchdog.maxActionNs;
+}
+
 /**
 *\*\name    main.
 *\*\fun     main function.
@@ -24,18 +178,33 @@ volatile uint16_t rxCount = 0;       // Number of bytes received
 **/
 int main(void)
 {
+  delay_init();
+  sleep_init(GTIM4);
   CTRL_GPIO_Init();
   LED_Init(LED1_PORT, LED1_PIN, LED1_CLOCK);
   i2c_master_init(I2C1, 100); // 100kHz
   uart_dma_interrupt_init(USART1);
+  uart_rx_dma_start(USART1, NULL);
   spi_master_init(SPI1);
   adc_init(ADC1,ADC_CH_0,GPIOA, GPIO_PIN_0,ADC_RESOLUTION_12BIT, false, ADC_SAMP_TIME_CYCLES_239_5);
+  adc_calibrate_vref(ADC1);
+  adc_scan_init(ADC1, guardChannels, 1, ADC_RESOLUTION_12BIT, true,
+                guardSamples, sizeof(guardSamples) / sizeof(guardSamples[0]), NULL, NULL);
+  adc_scan_start(ADC1);
 	
 	
 	// 0.测试HRPWM，PB14和PB15引脚输出互补PWM信号，频率，占空比，死区时间
 	configure_hrpwm_gpio();
-  hrpwm_init(SHRTIM1, HRPWM_TIMER_D, 100000, 50.0f, 200);
-	hrpwm_start(SHRTIM1, HRPWM_TIMER_D);  
+  if (hrpwm_init(SHRTIM1, HRPWM_TIMER_D, 100000, 50.0f, 200) == HRPWM_OK) {
+    hrpwm_start(SHRTIM1, HRPWM_TIMER_D);
+  }
+  hrpwm_duty_benchmark();
+  sleep_ms(1);                          // Let the guard scan fill its buffer
+  watchdog_latency_test();
+  adc_watchdog_init(ADC1, ADC_CH_0, adc_get_scale(ADC1), 0, 3000, pa0_protect, NULL);  // PA0 above 3.0V stops the PWM
+  hrpwm_adc_trigger(SHRTIM1, HRPWM_TIMER_D, HRPWM_ADC_TRIG_1, HRPWM_ADC_ON_CENTER);
+  adc_scan_init_triggered(ADC2, pwmChannels, 1, ADC_RESOLUTION_12BIT, ADC_EXT_TRIG_REG_CONV_SHRTIM_TRG1,
+                          pwmSamples, 2, pwm_sample, NULL);
 	
 	// 1.测试定时器，间隔设置时间后执行LED_Toggle函数
   timer_init(GTIM2, 500000, LED_Toggle);  
@@ -48,31 +217,19 @@ int main(void)
   write_pData[0] = 1;
   write_pData[1] = 1;
   int b=MPF11770_I2C_master_write(I2C1, MPF11770_DEVICE_ADDR, 0x0002, write_pData, 2, 1);
-  systick_delay_ms(2);
+  sleep_ms(2);
   int a=MPF11770_I2C_master_read(I2C1, MPF11770_DEVICE_ADDR, 0x0002, read_pData, 2, 1);
 
-  while (1)
-	{
-			
-				// 3.测试串口，收到串口数据后，回发，中断接收
-			if (rxCount > 0) {
-					/* Send data using DMA */
-					uart_dma_send_data(USART1, USART1_TX_DMA_CH, rxBuffer, rxCount);
-					
-					/* Wait for DMA transfer completion */
-					while (DMA_GetCurrDataCounter(USART1_TX_DMA_CH) != 0);
-					
-					/* Reset counter after sending */
-					rxCount = 0;
-			}
-			
-			// 4.测试ADC，PA0引脚连接你的测试电压 (0-3.3V)
-			uint16_t voltage_mv = adc_test_voltage_pa0();
-			systick_delay_ms(1000);
-			
-			
-			
-	}
-}
-
+  // 3.测试串口，收到串口数据后，回发，循环DMA接收
+  // 4.测试ADC，PA0引脚连接你的测试电压 (0-3.3V)，连续扫描供看门狗使用，每秒取平均一次
+  sched_init(GTIM3, 100);
+  sched_task_init(&uartTask, "uart", 1, uart_echo_task, NULL);
+  sched_task_init(&adcTask, "adc", 2, adc_task, NULL);
+  sched_task_init(&statsTask, "stats", 3, stats_task, NULL);
+  sched_bind(SCHED_SRC_UART1_RX, &uartTask, EVENT_UART_RX);
+  sched_bind(SCHED_SRC_UART1_TX, &uartTask, EVENT_UART_TX);
+  sched_task_periodic(&adcTask, 1000000, 10000);
+  sched_task_periodic(&statsTask, 1000000, 0);
 
+  sched_run();
+}
@@ -3,509 +3,726 @@
 #include "mps_crc.h"   /* For Calculate_CRC32 function */
 #include "delay.h"
 #include "n32h47x_48x_crc.h"  // Include header file for CRC hardware functions
-#include "mps_delay.h"  // Header file for systick_delay_ms function
+#include "mps_delay.h"  // Header file for delay_ms function
+#include "mps_sleep.h"  // Header file for sleep_ms function
 #include <stddef.h>    /* For NULL definition */
+#include <string.h>
 
 /* Define maximum data length */
 #define MAX_DATA_LENGTH 82  // Maximum data length supported by MPF11770
 
-/* Function declaration for GetTick */
-static uint32_t GetTick(void)
-{
-  /* Use systick timer to get current tick value */
-  return (uint32_t)SysTick->VAL;
-}
+/* ACKPOS bit in CTRL1, used for two-byte reception */
+#define I2C_CTRL1_ACKPOS_BIT  0x0400
+
+/* Active retry policy, defaults to a single attempt (legacy behaviour) */
+static mpf11770_retry_policy_t retryPolicy = {
+  0,      /* maxRetries */
+  100,    /* backoffUs */
+  10000,  /* maxBackoffUs */
+  true,   /* exponentialBackoff */
+  true,   /* retryOnCrc */
+  true,   /* retryOnNack */
+  true    /* retryOnTimeout */
+};
 
-/* Error codes */
-#define I2C_OK             0
+/* Per-device link quality statistics */
+static mpf11770_link_stats_t linkStats[MPF11770_MAX_DEVICES];
 
 /**
-* @brief Write data to an MPF11770 device via I2C with optional software CRC32
-* @param I2Cx - I2C interface to use
- * @param devAddr - 7-bit device address
- * @param regAddr - 16-bit register address
-* @param pData - pointer to data buffer
- * @param length - length of data to write (1-82 bytes as per spec)
- * @param enableCRC - set true to enable CRC32 calculation and verification
-* @return 0 if successful, error code otherwise
-*/
-int32_t MPF11770_I2C_master_write(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
-                         uint8_t* pData, uint8_t length, bool enableCRC)
+ * @brief Find (or allocate) the statistics slot of a device
+ * @return pointer to the slot, NULL if the table is full
+ */
+static mpf11770_link_stats_t* get_stats_slot(uint8_t devAddr, bool allocate)
 {
-  uint32_t crc32Value = 0;
   uint8_t i;
-  uint32_t I2CTimeout;
-  uint32_t crcData[2 + (MAX_DATA_LENGTH + 3) / 4]; // For reg addr, length, and data (aligned to 32-bit)
-
-  i2c_start(I2Cx, devAddr);
 
-  /* Send low byte of register address */
-  I2C_SendData(I2Cx, (uint8_t)(regAddr & 0xFF));
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
+  for (i = 0; i < MPF11770_MAX_DEVICES; i++)
   {
-    if ((I2CTimeout--) == 0)
+    if (linkStats[i].inUse && linkStats[i].devAddr == devAddr)
     {
-      return 0;
+      return &linkStats[i];
     }
   }
-
-  /* Send high byte of register address */
-  I2C_SendData(I2Cx, (uint8_t)(regAddr >> 8));
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
+  if (!allocate)
   {
-    if ((I2CTimeout--) == 0)
+    return NULL;
+  }
+  for (i = 0; i < MPF11770_MAX_DEVICES; i++)
+  {
+    if (!linkStats[i].inUse)
     {
-      return 0;
+      linkStats[i].inUse = true;
+      linkStats[i].devAddr = devAddr;
+      return &linkStats[i];
     }
   }
+  return NULL;
+}
 
-  /* Send length byte */
-  I2C_SendData(I2Cx, length);
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
+/**
+ * @brief Account one finished transfer (including all of its retries)
+ */
+static void update_stats(uint8_t devAddr, const mpf11770_status_t* status, uint64_t startCycles)
+{
+  mpf11770_link_stats_t* stats = get_stats_slot(devAddr, true);
+  uint32_t latencyUs;
+  uint8_t bucket = 0;
+
+  if (stats == NULL)
   {
-    if ((I2CTimeout--) == 0)
-    {
-      return 0;
-    }
+    return;
   }
 
-  /* Send data bytes */
-  for (i = 0; i < length; i++)
+  latencyUs = (uint32_t)time_cycles_to_us(time_now_cycles() - startCycles);
+  while ((bucket < (MPF11770_LATENCY_BUCKETS - 1)) && ((latencyUs >> (bucket + 1)) != 0))
   {
-    /* Send data byte */
-    I2C_SendData(I2Cx, pData[i]);
-    
-    /* Wait for EV8: data byte sent */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-    {
-    if ((I2CTimeout--) == 0)
-    {
-      return 0;
-    }
-    }
+    bucket++;
   }
-  
-  /* Wait for EV8-2: last data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDED))
+
+  stats->transfers++;
+  stats->retries += (status->attempts > 0) ? (status->attempts - 1) : 0;
+  stats->latencyHist[bucket]++;
+  if (latencyUs > stats->latencyMaxUs)
   {
-    if ((I2CTimeout--) == 0)
-    {
-      return 0;
-    }
+    stats->latencyMaxUs = latencyUs;
   }
-  
-  /* If CRC is not needed, generate STOP condition */
-  if (!enableCRC)
+  if (status->error == MPF11770_OK)
   {
-    /* Generate STOP condition */
-    I2C_GenerateStop(I2Cx, ENABLE);
+    stats->successes++;
   }
-  /* If CRC is needed, calculate and send CRC32 */
   else
   {
-    /* Calculate CRC32 using hardware */
-    //   crc32Value = Calculate_CRC32_HW(regAddr, length, pData);
-    
-    /* Calculate CRC32 using software */
-    crc32Value = Calculate_CRC32(regAddr, length, pData);
-    
-    /* Send CRC bytes (little-endian) */
-    I2C_SendData(I2Cx, (uint8_t)(crc32Value & 0xFF));
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-    {
-        if ((I2CTimeout--) == 0) 
-        {
-        
-          return 0;
-        }
-    }
-    
-    I2C_SendData(I2Cx, (uint8_t)((crc32Value >> 8) & 0xFF));
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-    {
-        if ((I2CTimeout--) == 0) 
-        {
-        
-          return 0;
-        }
-    }
-    
-    I2C_SendData(I2Cx, (uint8_t)((crc32Value >> 16) & 0xFF));
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-    {
-        if ((I2CTimeout--) == 0) 
-        {
-        
-          return 0;
-        }
-    }
-    
-    I2C_SendData(I2Cx, (uint8_t)((crc32Value >> 24) & 0xFF));
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-    {
-        if ((I2CTimeout--) == 0) 
-        {
-        
-          return 0;
-    }
+    stats->failures++;
   }
+}
 
-  /* Wait for EV8-2: last data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDED))
-  {
-    if ((I2CTimeout--) == 0)
-    {
-        
-          return 0;
-    }
-  }
+/**
+ * @brief Count a failed attempt by error type
+ */
+static void count_attempt_error(uint8_t devAddr, mpf11770_error_t error)
+{
+  mpf11770_link_stats_t* stats = get_stats_slot(devAddr, true);
 
-    /* Generate STOP condition after CRC */
-  I2C_GenerateStop(I2Cx, ENABLE);
+  if (stats == NULL)
+  {
+    return;
   }
-  
-  /* Wait until I2C bus is free */
-  I2CTimeout = I2C_TIMEOUT_STOP_FLAG;
-  while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY))
+  switch (error)
   {
-    if ((I2CTimeout--) == 0)
-    {
-      return 0;
-    }
+    case MPF11770_ERR_CRC:      stats->crcErrors++; break;
+    case MPF11770_ERR_NACK:     stats->nacks++;     break;
+    case MPF11770_ERR_TIMEOUT:  stats->timeouts++;  break;
+    case MPF11770_ERR_BUS_BUSY: stats->busBusy++;   break;
+    default: break;
   }
-
-  return 1;
 }
 
 /**
-* @brief Read data from an MPF11770 device via I2C with optional CRC32
-* @param I2Cx - I2C interface to use
- * @param devAddr - 7-bit device address
- * @param regAddr - 16-bit register address
-* @param pData - pointer to data buffer for read data
-* @param length - length of data to read (1-82 bytes as per spec)
- * @param enableCRC - set true to enable CRC32 calculation and verification
-* @return 0 if successful, error code otherwise
-*/
-int32_t MPF11770_I2C_master_read(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
-                       uint8_t* pData, uint8_t length, bool enableCRC)
+ * @brief Wait for an I2C event, detecting NACK and timeout
+ * @param event: I2C_EVT_* event to wait for
+ * @param status: updated with the awaited event on failure
+ */
+static mpf11770_error_t wait_event(I2C_Module* I2Cx, uint32_t event, mpf11770_status_t* status)
 {
-  uint32_t receivedCRC = 0;
-  uint32_t calculatedCRC = 0;
-  uint8_t i;
-  uint32_t I2CTimeout;
-  
-  i2c_start(I2Cx, devAddr);
-  
-  /* Send low byte of register address */
-  I2C_SendData(I2Cx, (uint8_t)(regAddr & 0xFF));
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
+  time_deadline_t I2CTimeout = time_deadline_us(I2C_TIMEOUT_FLAG);
+
+  while (!I2C_CheckEvent(I2Cx, event))
   {
-    if ((I2CTimeout--) == 0) 
+    if (I2C_GetFlag(I2Cx, I2C_FLAG_ACKFAIL))
     {
-      return 0;
+      I2C_ClrFlag(I2Cx, I2C_FLAG_ACKFAIL);
+      status->event = event;
+      return MPF11770_ERR_NACK;
     }
-  }
-  
-  /* Send high byte of register address */
-  I2C_SendData(I2Cx, (uint8_t)(regAddr >> 8));
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
-  {
-    if ((I2CTimeout--) == 0) 
+    if (time_expired(I2CTimeout))
     {
-      return 0;
+      status->event = event;
+      return MPF11770_ERR_TIMEOUT;
     }
   }
-  
-  /* Send length byte */
-  I2C_SendData(I2Cx, length);
-  
-  /* Wait for EV8: data byte sent */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Wait for a single I2C status flag to become set
+ */
+static mpf11770_error_t wait_flag(I2C_Module* I2Cx, uint32_t flag, mpf11770_status_t* status)
+{
+  time_deadline_t I2CTimeout = time_deadline_us(I2C_TIMEOUT_FLAG);
+
+  while (!I2C_GetFlag(I2Cx, flag))
   {
-    if ((I2CTimeout--) == 0) 
+    if (time_expired(I2CTimeout))
     {
-      return 0;
+      status->event = flag;
+      return MPF11770_ERR_TIMEOUT;
     }
   }
-  
-  /* Wait for EV8-2: master send data end */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDED))
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Send one byte and wait until it has left the data register
+ */
+static mpf11770_error_t send_byte(I2C_Module* I2Cx, uint8_t data, mpf11770_status_t* status)
+{
+  I2C_SendData(I2Cx, data);
+  return wait_event(I2Cx, I2C_EVT_MASTER_DATA_SENDING, status);
+}
+
+/**
+ * @brief Release the bus after a failed transfer
+ *
+ * Every error path ends here so a frame never leaves the bus without a STOP
+ * and the ACK/ACKPOS configuration is restored for the next transfer.
+ */
+static void abort_transfer(I2C_Module* I2Cx)
+{
+  time_deadline_t I2CTimeout = time_deadline_us(I2C_TIMEOUT_STOP_FLAG);
+
+  I2C_GenerateStop(I2Cx, ENABLE);
+  I2Cx->CTRL1 &= ~I2C_CTRL1_ACKPOS_BIT;
+  I2C_ConfigAck(I2Cx, ENABLE);
+  I2C_ClrFlag(I2Cx, I2C_FLAG_ACKFAIL);
+
+  while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY) && !time_expired(I2CTimeout))
   {
-    if ((I2CTimeout--) == 0) 
+  }
+}
+
+/**
+ * @brief START, device address (write), register address and length
+ */
+static mpf11770_error_t send_header(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                    uint8_t length, mpf11770_status_t* status)
+{
+  mpf11770_error_t err;
+  time_deadline_t I2CTimeout;
+
+  /* Wait until I2C bus is not busy */
+  status->phase = MPF11770_PHASE_START;
+  I2CTimeout = time_deadline_us(I2C_TIMEOUT_BUSY_FLAG);
+  while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY))
+  {
+    if (time_expired(I2CTimeout))
     {
-      return 0;
+      status->event = I2C_FLAG_BUSY;
+      return MPF11770_ERR_BUS_BUSY;
     }
   }
-  
-  /* ---- Phase 2: Restart and read data ---- */
-  
-  /* Generate repeated START condition */
+
+  /* Generate START condition and wait for EV5 */
   I2C_GenerateStart(I2Cx, ENABLE);
-  
-  /* Wait for EV5: START transmitted */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_MODE_FLAG))
+  err = wait_event(I2Cx, I2C_EVT_MASTER_MODE_FLAG, status);
+  if (err != MPF11770_OK) return err;
+
+  /* Send slave address (write) and wait for EV6 */
+  I2C_SendAddr7bit(I2Cx, devAddr, I2C_DIRECTION_SEND);
+  err = wait_event(I2Cx, I2C_EVT_MASTER_TXMODE_FLAG, status);
+  if (err != MPF11770_OK) return err;
+
+  /* Register address, low byte first */
+  status->phase = MPF11770_PHASE_REG_ADDR;
+  err = send_byte(I2Cx, (uint8_t)(regAddr & 0xFF), status);
+  if (err != MPF11770_OK) return err;
+  err = send_byte(I2Cx, (uint8_t)(regAddr >> 8), status);
+  if (err != MPF11770_OK) return err;
+
+  /* Length byte */
+  status->phase = MPF11770_PHASE_LENGTH;
+  return send_byte(I2Cx, length, status);
+}
+
+/**
+ * @brief Single write attempt, see MPF11770_I2C_master_write_ex
+ */
+static mpf11770_error_t write_once(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                   uint8_t* pData, uint8_t length, bool enableCRC,
+                                   mpf11770_status_t* status)
+{
+  mpf11770_error_t err;
+  uint32_t crc32Value;
+  uint8_t i;
+
+  err = send_header(I2Cx, devAddr, regAddr, length, status);
+  if (err != MPF11770_OK) return err;
+
+  /* Send data bytes */
+  status->phase = MPF11770_PHASE_DATA;
+  for (i = 0; i < length; i++)
   {
-    if ((I2CTimeout--) == 0) 
-    {
-      return 0;
-    }
+    status->byteIndex = i;
+    err = send_byte(I2Cx, pData[i], status);
+    if (err != MPF11770_OK) return err;
   }
-  
-  /* Send slave address (read) */
-  I2C_SendAddr7bit(I2Cx, devAddr, I2C_DIRECTION_RECV);
-  
-  /* Wait for EV6: address sent, ACK received */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
-  while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_RXMODE_FLAG))
+
+  /* If CRC is needed, calculate and send CRC32 (little-endian) */
+  if (enableCRC)
   {
-    if ((I2CTimeout--) == 0) 
+    status->phase = MPF11770_PHASE_CRC;
+    crc32Value = Calculate_CRC32(regAddr, length, pData);
+    status->calculatedCRC = crc32Value;
+    for (i = 0; i < CRC32_LENGTH; i++)
     {
-      return 0;
+      status->byteIndex = i;
+      err = send_byte(I2Cx, (uint8_t)(crc32Value >> (8 * i)), status);
+      if (err != MPF11770_OK) return err;
     }
   }
-  
-  /* Use different strategies based on receive length */
+
+  /* Wait for EV8-2: last byte shifted out */
+  err = wait_event(I2Cx, I2C_EVT_MASTER_DATA_SENDED, status);
+  if (err != MPF11770_OK) return err;
+
+  /* Generate STOP only, run_transfer then waits for the bus to go idle (wait_bus_free) */
+  status->phase = MPF11770_PHASE_STOP;
+  I2C_GenerateStop(I2Cx, ENABLE);
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Receive the payload using the 1/2/N-byte reception sequences
+ * @param lastIsFinal: true if the payload ends the frame (no CRC follows)
+ */
+static mpf11770_error_t receive_payload(I2C_Module* I2Cx, uint8_t* pData, uint8_t length,
+                                        bool lastIsFinal, mpf11770_status_t* status)
+{
+  mpf11770_error_t err;
+  uint8_t remaining = length;
+  uint8_t i = 0;
+
+  status->phase = MPF11770_PHASE_DATA;
+
   if (length == 1)
   {
     /* For single byte reception, disable ACK if CRC is not needed */
-    if (!enableCRC)
+    if (lastIsFinal)
     {
-    I2C_ConfigAck(I2Cx, DISABLE);
-    I2C_GenerateStop(I2Cx, ENABLE);
+      I2C_ConfigAck(I2Cx, DISABLE);
+      I2C_GenerateStop(I2Cx, ENABLE);
     }
-    
+
     /* Clear ADDR flag */
     (void)(I2Cx->STS1);
     (void)(I2Cx->STS2);
-    
-    /* Wait for data reception */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_GetFlag(I2Cx, I2C_FLAG_RXDATNE))
-    {
-    if ((I2CTimeout--) == 0) 
-    {
-      return 0;
-    }
-    }
-    
-    /* Read data byte */
+
+    err = wait_flag(I2Cx, I2C_FLAG_RXDATNE, status);
+    if (err != MPF11770_OK) return err;
     pData[0] = I2C_RecvData(I2Cx);
   }
   else if (length == 2)
   {
-    /* Implement two-byte reception exactly as in the reference code */
     /* Set ACKPOS bit */
-    I2Cx->CTRL1 |= 0x0400;
-    
+    I2Cx->CTRL1 |= I2C_CTRL1_ACKPOS_BIT;
+
     /* Clear ADDR flag */
     (void)(I2Cx->STS1);
     (void)(I2Cx->STS2);
-    
-    /* Disable ACK if CRC is not needed */
-    if (!enableCRC)
-    {
-    I2C_ConfigAck(I2Cx, DISABLE);
-    I2C_GenerateStop(I2Cx, ENABLE);
-    }
-    
-    /* Wait for BTF flag - indicates both bytes have been received */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_GetFlag(I2Cx, I2C_FLAG_BSF))
-    {
-    if ((I2CTimeout--) == 0)
+
+    if (lastIsFinal)
     {
-      return 0;
-    }
+      I2C_ConfigAck(I2Cx, DISABLE);
+      I2C_GenerateStop(I2Cx, ENABLE);
     }
-    
-    /* Read first byte */
+
+    /* Wait for BTF flag - both bytes have been received */
+    err = wait_flag(I2Cx, I2C_FLAG_BSF, status);
+    if (err != MPF11770_OK) return err;
     pData[0] = I2C_RecvData(I2Cx);
-    
-    /* Read second byte */
     pData[1] = I2C_RecvData(I2Cx);
+    I2Cx->CTRL1 &= ~I2C_CTRL1_ACKPOS_BIT;
   }
   else
   {
     /* For multi-byte reception, enable ACK first */
     I2C_ConfigAck(I2Cx, ENABLE);
-    
+
     /* Clear ADDR flag */
     (void)(I2Cx->STS1);
     (void)(I2Cx->STS2);
-    
-    /* Receive data */
-    i = 0;
-    while (length)
-    {
-    /* Special handling for the last 3 bytes */
-    if (length == 3)
+
+    while (remaining)
     {
-      /* Wait for BTF flag - first byte received and moved to shift register */
-      I2CTimeout = I2C_TIMEOUT_FLAG;
-      while (!I2C_GetFlag(I2Cx, I2C_FLAG_BSF))
+      status->byteIndex = i;
+
+      /* Special handling for the last 3 bytes */
+      if (remaining == 3)
       {
-        if ((I2CTimeout--) == 0)
+        err = wait_flag(I2Cx, I2C_FLAG_BSF, status);
+        if (err != MPF11770_OK) return err;
+
+        if (lastIsFinal)
         {
-        return 0;
+          I2C_ConfigAck(I2Cx, DISABLE);
+          I2C_GenerateStop(I2Cx, ENABLE);
         }
+        pData[i++] = I2C_RecvData(I2Cx);
+
+        err = wait_flag(I2Cx, I2C_FLAG_BSF, status);
+        if (err != MPF11770_OK) return err;
+        pData[i++] = I2C_RecvData(I2Cx);
+        pData[i++] = I2C_RecvData(I2Cx);
+        remaining = 0;
       }
-      
-      /* Disable ACK if CRC is not needed */
-      if (!enableCRC)
-      {
-        I2C_ConfigAck(I2Cx, DISABLE);
-        I2C_GenerateStop(I2Cx, ENABLE);
-      }
-      
-      /* Read first byte */
-      pData[i++] = I2C_RecvData(I2Cx);
-      length--;
-      
-      /* Wait for BTF flag - second byte received */
-      I2CTimeout = I2C_TIMEOUT_FLAG;
-      while (!I2C_GetFlag(I2Cx, I2C_FLAG_BSF))
+      else /* Normal byte reception */
       {
-        if ((I2CTimeout--) == 0)
-        {
-        return 0;
-        }
+        err = wait_event(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG, status);
+        if (err != MPF11770_OK) return err;
+        pData[i++] = I2C_RecvData(I2Cx);
+        remaining--;
       }
-      
-      /* Read second byte */
-      pData[i++] = I2C_RecvData(I2Cx);
-      length--;
-      
-      /* Read third byte */
-      pData[i++] = I2C_RecvData(I2Cx);
-      length--;
-      
-      break;
     }
-    else /* Normal byte reception */
+  }
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Single read attempt, see MPF11770_I2C_master_read_ex
+ */
+static mpf11770_error_t read_once(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                  uint8_t* pData, uint8_t length, bool enableCRC,
+                                  mpf11770_status_t* status)
+{
+  mpf11770_error_t err;
+  uint32_t receivedCRC = 0;
+  uint8_t i;
+
+  err = send_header(I2Cx, devAddr, regAddr, length, status);
+  if (err != MPF11770_OK) return err;
+
+  /* Wait for EV8-2: master send data end */
+  err = wait_event(I2Cx, I2C_EVT_MASTER_DATA_SENDED, status);
+  if (err != MPF11770_OK) return err;
+
+  /* ---- Phase 2: Restart and read data ---- */
+  status->phase = MPF11770_PHASE_RESTART;
+  I2C_GenerateStart(I2Cx, ENABLE);
+  err = wait_event(I2Cx, I2C_EVT_MASTER_MODE_FLAG, status);
+  if (err != MPF11770_OK) return err;
+
+  I2C_SendAddr7bit(I2Cx, devAddr, I2C_DIRECTION_RECV);
+  err = wait_event(I2Cx, I2C_EVT_MASTER_RXMODE_FLAG, status);
+  if (err != MPF11770_OK) return err;
+
+  err = receive_payload(I2Cx, pData, length, !enableCRC, status);
+  if (err != MPF11770_OK) return err;
+
+  /* If CRC is enabled, read and verify CRC32 (LSB first) */
+  if (enableCRC)
+  {
+    status->phase = MPF11770_PHASE_CRC;
+    I2C_ConfigAck(I2Cx, ENABLE);
+
+    for (i = 0; i < CRC32_LENGTH; i++)
     {
-      /* Wait for data reception */
-      I2CTimeout = I2C_TIMEOUT_FLAG;
-      while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG))
+      status->byteIndex = i;
+      if (i == CRC32_LENGTH - 1)
       {
-        if ((I2CTimeout--) == 0)
-        {
-        return 0;
-        }
+        /* Last CRC byte: NACK it and generate STOP */
+        I2C_ConfigAck(I2Cx, DISABLE);
+        I2C_GenerateStop(I2Cx, ENABLE);
       }
-      
-      /* Read data byte */
-      pData[i++] = I2C_RecvData(I2Cx);
-      length--;
+      err = wait_event(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG, status);
+      if (err != MPF11770_OK) return err;
+      receivedCRC |= (uint32_t)I2C_RecvData(I2Cx) << (8 * i);
     }
+
+    status->receivedCRC = receivedCRC;
+    status->calculatedCRC = Calculate_CRC32(regAddr, length, pData);
+    if (receivedCRC != status->calculatedCRC)
+    {
+      return MPF11770_ERR_CRC;
     }
   }
-  
-  /* If CRC is enabled, read and verify CRC32 */
-  if (enableCRC)
+
+  status->phase = MPF11770_PHASE_STOP;
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Wait for the STOP to complete and the bus to become idle
+ */
+static mpf11770_error_t wait_bus_free(I2C_Module* I2Cx, mpf11770_status_t* status)
+{
+  time_deadline_t I2CTimeout = time_deadline_us(I2C_TIMEOUT_STOP_FLAG);
+
+  while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY))
   {
-    /* Ensure ACK is enabled to receive CRC bytes */
-    I2C_ConfigAck(I2Cx, ENABLE);
-    
-    /* Receive 4 CRC bytes */
-    receivedCRC = 0;
-    
-    /* First CRC byte (LSB) */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG))
+    if (time_expired(I2CTimeout))
     {
-    if ((I2CTimeout--) == 0) 
-    {
-      return 0;
-    }
+      status->event = I2C_FLAG_BUSY;
+      return MPF11770_ERR_TIMEOUT;
     }
-    receivedCRC = I2C_RecvData(I2Cx);
-    
-    /* Second CRC byte */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG))
-    {
-    if ((I2CTimeout--) == 0)
+  }
+  /* Leave the peripheral ready for the next transfer */
+  I2C_ConfigAck(I2Cx, ENABLE);
+  return MPF11770_OK;
+}
+
+/**
+ * @brief Check whether the retry policy allows another attempt for this error
+ */
+static bool should_retry(mpf11770_error_t err, uint8_t attempts)
+{
+  if (attempts > retryPolicy.maxRetries)
+  {
+    return false;
+  }
+  switch (err)
+  {
+    case MPF11770_ERR_CRC:      return retryPolicy.retryOnCrc;
+    case MPF11770_ERR_NACK:     return retryPolicy.retryOnNack;
+    case MPF11770_ERR_TIMEOUT:
+    case MPF11770_ERR_BUS_BUSY: return retryPolicy.retryOnTimeout;
+    default:                    return false;
+  }
+}
+
+/**
+ * @brief Run one transfer with retries, backoff and statistics
+ */
+static mpf11770_error_t run_transfer(bool isRead, I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                     uint8_t* pData, uint8_t length, bool enableCRC,
+                                     mpf11770_status_t* status)
+{
+  uint64_t startCycles = time_now_cycles();
+  uint32_t backoffUs = retryPolicy.backoffUs;
+  mpf11770_error_t err;
+
+  status->attempts = 0;
+  status->receivedCRC = 0;
+  status->calculatedCRC = 0;
+
+  if (pData == NULL || length == 0 || length > MAX_DATA_LENGTH)
+  {
+    status->error = MPF11770_ERR_PARAM;
+    status->phase = MPF11770_PHASE_IDLE;
+    status->event = 0;
+    return MPF11770_ERR_PARAM;
+  }
+
+  while (1)
+  {
+    status->attempts++;
+    status->phase = MPF11770_PHASE_IDLE;
+    status->event = 0;
+    status->byteIndex = 0;
+
+    if (isRead)
     {
-      return 0;
-    }
+      err = read_once(I2Cx, devAddr, regAddr, pData, length, enableCRC, status);
     }
-    receivedCRC |= (uint32_t)I2C_RecvData(I2Cx) << 8;
-    
-    /* Third CRC byte */
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG))
+    else
     {
-    if ((I2CTimeout--) == 0)
-    {
-      return 0;
+      err = write_once(I2Cx, devAddr, regAddr, pData, length, enableCRC, status);
     }
+
+    if (err == MPF11770_OK || err == MPF11770_ERR_CRC)
+    {
+      /* The frame completed with a STOP, wait for the bus to go idle */
+      mpf11770_error_t busErr = wait_bus_free(I2Cx, status);
+      if (err == MPF11770_OK)
+      {
+        err = busErr;
+      }
     }
-    receivedCRC |= (uint32_t)I2C_RecvData(I2Cx) << 16;
-    
-    /* Fourth CRC byte (MSB) - disable ACK before reading the last byte */
-    I2C_ConfigAck(I2Cx, DISABLE);
-    
-    /* Generate STOP signal before reading the last CRC byte */
-    I2C_GenerateStop(I2Cx, ENABLE);
-    
-    I2CTimeout = I2C_TIMEOUT_FLAG;
-    while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_RECVD_FLAG))
+    else
     {
-    if ((I2CTimeout--) == 0)
+      abort_transfer(I2Cx);
+    }
+
+    if (err == MPF11770_OK || !should_retry(err, status->attempts))
     {
-      return 0;
+      break;
     }
+
+    count_attempt_error(devAddr, err);
+    if (backoffUs != 0)
+    {
+      delay_us(backoffUs);
     }
-    receivedCRC |= (uint32_t)I2C_RecvData(I2Cx) << 24;
-    
-    /* Calculate CRC32 using software method */
-    uint32_t calculatedCRC = Calculate_CRC32(regAddr, length, pData);
-    
-    /* Verify CRC */
-    if (receivedCRC != calculatedCRC)
+    if (retryPolicy.exponentialBackoff && backoffUs < retryPolicy.maxBackoffUs)
     {
-    return 0;
+      /* Both are 16-bit, the doubling cannot overflow */
+      backoffUs <<= 1;
+      if (backoffUs > retryPolicy.maxBackoffUs)
+      {
+        backoffUs = retryPolicy.maxBackoffUs;
+      }
     }
   }
-  
-  /* Wait until I2C bus is free */
-  I2CTimeout = I2C_TIMEOUT_STOP_FLAG;
-  while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY))
+
+  if (err != MPF11770_OK)
   {
-    if ((I2CTimeout--) == 0)
+    count_attempt_error(devAddr, err);
+  }
+  status->error = err;
+  update_stats(devAddr, status, startCycles);
+  return err;
+}
+
+/**
+ * @brief Write data to an MPF11770 device with structured status and retries
+ * @param status - filled with error, failing phase/event and attempt count (must not be NULL)
+ * @return MPF11770_OK if successful, error code otherwise
+ */
+mpf11770_error_t MPF11770_I2C_master_write_ex(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                              uint8_t* pData, uint8_t length, bool enableCRC,
+                                              mpf11770_status_t* status)
+{
+  return run_transfer(false, I2Cx, devAddr, regAddr, pData, length, enableCRC, status);
+}
+
+/**
+ * @brief Read data from an MPF11770 device with structured status and retries
+ * @param status - filled with error, failing phase/event, CRC values and attempt count (must not be NULL)
+ * @return MPF11770_OK if successful, error code otherwise
+ */
+mpf11770_error_t MPF11770_I2C_master_read_ex(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                             uint8_t* pData, uint8_t length, bool enableCRC,
+                                             mpf11770_status_t* status)
+{
+  return run_transfer(true, I2Cx, devAddr, regAddr, pData, length, enableCRC, status);
+}
+
+/**
+* @brief Write data to an MPF11770 device via I2C with optional software CRC32
+* @param I2Cx - I2C interface to use
+ * @param devAddr - 7-bit device address
+ * @param regAddr - 16-bit register address
+* @param pData - pointer to data buffer
+ * @param length - length of data to write (1-82 bytes as per spec)
+ * @param enableCRC - set true to enable CRC32 calculation and verification
+* @return 1 if successful, 0 otherwise (use MPF11770_I2C_master_write_ex for details)
+*/
+int32_t MPF11770_I2C_master_write(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
+                         uint8_t* pData, uint8_t length, bool enableCRC)
+{
+  mpf11770_status_t status;
+
+  return (MPF11770_I2C_master_write_ex(I2Cx, devAddr, regAddr, pData, length, enableCRC, &status) == MPF11770_OK) ? 1 : 0;
+}
+
+/**
+* @brief Read data from an MPF11770 device via I2C with optional CRC32
+* @param I2Cx - I2C interface to use
+ * @param devAddr - 7-bit device address
+ * @param regAddr - 16-bit register address
+* @param pData - pointer to data buffer for read data
+* @param length - length of data to read (1-82 bytes as per spec)
+ * @param enableCRC - set true to enable CRC32 calculation and verification
+* @return 1 if successful, 0 otherwise (use MPF11770_I2C_master_read_ex for details)
+*/
+int32_t MPF11770_I2C_master_read(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
+                       uint8_t* pData, uint8_t length, bool enableCRC)
+{
+  mpf11770_status_t status;
+
+  return (MPF11770_I2C_master_read_ex(I2Cx, devAddr, regAddr, pData, length, enableCRC, &status) == MPF11770_OK) ? 1 : 0;
+}
+
+/**
+ * @brief Configure the retry/backoff policy used by all MPF11770 transfers
+ * @param policy - new policy, NULL restores the default (no retries)
+ */
+void MPF11770_SetRetryPolicy(const mpf11770_retry_policy_t* policy)
+{
+  if (policy == NULL)
+  {
+    retryPolicy.maxRetries = 0;
+    retryPolicy.backoffUs = 100;
+    retryPolicy.maxBackoffUs = 10000;
+    retryPolicy.exponentialBackoff = true;
+    retryPolicy.retryOnCrc = true;
+    retryPolicy.retryOnNack = true;
+    retryPolicy.retryOnTimeout = true;
+  }
+  else
+  {
+    retryPolicy = *policy;
+  }
+}
+
+/**
+ * @brief Get link statistics of a device
+ * @param devAddr - device address as passed to the transfer functions
+ * @return pointer to statistics, NULL if the device has not been accessed yet
+ */
+const mpf11770_link_stats_t* MPF11770_GetLinkStats(uint8_t devAddr)
+{
+  return get_stats_slot(devAddr, false);
+}
+
+/**
+ * @brief Clear the statistics of all devices
+ */
+void MPF11770_ResetLinkStats(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < MPF11770_MAX_DEVICES; i++)
+  {
+    uint8_t devAddr = linkStats[i].devAddr;
+    bool inUse = linkStats[i].inUse;
+
+    memset(&linkStats[i], 0, sizeof(linkStats[i]));
+    linkStats[i].devAddr = devAddr;
+    linkStats[i].inUse = inUse;
+  }
+}
+
+/**
+ * @brief Success rate of a device in 0.1% units
+ * @return 0-1000, 0 if no transfer has been made
+ */
+uint16_t MPF11770_GetSuccessRate(uint8_t devAddr)
+{
+  const mpf11770_link_stats_t* stats = get_stats_slot(devAddr, false);
+
+  if (stats == NULL || stats->transfers == 0)
+  {
+    return 0;
+  }
+  return (uint16_t)(((uint64_t)stats->successes * 1000) / stats->transfers);
+}
+
+/**
+ * @brief Latency percentile of a device from the log2 histogram
+ * @param percent - percentile to report (1-100)
+ * @return upper bound of the histogram bucket in microseconds, 0 if no data
+ */
+uint32_t MPF11770_GetLatencyPercentile(uint8_t devAddr, uint8_t percent)
+{
+  const mpf11770_link_stats_t* stats = get_stats_slot(devAddr, false);
+  uint64_t target;
+  uint32_t cumulative = 0;
+  uint8_t bucket;
+
+  if (stats == NULL || stats->transfers == 0)
+  {
+    return 0;
+  }
+  if (percent > 100)
+  {
+    percent = 100;
+  }
+
+  target = ((uint64_t)stats->transfers * percent + 99) / 100;
+  for (bucket = 0; bucket < MPF11770_LATENCY_BUCKETS; bucket++)
+  {
+    cumulative += stats->latencyHist[bucket];
+    if (cumulative >= target)
     {
-      return 0;
+      break;
     }
   }
-  
-  return 1;
+  if (bucket >= MPF11770_LATENCY_BUCKETS - 1)
+  {
+    return stats->latencyMaxUs;
+  }
+  return (uint32_t)2 << bucket;
 }
+
 /**
 * @brief  Activates the MPF11770 chip by pulling SDA low for 10ms
 * @param  I2Cx: I2C peripheral to be used
@@ -571,10 +788,10 @@ int32_t MPF11770_Activate(I2C_Module* I2Cx)
   GPIO_InitPeripheral(SDA_GPIO, &GPIO_InitStructure);
   /* Pull SDA low for 10ms */
   GPIO_ResetBits(SDA_GPIO, SDA_PIN);
-  systick_delay_ms(6);  /* Delay 10ms */
+  sleep_ms(6);  /* Delay 6ms, core sleeps */
   /* Release SDA (pull high) */
   GPIO_SetBits(SDA_GPIO, SDA_PIN);
-  systick_delay_ms(1);  /* Delay 1ms */
+  sleep_ms(1);  /* Delay 1ms */
   i2c_master_init(I2Cx, 100); // 100kHz
   
   return 0;  /* Success */
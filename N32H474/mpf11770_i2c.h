@@ -24,6 +24,82 @@
 #include "mps_crc.h"  /* For CRC functions */
 #include <stdbool.h>
 
+/* Number of devices tracked by the link statistics */
+#define MPF11770_MAX_DEVICES        4
+
+/* Latency histogram buckets, bucket n counts transfers of [2^n, 2^(n+1)) us */
+#define MPF11770_LATENCY_BUCKETS    16
+
+/**
+ * @brief Transfer result
+ */
+typedef enum {
+  MPF11770_OK = 0,
+  MPF11770_ERR_PARAM,         // Invalid buffer or length
+  MPF11770_ERR_BUS_BUSY,      // Bus did not become idle before START
+  MPF11770_ERR_TIMEOUT,       // Awaited event did not occur in time
+  MPF11770_ERR_NACK,          // Address or data byte not acknowledged
+  MPF11770_ERR_CRC            // Received CRC32 does not match the data
+} mpf11770_error_t;
+
+/**
+ * @brief Frame phase in which a transfer stopped
+ */
+typedef enum {
+  MPF11770_PHASE_IDLE = 0,    // Before the frame started
+  MPF11770_PHASE_START,       // START and device address (write)
+  MPF11770_PHASE_REG_ADDR,    // 16-bit register address
+  MPF11770_PHASE_LENGTH,      // Length byte
+  MPF11770_PHASE_DATA,        // Payload bytes
+  MPF11770_PHASE_CRC,         // CRC32 bytes
+  MPF11770_PHASE_RESTART,     // Repeated START and device address (read)
+  MPF11770_PHASE_STOP         // STOP and bus release
+} mpf11770_phase_t;
+
+/**
+ * @brief Detailed result of one transfer call
+ */
+typedef struct {
+  mpf11770_error_t error;     // Final result
+  mpf11770_phase_t phase;     // Phase of the last attempt
+  uint32_t event;             // I2C event/flag awaited when the last attempt failed
+  uint8_t byteIndex;          // Byte index within the DATA or CRC phase
+  uint8_t attempts;           // Attempts made, including the first one
+  uint32_t receivedCRC;       // CRC32 received from the device (read with CRC)
+  uint32_t calculatedCRC;     // CRC32 calculated locally
+} mpf11770_status_t;
+
+/**
+ * @brief Retry/backoff policy shared by all transfers
+ */
+typedef struct {
+  uint8_t maxRetries;         // Retries after the first attempt (0 = no retry)
+  uint16_t backoffUs;         // Delay before the first retry
+  uint16_t maxBackoffUs;      // Doubling stops at this delay
+  bool exponentialBackoff;    // Double the delay on every further retry
+  bool retryOnCrc;            // Retry on CRC mismatch
+  bool retryOnNack;           // Retry on NACK
+  bool retryOnTimeout;        // Retry on timeout or busy bus
+} mpf11770_retry_policy_t;
+
+/**
+ * @brief Link quality counters of one device
+ */
+typedef struct {
+  bool inUse;
+  uint8_t devAddr;
+  uint32_t transfers;         // Transfer calls
+  uint32_t successes;         // Calls that finally succeeded
+  uint32_t failures;          // Calls that failed after all retries
+  uint32_t retries;           // Extra attempts made
+  uint32_t crcErrors;         // Attempts failed on CRC mismatch
+  uint32_t nacks;             // Attempts failed on NACK
+  uint32_t timeouts;          // Attempts failed on timeout
+  uint32_t busBusy;           // Attempts failed on a busy bus
+  uint32_t latencyMaxUs;      // Worst call latency
+  uint32_t latencyHist[MPF11770_LATENCY_BUCKETS];
+} mpf11770_link_stats_t;
+
 
 /* MPF11770 specific I2C functions with optional CRC */
 /**
@@ -34,7 +110,7 @@
  * @param pData - pointer to data buffer
  * @param length - length of data to write (1-82 bytes as per spec)
  * @param enableCRC - set true to enable CRC32 calculation and verification
- * @return 0 if successful, error code otherwise
+ * @return 1 if successful, 0 otherwise
  */
 int32_t MPF11770_I2C_master_write(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
                                  uint8_t* pData, uint8_t length, bool enableCRC);
@@ -47,11 +123,55 @@ int32_t MPF11770_I2C_master_write(I2C_Module* I2Cx, uint8_t devAddr, uint16_t re
  * @param pData - pointer to data buffer for read data
  * @param length - length of data to read (1-82 bytes as per spec)
  * @param enableCRC - set true to enable CRC32 calculation and verification
- * @return 0 if successful, error code otherwise
+ * @return 1 if successful, 0 otherwise
  */
 int32_t MPF11770_I2C_master_read(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr, 
                                 uint8_t* pData, uint8_t length, bool enableCRC);
 
+/**
+ * @brief Write with structured status, retry policy and link statistics
+ * @param status - receives the failing phase/event and attempt count (must not be NULL)
+ * @return MPF11770_OK if successful, error code otherwise
+ */
+mpf11770_error_t MPF11770_I2C_master_write_ex(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                              uint8_t* pData, uint8_t length, bool enableCRC,
+                                              mpf11770_status_t* status);
+
+/**
+ * @brief Read with structured status, retry policy and link statistics
+ * @param status - receives the failing phase/event, CRC values and attempt count (must not be NULL)
+ * @return MPF11770_OK if successful, error code otherwise
+ */
+mpf11770_error_t MPF11770_I2C_master_read_ex(I2C_Module* I2Cx, uint8_t devAddr, uint16_t regAddr,
+                                             uint8_t* pData, uint8_t length, bool enableCRC,
+                                             mpf11770_status_t* status);
+
+/**
+ * @brief Set the retry/backoff policy, NULL restores the default (no retries)
+ */
+void MPF11770_SetRetryPolicy(const mpf11770_retry_policy_t* policy);
+
+/**
+ * @brief Get link statistics of a device, NULL if it has not been accessed
+ */
+const mpf11770_link_stats_t* MPF11770_GetLinkStats(uint8_t devAddr);
+
+/**
+ * @brief Clear the link statistics of all devices
+ */
+void MPF11770_ResetLinkStats(void);
+
+/**
+ * @brief Success rate of a device in 0.1% units (0-1000)
+ */
+uint16_t MPF11770_GetSuccessRate(uint8_t devAddr);
+
+/**
+ * @brief Latency percentile of a device in microseconds (histogram bucket bound)
+ * @param percent - percentile to report, e.g. 50, 95, 99
+ */
+uint32_t MPF11770_GetLatencyPercentile(uint8_t devAddr, uint8_t percent);
+
 
 
 /**
@@ -0,0 +1,449 @@
+#ifndef __MPF4279X_DECODE_H__
+#define __MPF4279X_DECODE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "MPF4279x.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief Zero-copy decoders for MPF4279x measurement and fuel gauge frames
+ *
+ * The accessors below read fields straight out of the raw I2C/DMA receive
+ * buffer. Every multi-byte field is assembled byte by byte in little-endian
+ * order, so the buffer may sit at any alignment and nothing is copied except
+ * the field itself. Offsets follow the device register map and are written
+ * in terms of SETMAX_NCELLS_SER (N below); the packed structures in
+ * MPF4279x.h are checked against the same map at compile time.
+ */
+
+/* Compile-time check that also works on pre-C11 compilers */
+#define MPF4279X_STATIC_ASSERT(cond, name) \
+  typedef char mpf4279x_assert_##name[(cond) ? 1 : -1]
+
+#define MPF4279X_N  (SETMAX_NCELLS_SER)
+
+/* ------------------------------------------------------------------ */
+/* Little-endian, alignment-independent field readers                  */
+/* ------------------------------------------------------------------ */
+
+static inline uint8_t mpf4279x_rd_u8(const uint8_t* buf, uint32_t off)
+{
+  return buf[off];
+}
+
+static inline uint16_t mpf4279x_rd_u16(const uint8_t* buf, uint32_t off)
+{
+  return (uint16_t)(buf[off] | ((uint16_t)buf[off + 1] << 8));
+}
+
+static inline int16_t mpf4279x_rd_s16(const uint8_t* buf, uint32_t off)
+{
+  return (int16_t)mpf4279x_rd_u16(buf, off);
+}
+
+static inline uint32_t mpf4279x_rd_u24(const uint8_t* buf, uint32_t off)
+{
+  return (uint32_t)buf[off] | ((uint32_t)buf[off + 1] << 8) | ((uint32_t)buf[off + 2] << 16);
+}
+
+static inline uint32_t mpf4279x_rd_u32(const uint8_t* buf, uint32_t off)
+{
+  return (uint32_t)buf[off] | ((uint32_t)buf[off + 1] << 8) |
+         ((uint32_t)buf[off + 2] << 16) | ((uint32_t)buf[off + 3] << 24);
+}
+
+static inline int32_t mpf4279x_rd_s32(const uint8_t* buf, uint32_t off)
+{
+  return (int32_t)mpf4279x_rd_u32(buf, off);
+}
+
+static inline float mpf4279x_rd_f32(const uint8_t* buf, uint32_t off)
+{
+  uint32_t raw = mpf4279x_rd_u32(buf, off);
+  float value;
+  memcpy(&value, &raw, sizeof(value));  /* 4-byte bit cast, no aliasing issues */
+  return value;
+}
+
+#ifdef FG_NewGen
+
+/* ------------------------------------------------------------------ */
+/* Meas_REG register map (new generation fuel gauge)                   */
+/* ------------------------------------------------------------------ */
+#define MEAS_OFF_CELLS            0u
+#define MEAS_OFF_VPACK            (2u * MPF4279X_N)
+#define MEAS_OFF_CURRENT          (2u * MPF4279X_N + 2u)
+#define MEAS_OFF_PACK_CURRENT     (6u * MPF4279X_N + 2u)
+#define MEAS_OFF_I_CC             (6u * MPF4279X_N + 6u)
+#define MEAS_OFF_TAMB             (6u * MPF4279X_N + 10u)
+#define MEAS_OFF_TEMP_VECT        (6u * MPF4279X_N + 12u)
+#define MEAS_OFF_TCHIP            (6u * MPF4279X_N + 20u)
+#define MEAS_OFF_CELLS_BALANCING  (6u * MPF4279X_N + 22u)
+#define MEAS_OFF_RST              (6u * MPF4279X_N + 24u)   /* 18 flag bits, 3 bytes */
+#define MEAS_OFF_SHW              (6u * MPF4279X_N + 27u)   /* 2 flag bits, 1 byte */
+#define MEAS_REG_SIZE             (6u * MPF4279X_N + 28u)
+
+/* ------------------------------------------------------------------ */
+/* def_fg_out register map (new generation fuel gauge)                 */
+/* ------------------------------------------------------------------ */
+#define FG_OFF_INTR               0u                        /* 18 flag bits, 3 bytes */
+#define FG_OFF_STATUS             3u
+#define FG_OFF_SOC_ABS_CELLS      4u
+#define FG_OFF_EMTY_SOC_CELLS     (MPF4279X_N + 4u)
+#define FG_OFF_EMTY_ID            (2u * MPF4279X_N + 4u)
+#define FG_OFF_EMTY_RTIME         (2u * MPF4279X_N + 5u)
+#define FG_OFF_EMTY_DT            (2u * MPF4279X_N + 7u)
+#define FG_OFF_EMTY_LIM           (2u * MPF4279X_N + 9u)
+#define FG_OFF_FULL_SOC_CELLS     (2u * MPF4279X_N + 10u)
+#define FG_OFF_FULL_ID            (3u * MPF4279X_N + 10u)
+#define FG_OFF_FULL_RTIME         (3u * MPF4279X_N + 11u)
+#define FG_OFF_FULL_RTIME_CC      (3u * MPF4279X_N + 13u)
+#define FG_OFF_FULL_DT            (3u * MPF4279X_N + 15u)
+#define FG_OFF_FULL_DT_CC         (3u * MPF4279X_N + 17u)
+#define FG_OFF_FULL_LIM           (3u * MPF4279X_N + 19u)
+#define FG_OFF_SOC_PACK           (3u * MPF4279X_N + 20u)
+#define FG_OFF_SOC_PACK_UNAVBL    (3u * MPF4279X_N + 22u)
+#define FG_OFF_IDIS_AVG           (3u * MPF4279X_N + 24u)   /* value, lrn, rslt */
+#define FG_OFF_IDIS_END           (3u * MPF4279X_N + 28u)
+#define FG_OFF_ICHG_CC            (3u * MPF4279X_N + 32u)
+#define FG_OFF_ICHG_END           (3u * MPF4279X_N + 36u)
+#define FG_OFF_VCHG_CV            (3u * MPF4279X_N + 40u)
+#define FG_OFF_SORESR_DIS_CELLS   (3u * MPF4279X_N + 44u)
+#define FG_OFF_SORESR_CHG_CELLS   (7u * MPF4279X_N + 44u)
+#define FG_OFF_SORESR_LRN_CELLS   (11u * MPF4279X_N + 44u)
+#define FG_OFF_SORESR_RSLT_CELLS  (12u * MPF4279X_N + 44u)
+#define FG_OFF_RCXN_CELLS         (13u * MPF4279X_N + 44u)
+#define FG_OFF_RCXN_LRN_CELLS     (15u * MPF4279X_N + 44u)
+#define FG_OFF_RCXN_RSLT_CELLS    (16u * MPF4279X_N + 44u)
+#define FG_OFF_HCONV              (17u * MPF4279X_N + 44u)
+#define FG_OFF_SOH_PACK           (17u * MPF4279X_N + 48u)
+#define FG_OFF_SOH_CELLS          (17u * MPF4279X_N + 52u)
+#define FG_OFF_PRDG               (21u * MPF4279X_N + 52u)
+#define FG_OFF_PDIS               (21u * MPF4279X_N + 56u)
+#define FG_OFF_PDIS_ID            (21u * MPF4279X_N + 60u)
+#define FG_OFF_PDIS_LIM           (21u * MPF4279X_N + 61u)
+#define FG_OFF_PCHG               (21u * MPF4279X_N + 62u)
+#define FG_OFF_PCHG_ID            (21u * MPF4279X_N + 66u)
+#define FG_OFF_PCHG_LIM           (21u * MPF4279X_N + 67u)
+#define FG_OFF_OT_WARN            (21u * MPF4279X_N + 68u)  /* id byte + 3 flag bits */
+#define FG_OFF_ITERATION          (21u * MPF4279X_N + 70u)
+#define FG_OUT_SIZE               (21u * MPF4279X_N + 74u)
+
+/* Learning blocks share one layout: u16 value, u8 def_fg_lrn, u8 def_fg_rslt */
+#define FG_LRN_OFF_VALUE          0u
+#define FG_LRN_OFF_STATE          2u
+#define FG_LRN_OFF_RESULT         3u
+
+#else /* !FG_NewGen */
+
+/* ------------------------------------------------------------------ */
+/* Meas_REG register map                                               */
+/* ------------------------------------------------------------------ */
+#define MEAS_OFF_CELLS            0u
+#define MEAS_OFF_VPACK            (2u * MPF4279X_N)
+#define MEAS_OFF_CURRENT          (2u * MPF4279X_N + 2u)
+#define MEAS_OFF_PACK_CURRENT     (6u * MPF4279X_N + 2u)
+#define MEAS_OFF_I_CC             (6u * MPF4279X_N + 6u)
+#define MEAS_OFF_TEMP_VECT        (6u * MPF4279X_N + 10u)
+#define MEAS_OFF_TCHIP            (6u * MPF4279X_N + 18u)
+#define MEAS_OFF_CELLS_BALANCING  (6u * MPF4279X_N + 20u)
+#define MEAS_OFF_RST              (6u * MPF4279X_N + 22u)   /* 16 flag bits, 2 bytes */
+#define MEAS_OFF_SHW              (6u * MPF4279X_N + 24u)   /* 4 flag bits, 1 byte */
+#define MEAS_REG_SIZE             (6u * MPF4279X_N + 25u)
+
+/* ------------------------------------------------------------------ */
+/* def_fg_out register map                                             */
+/* ------------------------------------------------------------------ */
+#define FG_OFF_EMTY_SOC_CELLS     0u
+#define FG_OFF_EMTY_ID            (MPF4279X_N)
+#define FG_OFF_EMTY_RTIME         (MPF4279X_N + 1u)
+#define FG_OFF_EMTY_LIM           (MPF4279X_N + 3u)
+#define FG_OFF_FULL_SOC_CELLS     (MPF4279X_N + 4u)
+#define FG_OFF_FULL_ID            (2u * MPF4279X_N + 4u)
+#define FG_OFF_FULL_RTIME         (2u * MPF4279X_N + 5u)
+#define FG_OFF_FULL_LIM           (2u * MPF4279X_N + 7u)
+#define FG_OFF_IDIS_AVG           (2u * MPF4279X_N + 8u)
+#define FG_OFF_IDIS_END           (2u * MPF4279X_N + 10u)
+#define FG_OFF_ICHG_CC            (2u * MPF4279X_N + 12u)
+#define FG_OFF_ICHG_END           (2u * MPF4279X_N + 14u)
+#define FG_OFF_VCHG_CV            (2u * MPF4279X_N + 16u)
+#define FG_OFF_SOC_PACK_UNAVBL    (2u * MPF4279X_N + 18u)
+#define FG_OFF_SOC_PACK           (2u * MPF4279X_N + 20u)
+#define FG_OFF_SOC_ABS_CELLS      (2u * MPF4279X_N + 22u)
+#define FG_OFF_SOH_PACK           (3u * MPF4279X_N + 22u)
+#define FG_OFF_SOH_CELLS          (3u * MPF4279X_N + 26u)
+#define FG_OFF_PRDG               (7u * MPF4279X_N + 26u)
+#define FG_OFF_PDIS               (7u * MPF4279X_N + 30u)
+#define FG_OFF_PDIS_ID            (7u * MPF4279X_N + 34u)
+#define FG_OFF_PDIS_LIM           (7u * MPF4279X_N + 35u)
+#define FG_OFF_PCHG               (7u * MPF4279X_N + 36u)
+#define FG_OFF_PCHG_ID            (7u * MPF4279X_N + 40u)
+#define FG_OFF_PCHG_LIM           (7u * MPF4279X_N + 41u)
+#define FG_OFF_STATUS             (7u * MPF4279X_N + 42u)
+#define FG_OFF_ITERATION          (7u * MPF4279X_N + 43u)
+#define FG_OUT_SIZE               (7u * MPF4279X_N + 47u)
+
+#endif /* FG_NewGen */
+
+/* ------------------------------------------------------------------ */
+/* Layout checks: the packed structures must match the register map    */
+/* ------------------------------------------------------------------ */
+MPF4279X_STATIC_ASSERT(sizeof(Meas_REG) == MEAS_REG_SIZE, meas_size);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, VPack) == MEAS_OFF_VPACK, meas_vpack);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, Current) == MEAS_OFF_CURRENT, meas_current);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, PackCurrent) == MEAS_OFF_PACK_CURRENT, meas_pack_current);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, I_CC) == MEAS_OFF_I_CC, meas_i_cc);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, TempVect) == MEAS_OFF_TEMP_VECT, meas_temp_vect);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, TChip) == MEAS_OFF_TCHIP, meas_tchip);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, CellsBalancing) == MEAS_OFF_CELLS_BALANCING, meas_balancing);
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, shw) == MEAS_OFF_SHW, meas_shw);
+
+MPF4279X_STATIC_ASSERT(sizeof(def_fg_out) == FG_OUT_SIZE, fg_size);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, emty_rtime) == FG_OFF_EMTY_RTIME, fg_emty_rtime);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, full_rtime) == FG_OFF_FULL_RTIME, fg_full_rtime);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, soc_pack) == FG_OFF_SOC_PACK, fg_soc_pack);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, soc_abs_cells) == FG_OFF_SOC_ABS_CELLS, fg_soc_abs);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, soh_pack) == FG_OFF_SOH_PACK, fg_soh_pack);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, soh_cells) == FG_OFF_SOH_CELLS, fg_soh_cells);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, pdis) == FG_OFF_PDIS, fg_pdis);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, pchg_lim) == FG_OFF_PCHG_LIM, fg_pchg_lim);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, status) == FG_OFF_STATUS, fg_status);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, iteration) == FG_OFF_ITERATION, fg_iteration);
+#ifdef FG_NewGen
+MPF4279X_STATIC_ASSERT(offsetof(Meas_REG, Tamb) == MEAS_OFF_TAMB, meas_tamb);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, idis_avg) == FG_OFF_IDIS_AVG, fg_idis_avg);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, vchg_cv_rslt) == FG_OFF_VCHG_CV + FG_LRN_OFF_RESULT, fg_vchg_cv);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, soresr_dis_cells) == FG_OFF_SORESR_DIS_CELLS, fg_soresr_dis);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, rcxn_cells) == FG_OFF_RCXN_CELLS, fg_rcxn);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, hconv) == FG_OFF_HCONV, fg_hconv);
+MPF4279X_STATIC_ASSERT(offsetof(def_fg_out, OT_warn) == FG_OFF_OT_WARN, fg_ot_warn);
+#endif
+
+/* ------------------------------------------------------------------ */
+/* Meas_REG accessors                                                  */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Cell voltage of one series cell
+ * @param buf: raw Meas_REG frame as received from the device
+ * @param cell: cell index (0 to SETMAX_NCELLS_SER-1)
+ */
+static inline uint16_t mpf4279x_meas_cell(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_u16(buf, MEAS_OFF_CELLS + 2u * cell);
+}
+
+static inline uint16_t mpf4279x_meas_vpack(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, MEAS_OFF_VPACK);
+}
+
+static inline int32_t mpf4279x_meas_current(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_s32(buf, MEAS_OFF_CURRENT + 4u * cell);
+}
+
+static inline int32_t mpf4279x_meas_pack_current(const uint8_t* buf)
+{
+  return mpf4279x_rd_s32(buf, MEAS_OFF_PACK_CURRENT);
+}
+
+static inline int32_t mpf4279x_meas_i_cc(const uint8_t* buf)
+{
+  return mpf4279x_rd_s32(buf, MEAS_OFF_I_CC);
+}
+
+/**
+ * @brief External temperature sensor reading
+ * @param idx: sensor index (0-3)
+ */
+static inline int16_t mpf4279x_meas_temp(const uint8_t* buf, uint8_t idx)
+{
+  return mpf4279x_rd_s16(buf, MEAS_OFF_TEMP_VECT + 2u * idx);
+}
+
+static inline int16_t mpf4279x_meas_tchip(const uint8_t* buf)
+{
+  return mpf4279x_rd_s16(buf, MEAS_OFF_TCHIP);
+}
+
+static inline uint16_t mpf4279x_meas_cells_balancing(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, MEAS_OFF_CELLS_BALANCING);
+}
+
+#ifdef FG_NewGen
+static inline int16_t mpf4279x_meas_tamb(const uint8_t* buf)
+{
+  return mpf4279x_rd_s16(buf, MEAS_OFF_TAMB);
+}
+
+/**
+ * @brief Reset request flags as a bitmask (bit 0 = hard ... bit 17 = RES01)
+ */
+static inline uint32_t mpf4279x_meas_rst(const uint8_t* buf)
+{
+  return mpf4279x_rd_u24(buf, MEAS_OFF_RST);
+}
+#else
+/**
+ * @brief Reset request flags as a bitmask (bit 0 = hard ... bit 15 = RES01)
+ */
+static inline uint32_t mpf4279x_meas_rst(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, MEAS_OFF_RST);
+}
+#endif
+
+static inline uint8_t mpf4279x_meas_shw(const uint8_t* buf)
+{
+  return mpf4279x_rd_u8(buf, MEAS_OFF_SHW);
+}
+
+/* ------------------------------------------------------------------ */
+/* def_fg_out accessors                                                */
+/* ------------------------------------------------------------------ */
+
+static inline def_fg_status mpf4279x_fg_status(const uint8_t* buf)
+{
+  return (def_fg_status)mpf4279x_rd_u8(buf, FG_OFF_STATUS);
+}
+
+static inline uint8_t mpf4279x_fg_soc_cell(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_u8(buf, FG_OFF_SOC_ABS_CELLS + cell);
+}
+
+static inline uint16_t mpf4279x_fg_soc_pack(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_SOC_PACK);
+}
+
+static inline uint16_t mpf4279x_fg_soc_pack_unavbl(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_SOC_PACK_UNAVBL);
+}
+
+static inline uint16_t mpf4279x_fg_emty_rtime(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_EMTY_RTIME);
+}
+
+static inline def_fg_lim mpf4279x_fg_emty_lim(const uint8_t* buf)
+{
+  return (def_fg_lim)mpf4279x_rd_u8(buf, FG_OFF_EMTY_LIM);
+}
+
+static inline uint16_t mpf4279x_fg_full_rtime(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_FULL_RTIME);
+}
+
+static inline def_fg_lim mpf4279x_fg_full_lim(const uint8_t* buf)
+{
+  return (def_fg_lim)mpf4279x_rd_u8(buf, FG_OFF_FULL_LIM);
+}
+
+static inline uint32_t mpf4279x_fg_soh_pack(const uint8_t* buf)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_SOH_PACK);
+}
+
+static inline uint32_t mpf4279x_fg_soh_cell(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_SOH_CELLS + 4u * cell);
+}
+
+static inline uint32_t mpf4279x_fg_prdg(const uint8_t* buf)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_PRDG);
+}
+
+static inline uint32_t mpf4279x_fg_pdis(const uint8_t* buf)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_PDIS);
+}
+
+static inline uint32_t mpf4279x_fg_pchg(const uint8_t* buf)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_PCHG);
+}
+
+static inline uint32_t mpf4279x_fg_iteration(const uint8_t* buf)
+{
+  return mpf4279x_rd_u32(buf, FG_OFF_ITERATION);
+}
+
+#ifdef FG_NewGen
+/**
+ * @brief Interrupt flags as a bitmask (bit 0 = iteration ... bit 17 = pchg_lim)
+ */
+static inline uint32_t mpf4279x_fg_intr(const uint8_t* buf)
+{
+  return mpf4279x_rd_u24(buf, FG_OFF_INTR);
+}
+
+/**
+ * @brief Read one learning block (IDIS_AVG, IDIS_END, ICHG_CC, ICHG_END, VCHG_CV)
+ * @param blockOff: FG_OFF_IDIS_AVG ... FG_OFF_VCHG_CV
+ * @param state: optional output for def_fg_lrn, may be NULL
+ * @param result: optional output for def_fg_rslt, may be NULL
+ * @return learned value
+ */
+static inline uint16_t mpf4279x_fg_learning(const uint8_t* buf, uint32_t blockOff,
+                                            def_fg_lrn* state, def_fg_rslt* result)
+{
+  if (state != NULL)  *state = (def_fg_lrn)mpf4279x_rd_u8(buf, blockOff + FG_LRN_OFF_STATE);
+  if (result != NULL) *result = (def_fg_rslt)mpf4279x_rd_u8(buf, blockOff + FG_LRN_OFF_RESULT);
+  return mpf4279x_rd_u16(buf, blockOff + FG_LRN_OFF_VALUE);
+}
+
+static inline float mpf4279x_fg_soresr_dis(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_f32(buf, FG_OFF_SORESR_DIS_CELLS + 4u * cell);
+}
+
+static inline float mpf4279x_fg_soresr_chg(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_f32(buf, FG_OFF_SORESR_CHG_CELLS + 4u * cell);
+}
+
+static inline uint16_t mpf4279x_fg_rcxn(const uint8_t* buf, uint8_t cell)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_RCXN_CELLS + 2u * cell);
+}
+
+static inline uint16_t mpf4279x_fg_hconv(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_HCONV);
+}
+
+static inline int16_t mpf4279x_fg_emty_dT(const uint8_t* buf)
+{
+  return mpf4279x_rd_s16(buf, FG_OFF_EMTY_DT);
+}
+
+static inline int16_t mpf4279x_fg_full_dT(const uint8_t* buf)
+{
+  return mpf4279x_rd_s16(buf, FG_OFF_FULL_DT);
+}
+
+/**
+ * @brief Over-temperature warning: cell id in bits 0-7, chg_cc/chg_end/dis flags in bits 8-10
+ */
+static inline uint16_t mpf4279x_fg_ot_warn(const uint8_t* buf)
+{
+  return mpf4279x_rd_u16(buf, FG_OFF_OT_WARN);
+}
+#endif /* FG_NewGen */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPF4279X_DECODE_H__ */
@@ -2,6 +2,11 @@
 #include "n32h47x_48x_rcc.h"
 #include "n32h47x_48x_adc.h"
 #include "n32h47x_48x_gpio.h"
+#include "n32h47x_48x_dma.h"
+#include "misc.h"
+#include "mps_time.h"
+#include "mps_sched.h"
+
 /**
  * @brief Configure GPIO pin for ADC input
  * 
@@ -44,27 +49,115 @@ void adc_gpio_config(GPIO_Module* GPIOx, uint16_t GpioPin)
  }
 
 
+/* Scan state per ADC */
+typedef struct {
+  bool active;
+  DMA_ChannelType* dmaChannel;
+  void* buffer;
+  uint16_t frames;              /* Frames in the whole buffer, even */
+  uint8_t channels;             /* Samples (packed pairs in dual mode) per frame */
+  bool dual;                    /* 32-bit packed master/slave words */
+  bool triggered;               /* Sequences started by an external trigger */
+  adc_frame_callback_t callBack;
+  adc_dual_callback_t dualCallBack;
+  void* ctx;
+  uint32_t overruns;            /* Halves overwritten before their callBack returned */
+} adc_scan_t;
+
+static adc_scan_t adc_scans[4];
+
+/* Conversion setup per ADC */
+static uint8_t adc_bits[4] = {12, 12, 12, 12};          /* Resolution in bits */
+static uint32_t adc_vref_mv[4] = {ADC_VREF_NOMINAL_MV, ADC_VREF_NOMINAL_MV, ADC_VREF_NOMINAL_MV, ADC_VREF_NOMINAL_MV};
+static adc_scale_t adc_scales[4];                        /* Raw to mV at the pin */
+static uint8_t adc_channel[4];                           /* Single channel set by adc_init */
+static uint8_t adc_sample_time[4];
+
+/* Interrupt state per ADC */
+typedef struct {
+  adc_callback_t callBack;
+  void* ctx;
+  uint32_t events;              /* Enabled adc_event_t bits */
+  volatile bool timing;         /* A software start is waiting for its interrupt */
+  volatile uint32_t triggerCycles;
+  volatile bool injTiming;
+  volatile uint32_t injTriggerCycles;
+  uint32_t interrupts;
+  uint32_t lastLatencyCycles;
+  uint32_t maxLatencyCycles;
+} adc_irq_t;
+
+static adc_irq_t adc_irqs[4];
+
+/* Analog watchdog state per ADC */
+typedef struct {
+  adc_protect_handler_t handler;
+  void* ctx;
+  volatile bool armed;
+  uint32_t trips;
+  uint32_t lastActionCycles;    /* Interrupt entry to handler return */
+  uint32_t maxActionCycles;
+} adc_watchdog_t;
+
+static adc_watchdog_t adc_watchdogs[4];
+static const uint8_t adcInjRanks[ADC_INJECTED_MAX] = {ADC_INJ_CH_1, ADC_INJ_CH_2, ADC_INJ_CH_3, ADC_INJ_CH_4};
+
 /**
- * @brief Initialize ADC module with full configuration
- * 
- * Performs complete ADC initialization including:
- * - Clock enable and configuration  
- * - ADC module initialization and calibration
- * - Resolution and conversion mode setup
- * 
+ * @brief ADC index 0-3, -1 if not an ADC
+ */
+static int get_adc_index(ADC_Module* ADCx)
+{
+  if (ADCx == ADC1) return 0;
+  if (ADCx == ADC2) return 1;
+  if (ADCx == ADC3) return 2;
+  if (ADCx == ADC4) return 3;
+  return -1;
+}
+
+/**
+ * @brief Timestamp a software start for the latency measurement
+ */
+static void adc_mark_trigger(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index >= 0 && adc_irqs[index].events != 0) {
+    adc_irqs[index].triggerCycles = time_cycles32();
+    adc_irqs[index].timing = true;
+  }
+}
+
+/**
+ * @brief Remember the resolution and rebuild the default scale for it
+ */
+static void adc_set_resolution_bits(ADC_Module* ADCx, adc_resolution_t resolution)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index < 0) {
+    return;
+  }
+  switch (resolution) {
+    case ADC_RESOLUTION_6BIT:  adc_bits[index] = 6; break;
+    case ADC_RESOLUTION_8BIT:  adc_bits[index] = 8; break;
+    case ADC_RESOLUTION_10BIT: adc_bits[index] = 10; break;
+    default:                   adc_bits[index] = 12; break;
+  }
+  (void)adc_scale_init(&adc_scales[index], adc_vref_mv[index], adc_bits[index], ADC_GAIN_UNITY, 0);
+}
+
+/**
+ * @brief Clock, initialize and calibrate an ADC
  * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
- * @param ADC_Channel: ADC channel to configure (e.g., ADC_CH_0, ADC_CH_1, etc.)
- * @param GPIOx: GPIO port for ADC input (GPIOA, GPIOB, etc.)
- * @param GPIO_Pin: GPIO pin for ADC input (GPIO_PIN_0, GPIO_PIN_1, etc.)
  * @param resolution: ADC resolution (6/8/10/12 bit)
  * @param continuous: true for continuous conversion, false for single
- * @param sampleTime: ADC sampling time (ADC_SAMP_TIME_CYCLES_1_5 to ADC_SAMP_TIME_CYCLES_601_5)
+ * @param chsNumber: Regular sequence length, scan mode when above 1
+ * @param workMode: ADC_WORKMODE_INDEPENDENT or a dual mode of the pair
+ * @param extTrig: Regular trigger, ADC_EXT_TRIG_REG_CONV_SOFTWARE or a hardware source
  */
-void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_t GPIO_Pin, adc_resolution_t resolution, bool continuous, uint8_t sampleTime)
+static void adc_setup(ADC_Module* ADCx, adc_resolution_t resolution, bool continuous, uint8_t chsNumber,
+                      uint32_t workMode, uint32_t extTrig)
 {
-
-  adc_gpio_config(GPIOx, GPIO_Pin);
-
   ADC_InitType ADC_InitStructure;
   
   /* Configure RCC - Enable ADC clock */
@@ -86,12 +179,12 @@ void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_
   
   /* Initialize ADC structure */
   ADC_InitStruct(&ADC_InitStructure);
-  ADC_InitStructure.WorkMode = ADC_WORKMODE_INDEPENDENT;
-  ADC_InitStructure.MultiChEn = DISABLE;
+  ADC_InitStructure.WorkMode = workMode;
+  ADC_InitStructure.MultiChEn = (chsNumber > 1) ? ENABLE : DISABLE;
   ADC_InitStructure.ContinueConvEn = continuous ? ENABLE : DISABLE;
-  ADC_InitStructure.ExtTrigSelect = ADC_EXT_TRIG_REG_CONV_SOFTWARE;
+  ADC_InitStructure.ExtTrigSelect = extTrig;
   ADC_InitStructure.DatAlign = ADC_DAT_ALIGN_R;
-  ADC_InitStructure.ChsNumber = 1;
+  ADC_InitStructure.ChsNumber = chsNumber;
   /* Set resolution based on user parameter */
   switch (resolution) {
     case ADC_RESOLUTION_6BIT:  ADC_InitStructure.Resolution = ADC_DATA_RES_6BIT; break;
@@ -101,6 +194,8 @@ void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_
     default: ADC_InitStructure.Resolution = ADC_DATA_RES_12BIT; break;
   }
   ADC_Init(ADCx, &ADC_InitStructure);
+  adc_set_resolution_bits(ADCx, resolution);
+  ADC_EnableExternalTrigConv(ADCx, (extTrig != ADC_EXT_TRIG_REG_CONV_SOFTWARE) ? ENABLE : DISABLE);
   
   /* Enable ADC */
   ADC_Enable(ADCx, ENABLE);
@@ -117,9 +212,38 @@ void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_
   while (ADC_GetCalibrationStatus(ADCx, ADC_CALIBRATION_SINGLE_MODE)) {
     // Wait for calibration complete
   }
+}
+
+
+/**
+ * @brief Initialize ADC module with full configuration
+ * 
+ * Performs complete ADC initialization including:
+ * - Clock enable and configuration  
+ * - ADC module initialization and calibration
+ * - Resolution and conversion mode setup
+ * 
+ * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
+ * @param ADC_Channel: ADC channel to configure (e.g., ADC_CH_0, ADC_CH_1, etc.)
+ * @param GPIOx: GPIO port for ADC input (GPIOA, GPIOB, etc.)
+ * @param GPIO_Pin: GPIO pin for ADC input (GPIO_PIN_0, GPIO_PIN_1, etc.)
+ * @param resolution: ADC resolution (6/8/10/12 bit)
+ * @param continuous: true for continuous conversion, false for single
+ * @param sampleTime: ADC sampling time (ADC_SAMP_TIME_CYCLES_1_5 to ADC_SAMP_TIME_CYCLES_601_5)
+ */
+void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_t GPIO_Pin, adc_resolution_t resolution, bool continuous, uint8_t sampleTime)
+{
+
+  adc_gpio_config(GPIOx, GPIO_Pin);
+
+  adc_setup(ADCx, resolution, continuous, 1, ADC_WORKMODE_INDEPENDENT, ADC_EXT_TRIG_REG_CONV_SOFTWARE);
   
   /* Configure ADC channel with user-defined sampling time */
   ADC_ConfigRegularChannel(ADCx, ADC_Channel, 1, sampleTime);
+  if (get_adc_index(ADCx) >= 0) {
+    adc_channel[get_adc_index(ADCx)] = ADC_Channel;
+    adc_sample_time[get_adc_index(ADCx)] = sampleTime;
+  }
   
   /* If continuous mode is enabled, start continuous conversion */
   if (continuous) {
@@ -135,6 +259,9 @@ void adc_init(ADC_Module* ADCx, uint8_t ADC_Channel, GPIO_Module* GPIOx, uint16_
  * - For continuous mode: waits for next conversion completion
  * - For single mode: triggers conversion and waits for completion
  * 
+ * Do not mix with ADC_EVENT_EOS interrupts, the interrupt consumes the flag
+ * this polls; use the callBack instead.
+ * 
  * @param ADCx: ADC module to use (ADC1, ADC2, ADC3, ADC4)
  * @return: Digital conversion result (0-4095 for 12-bit resolution)
  * 
@@ -161,6 +288,7 @@ uint16_t adc_read(ADC_Module* ADCx)
  */
 void adc_start(ADC_Module* ADCx)
 {
+  adc_mark_trigger(ADCx);
   ADC_EnableSoftwareStartConv(ADCx, ENABLE);
 }
 
@@ -178,23 +306,1030 @@ void adc_stop(ADC_Module* ADCx)
  * @brief ADC Test Function - Read voltage from PA0 pin
  * 
  * This function provides a simple test interface for ADC functionality.
- * It initializes ADC1, reads the voltage on PA0 pin, and returns the voltage value.
+ * It reads the voltage on PA0 pin with ADC1 and returns the voltage value.
  * 
- * @return: Voltage value in mV (0-3300mV for 0-3.3V input)
+ * @return: Voltage value in mV, scaled by the reference measured with
+ *          adc_calibrate_vref (nominal 3300mV until then) and the configured resolution
  * 
  * @note: Test Pin: PA0 (ADC1_IN3)
  *        - Connect your test voltage to PA0 pin
- *        - Voltage range: 0V to 3.3V
+ *        - Voltage range: 0V to VDDA
  *        - Resolution: ~0.8mV (12-bit ADC)
  */
 uint16_t adc_test_voltage_pa0(void)
 {
-  /* Read ADC value from PA0 (ADC1_IN3) */
-  uint16_t adc_value = adc_read(ADC1);
-  
-  /* Convert ADC value to voltage (mV) */
-  /* Formula: voltage_mV = (adc_value * 3300) / 4095 */
-  uint32_t voltage_mv = ((uint32_t)adc_value * 3300) / 4095;
+  /* Read ADC value from PA0 (ADC1_IN3), one multiply-add to mV */
+  int32_t voltage_mv = adc_scale_apply(&adc_scales[0], adc_read(ADC1));
   
-  return (uint16_t)voltage_mv;
-}
\ No newline at end of file
+  return (uint16_t)((voltage_mv < 0) ? 0 : voltage_mv);
+}
+
+
+/**
+ * @brief Build a raw to engineering unit scale
+ * 
+ * The result is value = raw * mul + add in Q16, one multiply-accumulate per
+ * sample with everything (reference, resolution, gain and offset) folded in.
+ * 
+ * @param scale: Output
+ * @param vrefMv: ADC reference (VDDA) in mV, see adc_calibrate_vref
+ * @param bits: Resolution in bits, see adc_get_resolution_bits
+ * @param gainQ16: Units per mV at the pin in Q16, ADC_GAIN_UNITY for mV
+ *                 (e.g. 11 * ADC_GAIN_UNITY for a 10k/1k divider)
+ * @param offsetLsb: Raw reading at zero input, subtracted before scaling
+ * @return true on success, false on invalid parameters
+ */
+bool adc_scale_init(adc_scale_t* scale, uint32_t vrefMv, uint8_t bits, int32_t gainQ16, int16_t offsetLsb)
+{
+  int64_t mul;
+
+  if (scale == NULL || vrefMv == 0 || bits == 0 || bits > 16) {
+    return false;
+  }
+  /* mV per LSB is vref / 2^bits, times the gain, kept in Q16 */
+  mul = ((int64_t)vrefMv * gainQ16) >> bits;
+  if (mul > INT32_MAX || mul < -INT32_MAX) {
+    return false;
+  }
+  scale->mul = (int32_t)mul;
+  scale->add = -(int64_t)offsetLsb * mul + 0x8000;
+  return true;
+}
+
+
+/**
+ * @brief Build a scale from two calibration points
+ * 
+ * For sensors calibrated against a reference: raw1 reads value1 and raw2
+ * reads value2, in any units.
+ * 
+ * @return true on success, false if the raw readings are equal
+ */
+bool adc_scale_two_point(adc_scale_t* scale, uint16_t raw1, int32_t value1, uint16_t raw2, int32_t value2)
+{
+  int64_t mul;
+
+  if (scale == NULL || raw1 == raw2) {
+    return false;
+  }
+  mul = (((int64_t)value2 - value1) * 65536) / ((int32_t)raw2 - (int32_t)raw1);
+  if (mul > INT32_MAX || mul < -INT32_MAX) {
+    return false;
+  }
+  scale->mul = (int32_t)mul;
+  scale->add = (int64_t)value1 * 65536 - (int64_t)raw1 * mul + 0x8000;
+  return true;
+}
+
+
+/**
+ * @brief Convert a block of raw samples
+ * @param scale: Scale from adc_scale_init or adc_scale_two_point
+ * @param raw: Samples, e.g. a half buffer of adc_scan_init
+ * @param stride: Distance between samples of the channel (frame size, 1 for one channel)
+ * @param out: count values, contiguous
+ * @param count: Samples to convert
+ */
+void adc_scale_block(const adc_scale_t* scale, const uint16_t* raw, uint8_t stride, int32_t* out, uint16_t count)
+{
+  int32_t mul = scale->mul;
+  int64_t add = scale->add;
+
+  while (count-- > 0) {
+    *out++ = (int32_t)(((int64_t)*raw * mul + add) >> 16);
+    raw += stride;
+  }
+}
+
+
+/**
+ * @brief Measure VDDA through the internal reference and rescale the ADC
+ * 
+ * Converts VREFINT ADC_VREF_SAMPLES times on the ADC's single channel setup
+ * (adc_init), then restores the configured channel. Not available while the
+ * ADC is scanning. The default scale (adc_get_scale, adc_test_voltage_pa0)
+ * is rebuilt for the measured reference.
+ * 
+ * @param ADCx: ADC peripheral with access to VREFINT (ADC_VREFINT_CHANNEL)
+ * @return VDDA in mV, 0 on failure
+ */
+uint32_t adc_calibrate_vref(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+  uint32_t sum = 0;
+  uint32_t vrefMv;
+  uint8_t i;
+
+  if (index < 0 || adc_scans[index].active) {
+    return 0;
+  }
+
+  ADC_EnableTempSensorVrefint(ENABLE);
+  ADC_ConfigRegularChannel(ADCx, ADC_VREFINT_CHANNEL, 1, ADC_VREFINT_SAMPLE_TIME);
+
+  /* Discard the conversions that may still belong to the previous channel */
+  (void)adc_read(ADCx);
+  (void)adc_read(ADCx);
+  for (i = 0; i < ADC_VREF_SAMPLES; i++) {
+    sum += adc_read(ADCx);
+  }
+
+  ADC_ConfigRegularChannel(ADCx, adc_channel[index], 1, adc_sample_time[index]);
+  if (sum == 0) {
+    return 0;
+  }
+
+  /* VREFINT reads vrefint * 2^bits / VDDA */
+  vrefMv = (uint32_t)((((uint64_t)ADC_VREFINT_MV << adc_bits[index]) * ADC_VREF_SAMPLES + sum / 2) / sum);
+  adc_vref_mv[index] = vrefMv;
+  (void)adc_scale_init(&adc_scales[index], vrefMv, adc_bits[index], ADC_GAIN_UNITY, 0);
+  return vrefMv;
+}
+
+
+/**
+ * @brief Reference of an ADC in mV, nominal until adc_calibrate_vref
+ */
+uint32_t adc_get_vref_mv(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  return (index >= 0) ? adc_vref_mv[index] : ADC_VREF_NOMINAL_MV;
+}
+
+
+/**
+ * @brief Configured resolution of an ADC in bits
+ */
+uint8_t adc_get_resolution_bits(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  return (index >= 0) ? adc_bits[index] : 12;
+}
+
+
+/**
+ * @brief Default raw to mV (at the pin) scale of an ADC
+ */
+const adc_scale_t* adc_get_scale(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  return (index >= 0) ? &adc_scales[index] : NULL;
+}
+
+
+/**
+ * @brief Program the regular sequence of an ADC
+ */
+static void adc_scan_sequence(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                              adc_resolution_t resolution, bool continuous, uint32_t workMode, uint32_t extTrig)
+{
+  uint8_t i;
+
+  for (i = 0; i < count; i++) {
+    if (channels[i].GPIOx != NULL) {
+      adc_gpio_config(channels[i].GPIOx, channels[i].pin);
+    }
+  }
+  adc_setup(ADCx, resolution, continuous, count, workMode, extTrig);
+  for (i = 0; i < count; i++) {
+    ADC_ConfigRegularChannel(ADCx, channels[i].channel, (uint8_t)(i + 1), channels[i].sampleTime);
+  }
+}
+
+/**
+ * @brief Circular DMA from the data register of an ADC into a buffer
+ * @param dual: 32-bit packed transfers (dual mode master), 16-bit otherwise
+ */
+static void adc_scan_dma(ADC_Module* ADCx, void* buffer, uint32_t samples, bool dual)
+{
+  DMA_InitType DMA_InitStructure;
+  NVIC_InitType NVIC_InitStructure;
+  DMA_ChannelType* dmaChannel;
+  uint32_t dmaRemap;
+  IRQn_Type dmaIrq;
+
+  if (ADCx == ADC1) {
+    dmaChannel = ADC1_DMA_CH; dmaRemap = ADC1_DMA_REMAP; dmaIrq = ADC1_DMA_IRQn;
+  } else if (ADCx == ADC2) {
+    dmaChannel = ADC2_DMA_CH; dmaRemap = ADC2_DMA_REMAP; dmaIrq = ADC2_DMA_IRQn;
+  } else if (ADCx == ADC3) {
+    dmaChannel = ADC3_DMA_CH; dmaRemap = ADC3_DMA_REMAP; dmaIrq = ADC3_DMA_IRQn;
+  } else {
+    dmaChannel = ADC4_DMA_CH; dmaRemap = ADC4_DMA_REMAP; dmaIrq = ADC4_DMA_IRQn;
+  }
+
+  RCC_EnableAHBPeriphClk(RCC_AHB_PERIPHEN_DMA2, ENABLE);
+  DMA_DeInit(dmaChannel);
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.PeriphAddr     = (uint32_t)&ADCx->DAT;
+  DMA_InitStructure.MemAddr        = (uint32_t)buffer;
+  DMA_InitStructure.Direction      = DMA_DIR_PERIPH_SRC;
+  DMA_InitStructure.BufSize        = samples;
+  DMA_InitStructure.PeriphInc      = DMA_PERIPH_INC_DISABLE;
+  DMA_InitStructure.MemoryInc      = DMA_MEM_INC_ENABLE;
+  DMA_InitStructure.PeriphDataSize = dual ? DMA_PERIPH_DATA_WIDTH_WORD : DMA_PERIPH_DATA_WIDTH_HALFWORD;
+  DMA_InitStructure.MemDataSize    = dual ? DMA_MEM_DATA_WIDTH_WORD : DMA_MEM_DATA_WIDTH_HALFWORD;
+  DMA_InitStructure.CircularMode   = DMA_MODE_CIRCULAR;
+  DMA_InitStructure.Priority       = DMA_PRIORITY_HIGH;
+  DMA_InitStructure.Mem2Mem        = DMA_M2M_DISABLE;
+  DMA_Init(dmaChannel, &DMA_InitStructure);
+  DMA_RequestRemap(dmaRemap, dmaChannel, ENABLE);
+  DMA_ConfigInt(dmaChannel, DMA_INT_HTX | DMA_INT_TXC, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel                   = dmaIrq;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority        = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd                = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  adc_scans[get_adc_index(ADCx)].dmaChannel = dmaChannel;
+  ADC_EnableDMA(ADCx, ENABLE);
+  DMA_EnableChannel(dmaChannel, ENABLE);
+}
+
+
+/**
+ * @brief Sequence plus circular DMA, shared by the software and hardware triggered scans
+ */
+static int adc_scan_config(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                           adc_resolution_t resolution, bool continuous, uint32_t extTrig,
+                           uint16_t* buffer, uint16_t frames, adc_frame_callback_t callBack, void* ctx)
+{
+  int index = get_adc_index(ADCx);
+  adc_scan_t* scan;
+
+  if (index < 0 || channels == NULL || count == 0 || count > ADC_SCAN_MAX_CHANNELS ||
+      buffer == NULL || frames < 2 || (frames & 1) != 0 || (uint32_t)frames * count > 0xFFFF)
+  {
+    return 0;
+  }
+
+  scan = &adc_scans[index];
+  adc_scan_stop(ADCx);
+  adc_scan_sequence(ADCx, channels, count, resolution, continuous, ADC_WORKMODE_INDEPENDENT, extTrig);
+
+  scan->buffer = buffer;
+  scan->frames = frames;
+  scan->channels = count;
+  scan->dual = false;
+  scan->triggered = (extTrig != ADC_EXT_TRIG_REG_CONV_SOFTWARE);
+  scan->callBack = callBack;
+  scan->dualCallBack = NULL;
+  scan->ctx = ctx;
+  scan->overruns = 0;
+
+  adc_scan_dma(ADCx, buffer, (uint32_t)frames * count, false);
+  scan->active = true;
+  return 1;
+}
+
+
+/**
+ * @brief Initialize a multi-channel scan into a circular DMA buffer
+ * 
+ * The regular sequence converts every channel in list order, each with its
+ * own sampling time, and the ADC DMA request moves each result into the
+ * buffer. The buffer holds 'frames' frames of 'count' samples and is reused
+ * forever: when the first half fills the callBack gets those frames while the
+ * DMA fills the second half, and the other way round. Sampling therefore
+ * costs two interrupts per buffer and no CPU time per sample.
+ * 
+ * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
+ * @param channels: Sequence, converted in this order
+ * @param count: Channels in the sequence (1 to ADC_SCAN_MAX_CHANNELS)
+ * @param resolution: ADC resolution (6/8/10/12 bit)
+ * @param continuous: true to restart the sequence back to back, false for one sequence per trigger
+ * @param buffer: frames * count samples, must stay valid while scanning
+ * @param frames: Frames in the buffer, even, frames * count at most 65535
+ * @param callBack: Called with each completed half (may be NULL)
+ * @param ctx: Passed to callBack
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_scan_init(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                  adc_resolution_t resolution, bool continuous,
+                  uint16_t* buffer, uint16_t frames, adc_frame_callback_t callBack, void* ctx)
+{
+  return adc_scan_config(ADCx, channels, count, resolution, continuous, ADC_EXT_TRIG_REG_CONV_SOFTWARE,
+                         buffer, frames, callBack, ctx);
+}
+
+
+/**
+ * @brief Initialize a scan started by a hardware trigger, one frame per trigger
+ * 
+ * Each trigger edge (for example a SHRTIM ADC trigger output set up with
+ * hrpwm_adc_trigger) converts the whole sequence once, so the samples are
+ * taken at a fixed point of the PWM period instead of wherever software
+ * happens to start them. With frames = 2 the callBack runs once per trigger
+ * with that period's frame, the hook for a control loop; larger buffers
+ * batch frames / 2 periods per callBack. No adc_scan_start is needed, the
+ * sequence runs as soon as the trigger source does.
+ * 
+ * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
+ * @param channels: Sequence, converted in this order
+ * @param count: Channels in the sequence (1 to ADC_SCAN_MAX_CHANNELS)
+ * @param resolution: ADC resolution (6/8/10/12 bit)
+ * @param extTrig: Regular trigger source (ADC_EXT_TRIG_REG_CONV_*), not software
+ * @param buffer: frames * count samples, must stay valid while scanning
+ * @param frames: Frames in the buffer, even, frames * count at most 65535
+ * @param callBack: Called with each completed half (may be NULL)
+ * @param ctx: Passed to callBack
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_scan_init_triggered(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                            adc_resolution_t resolution, uint32_t extTrig,
+                            uint16_t* buffer, uint16_t frames, adc_frame_callback_t callBack, void* ctx)
+{
+  if (extTrig == ADC_EXT_TRIG_REG_CONV_SOFTWARE) {
+    return 0;
+  }
+  return adc_scan_config(ADCx, channels, count, resolution, false, extTrig, buffer, frames, callBack, ctx);
+}
+
+
+/**
+ * @brief Start converting the scan sequence
+ * 
+ * In continuous mode the sequence then repeats until adc_scan_stop, otherwise
+ * this runs it once (call again, or use an external trigger, for the next).
+ * Scans from adc_scan_init_triggered ignore it, their trigger starts them.
+ */
+void adc_scan_start(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index >= 0 && adc_scans[index].active && !adc_scans[index].triggered) {
+    adc_mark_trigger(ADCx);
+    ADC_EnableSoftwareStartConv(ADCx, ENABLE);
+  }
+}
+
+
+/**
+ * @brief Stop scanning and release the DMA channel
+ */
+void adc_scan_stop(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+  adc_scan_t* scan;
+
+  if (index < 0) {
+    return;
+  }
+  scan = &adc_scans[index];
+  if (!scan->active) {
+    return;
+  }
+  scan->active = false;
+  ADC_EnableSoftwareStartConv(ADCx, DISABLE);
+  ADC_EnableExternalTrigConv(ADCx, DISABLE);
+  ADC_EnableDMA(ADCx, DISABLE);
+  DMA_ConfigInt(scan->dmaChannel, DMA_INT_HTX | DMA_INT_TXC, DISABLE);
+  DMA_EnableChannel(scan->dmaChannel, DISABLE);
+}
+
+
+/**
+ * @brief Buffer halves overwritten by the DMA before their callBack returned
+ */
+uint32_t adc_scan_overruns(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  return (index >= 0) ? adc_scans[index].overruns : 0;
+}
+
+
+/**
+ * @brief Deliver a completed buffer half, called from the DMA half/full transfer interrupt
+ * @param ADCx: ADC peripheral
+ * @param half: true for the half transfer (first half complete), false for transfer complete
+ */
+void adc_scan_dma_irq(ADC_Module* ADCx, bool half)
+{
+  int index = get_adc_index(ADCx);
+  adc_scan_t* scan;
+  uint16_t halfFrames;
+  uint32_t halfSamples;
+  uint32_t remaining;
+
+  if (index < 0 || !adc_scans[index].active) {
+    return;
+  }
+  scan = &adc_scans[index];
+  halfFrames = scan->frames / 2;
+  halfSamples = (uint32_t)halfFrames * scan->channels;
+
+  if (scan->dual) {
+    if (scan->dualCallBack != NULL) {
+      const uint32_t* words = (const uint32_t*)scan->buffer;
+      scan->dualCallBack(scan->ctx, half ? words : words + halfSamples, halfFrames, scan->channels);
+    }
+  } else if (scan->callBack != NULL) {
+    const uint16_t* samples = (const uint16_t*)scan->buffer;
+    scan->callBack(scan->ctx, half ? samples : samples + halfSamples, halfFrames, scan->channels);
+  }
+
+  /* The DMA must still be in the other half, or it has overwritten this one */
+  remaining = DMA_GetCurrDataCounter(scan->dmaChannel);
+  if (half ? (remaining > halfSamples) : (remaining <= halfSamples)) {
+    scan->overruns++;
+  }
+}
+
+
+/**
+ * @brief Enable conversion interrupts of an ADC
+ * 
+ * ADC1/ADC2 share one interrupt vector and ADC3/ADC4 the other, the priority
+ * applies to the shared vector. The end of the regular sequence is also
+ * signalled to the scheduler (SCHED_SRC_ADC1 to SCHED_SRC_ADC4).
+ * 
+ * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
+ * @param events: ORed adc_event_t to enable
+ * @param callBack: Called for each enabled event (may be NULL)
+ * @param ctx: Passed to callBack
+ * @param priority: NVIC preemption priority
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_interrupt_init(ADC_Module* ADCx, uint32_t events, adc_callback_t callBack, void* ctx, uint8_t priority)
+{
+  NVIC_InitType NVIC_InitStructure;
+  int index = get_adc_index(ADCx);
+  adc_irq_t* irq;
+
+  if (index < 0 || events == 0) {
+    return 0;
+  }
+  irq = &adc_irqs[index];
+  adc_interrupt_disable(ADCx);
+
+  time_init();
+  irq->callBack = callBack;
+  irq->ctx = ctx;
+  irq->timing = false;
+  irq->injTiming = false;
+  irq->interrupts = 0;
+  irq->lastLatencyCycles = 0;
+  irq->maxLatencyCycles = 0;
+  irq->events = events;
+
+  ADC_ClearFlag(ADCx, ADC_FLAG_ENDC | ADC_FLAG_ENDCA | ADC_FLAG_JENDC);
+  if (events & ADC_EVENT_EOC) {
+    ADC_ConfigInt(ADCx, ADC_INT_ENDCA, ENABLE);
+  }
+  if (events & ADC_EVENT_EOS) {
+    ADC_ConfigInt(ADCx, ADC_INT_ENDC, ENABLE);
+  }
+  if (events & ADC_EVENT_INJECTED) {
+    ADC_ConfigInt(ADCx, ADC_INT_JENDC, ENABLE);
+  }
+
+  NVIC_InitStructure.NVIC_IRQChannel                   = (ADCx == ADC1 || ADCx == ADC2) ? ADC1_2_IRQn : ADC3_4_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = priority;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority        = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd                = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+  return 1;
+}
+
+
+/**
+ * @brief Disable the conversion interrupts of an ADC
+ * 
+ * The shared vector stays enabled, the other ADC of the pair may use it.
+ */
+void adc_interrupt_disable(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index < 0) {
+    return;
+  }
+  ADC_ConfigInt(ADCx, ADC_INT_ENDCA | ADC_INT_ENDC | ADC_INT_JENDC, DISABLE);
+  adc_irqs[index].events = 0;
+}
+
+
+/**
+ * @brief Read the interrupt statistics of an ADC
+ */
+void adc_get_irq_stats(ADC_Module* ADCx, adc_irq_stats_t* stats)
+{
+  int index = get_adc_index(ADCx);
+  uint32_t rate = time_cycles_per_us_q16();
+
+  if (index < 0 || stats == NULL) {
+    return;
+  }
+  stats->interrupts = adc_irqs[index].interrupts;
+  stats->lastLatencyUs = (uint32_t)(((uint64_t)adc_irqs[index].lastLatencyCycles << 16) / rate);
+  stats->maxLatencyUs = (uint32_t)(((uint64_t)adc_irqs[index].maxLatencyCycles << 16) / rate);
+}
+
+
+/**
+ * @brief Record the start to callBack latency of a timed conversion
+ */
+static void adc_record_latency(adc_irq_t* irq, uint32_t now, volatile bool* timing, uint32_t trigger)
+{
+  uint32_t latency;
+
+  if (!*timing) {
+    return;
+  }
+  *timing = false;
+  latency = now - trigger;
+  irq->lastLatencyCycles = latency;
+  if (latency > irq->maxLatencyCycles) {
+    irq->maxLatencyCycles = latency;
+  }
+}
+
+
+/**
+ * @brief Watchdog trip: latch, run the protection handler, account
+ */
+static void adc_watchdog_trip(ADC_Module* ADCx, adc_watchdog_t* wd, uint32_t entry)
+{
+  uint32_t action;
+
+  /* Latched until adc_watchdog_rearm, an out of range input would retrigger every conversion */
+  ADC_ConfigInt(ADCx, ADC_INT_AWD, DISABLE);
+  ADC_ClearIntPendingBit(ADCx, ADC_INT_AWD);
+  wd->armed = false;
+  if (wd->handler != NULL) {
+    wd->handler(wd->ctx, ADCx, ADC_GetDat(ADCx));
+  }
+  action = time_cycles32() - entry;
+  wd->trips++;
+  wd->lastActionCycles = action;
+  if (action > wd->maxActionCycles) {
+    wd->maxActionCycles = action;
+  }
+}
+
+
+/**
+ * @brief Conversion interrupt of one ADC, called from the shared handlers
+ * @param ADCx: ADC peripheral
+ */
+void adc_irq(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+  adc_irq_t* irq;
+  uint32_t now;
+
+  if (index < 0) {
+    return;
+  }
+  now = time_cycles32();
+
+  /* Protection first, every other event can wait */
+  if (adc_watchdogs[index].armed && ADC_GetIntStatus(ADCx, ADC_INT_AWD) != RESET) {
+    adc_watchdog_trip(ADCx, &adc_watchdogs[index], now);
+  }
+
+  if (adc_irqs[index].events == 0) {
+    return;
+  }
+  irq = &adc_irqs[index];
+
+  /* Injected first, it pre-empts the regular sequence */
+  if ((irq->events & ADC_EVENT_INJECTED) && ADC_GetIntStatus(ADCx, ADC_INT_JENDC) != RESET) {
+    ADC_ClearIntPendingBit(ADCx, ADC_INT_JENDC);
+    irq->interrupts++;
+    adc_record_latency(irq, now, &irq->injTiming, irq->injTriggerCycles);
+    if (irq->callBack != NULL) {
+      irq->callBack(irq->ctx, ADC_EVENT_INJECTED, ADC_GetInjectedConversionDat(ADCx, ADC_INJ_CH_1));
+    }
+  }
+  if ((irq->events & ADC_EVENT_EOC) && ADC_GetIntStatus(ADCx, ADC_INT_ENDCA) != RESET) {
+    ADC_ClearIntPendingBit(ADCx, ADC_INT_ENDCA);
+    irq->interrupts++;
+    if (!(irq->events & ADC_EVENT_EOS)) {
+      adc_record_latency(irq, now, &irq->timing, irq->triggerCycles);
+    }
+    if (irq->callBack != NULL) {
+      irq->callBack(irq->ctx, ADC_EVENT_EOC, ADC_GetDat(ADCx));
+    }
+  }
+  if ((irq->events & ADC_EVENT_EOS) && ADC_GetIntStatus(ADCx, ADC_INT_ENDC) != RESET) {
+    ADC_ClearIntPendingBit(ADCx, ADC_INT_ENDC);
+    irq->interrupts++;
+    adc_record_latency(irq, now, &irq->timing, irq->triggerCycles);
+    sched_signal((sched_source_t)(SCHED_SRC_ADC1 + index));
+    if (irq->callBack != NULL) {
+      irq->callBack(irq->ctx, ADC_EVENT_EOS, ADC_GetDat(ADCx));
+    }
+  }
+}
+
+
+/**
+ * @brief Configure the injected sequence of an ADC
+ * 
+ * Injected conversions start on adc_injected_start and pre-empt a running
+ * regular sequence or scan, which resumes afterwards. The ADC must already
+ * be set up with adc_init or adc_scan_init.
+ * 
+ * @param ADCx: ADC peripheral (ADC1, ADC2, ADC3, or ADC4)
+ * @param channels: Injected sequence, rank 1 first
+ * @param count: 1 to ADC_INJECTED_MAX
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_injected_init(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count)
+{
+  uint8_t i;
+
+  if (get_adc_index(ADCx) < 0 || channels == NULL || count == 0 || count > ADC_INJECTED_MAX) {
+    return 0;
+  }
+  for (i = 0; i < count; i++) {
+    if (channels[i].GPIOx != NULL) {
+      adc_gpio_config(channels[i].GPIOx, channels[i].pin);
+    }
+  }
+  ADC_ConfigInjectedSequencerLength(ADCx, count);
+  for (i = 0; i < count; i++) {
+    ADC_ConfigInjectedChannel(ADCx, channels[i].channel, (uint8_t)(i + 1), channels[i].sampleTime);
+  }
+  ADC_ConfigExternalTrigInjectedConv(ADCx, ADC_EXT_TRIG_INJ_CONV_SOFTWARE);
+  return 1;
+}
+
+
+/**
+ * @brief Start the injected sequence by software
+ */
+void adc_injected_start(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index < 0) {
+    return;
+  }
+  if (adc_irqs[index].events & ADC_EVENT_INJECTED) {
+    adc_irqs[index].injTriggerCycles = time_cycles32();
+    adc_irqs[index].injTiming = true;
+  }
+  ADC_EnableSoftwareStartInjectedConv(ADCx, ENABLE);
+}
+
+
+/**
+ * @brief Read an injected result
+ * @param rank: 1 to ADC_INJECTED_MAX
+ */
+uint16_t adc_injected_read(ADC_Module* ADCx, uint8_t rank)
+{
+  if (rank == 0 || rank > ADC_INJECTED_MAX) {
+    return 0;
+  }
+  return ADC_GetInjectedConversionDat(ADCx, adcInjRanks[rank - 1]);
+}
+
+
+/**
+ * @brief Run an ADC pair in a dual mode with packed DMA results
+ * 
+ * The master (ADC1 or ADC3) drives its slave (ADC2 or ADC4). In simultaneous
+ * mode both convert their own sequence at the same instant, channel i of the
+ * master paired with channel i of the slave, so for example a cell voltage
+ * and a current are sampled together. In the interleaved modes both convert
+ * the same single channel alternately, doubling the sample rate.
+ * 
+ * Each conversion pair is one 32-bit word in the buffer, master result in the
+ * low half and slave in the high half (adc_dual_master, adc_dual_slave). The
+ * buffer is circular with half/full callBacks as in adc_scan_init; the slave
+ * is stopped with adc_scan_stop on the master.
+ * 
+ * @param master: ADC1 or ADC3
+ * @param mode: Pair work mode
+ * @param masterChannels: Master sequence
+ * @param slaveChannels: Slave sequence, same length (interleaved: the same single channel)
+ * @param count: Channels per ADC, 1 in the interleaved modes
+ * @param resolution: ADC resolution, both ADCs
+ * @param continuous: true to restart the sequence back to back
+ * @param buffer: frames * count words, must stay valid while running
+ * @param frames: Frames in the buffer, even, frames * count at most 65535
+ * @param callBack: Called with each completed half (may be NULL)
+ * @param ctx: Passed to callBack
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_dual_init(ADC_Module* master, adc_dual_mode_t mode,
+                  const adc_scan_channel_t* masterChannels, const adc_scan_channel_t* slaveChannels, uint8_t count,
+                  adc_resolution_t resolution, bool continuous,
+                  uint32_t* buffer, uint16_t frames, adc_dual_callback_t callBack, void* ctx)
+{
+  ADC_Module* slave;
+  adc_scan_t* scan;
+  uint32_t workMode;
+
+  if (master == ADC1) {
+    slave = ADC2;
+  } else if (master == ADC3) {
+    slave = ADC4;
+  } else {
+    return 0;
+  }
+  if (mode == ADC_DUAL_SIMULTANEOUS) {
+    workMode = ADC_WORKMODE_REG_SIMULT;
+  } else if (mode == ADC_DUAL_INTERLEAVED_FAST) {
+    workMode = ADC_WORKMODE_FAST_INTERL;
+  } else if (mode == ADC_DUAL_INTERLEAVED_SLOW) {
+    workMode = ADC_WORKMODE_SLOW_INTERL;
+  } else {
+    return 0;
+  }
+  if (masterChannels == NULL || slaveChannels == NULL || count == 0 || count > ADC_SCAN_MAX_CHANNELS ||
+      (mode != ADC_DUAL_SIMULTANEOUS && count != 1) ||
+      buffer == NULL || frames < 2 || (frames & 1) != 0 || (uint32_t)frames * count > 0xFFFF)
+  {
+    return 0;
+  }
+
+  adc_scan_stop(master);
+  adc_scan_stop(slave);
+
+  /* Slave first, it then waits for the master's start */
+  adc_scan_sequence(slave, slaveChannels, count, resolution, continuous, workMode, ADC_EXT_TRIG_REG_CONV_SOFTWARE);
+  adc_scan_sequence(master, masterChannels, count, resolution, continuous, workMode, ADC_EXT_TRIG_REG_CONV_SOFTWARE);
+
+  scan = &adc_scans[get_adc_index(master)];
+  scan->buffer = buffer;
+  scan->frames = frames;
+  scan->channels = count;
+  scan->dual = true;
+  scan->triggered = false;
+  scan->callBack = NULL;
+  scan->dualCallBack = callBack;
+  scan->ctx = ctx;
+  scan->overruns = 0;
+
+  adc_scan_dma(master, buffer, (uint32_t)frames * count, true);
+  scan->active = true;
+  return 1;
+}
+
+
+/**
+ * @brief Split packed dual mode words into two sample arrays
+ * @param packed: Words from the dual buffer
+ * @param masterOut: count master samples (may be NULL)
+ * @param slaveOut: count slave samples (may be NULL)
+ * @param count: Words to split
+ */
+void adc_dual_split(const uint32_t* packed, uint16_t* masterOut, uint16_t* slaveOut, uint16_t count)
+{
+  while (count-- > 0) {
+    uint32_t word = *packed++;
+    if (masterOut != NULL) {
+      *masterOut++ = adc_dual_master(word);
+    }
+    if (slaveOut != NULL) {
+      *slaveOut++ = adc_dual_slave(word);
+    }
+  }
+}
+
+
+/**
+ * @brief Initialize a power and energy accumulator
+ * @param power: State
+ * @param voltage: Scale of the voltage samples to mV
+ * @param current: Scale of the current samples to mA
+ * @param samplePeriodUs: Time between sample pairs
+ */
+void adc_power_init(adc_power_t* power, const adc_scale_t* voltage, const adc_scale_t* current, uint32_t samplePeriodUs)
+{
+  power->voltage = *voltage;
+  power->current = *current;
+  power->samplePeriodUs = samplePeriodUs;
+  power->windowSumUw = 0;
+  power->windowSamples = 0;
+  power->energyUj = 0;
+  power->energyRestPj = 0;
+  power->lastPowerUw = 0;
+}
+
+
+/**
+ * @brief Accumulate instantaneous power over packed voltage/current pairs
+ * 
+ * Each pair costs two multiply-adds to scale and one multiply for the power,
+ * all in integers. The block sum is folded into the energy total once per
+ * block, so no running power sum is kept that could overflow.
+ * 
+ * @param power: State
+ * @param packed: Dual mode words, voltage on the master and current on the slave
+ * @param stride: Distance between the words of this pair (frame size, 1 for one pair)
+ * @param count: Pairs to process
+ */
+void adc_power_process(adc_power_t* power, const uint32_t* packed, uint8_t stride, uint16_t count)
+{
+  int64_t sum = 0;
+  int64_t p = power->lastPowerUw;
+  uint16_t n;
+
+  for (n = 0; n < count; n++) {
+    uint32_t word = *packed;
+    int32_t mv = adc_scale_apply(&power->voltage, adc_dual_master(word));
+    int32_t ma = adc_scale_apply(&power->current, adc_dual_slave(word));
+
+    p = (int64_t)mv * ma;   /* uW */
+    sum += p;
+    packed += stride;
+  }
+  power->lastPowerUw = p;
+  power->windowSumUw += sum;
+  power->windowSamples += count;
+
+  /* uW * us = pJ, split at 1 uJ so neither product can overflow */
+  power->energyUj += (sum / 1000000) * power->samplePeriodUs;
+  power->energyRestPj += (sum % 1000000) * power->samplePeriodUs;
+  power->energyUj += power->energyRestPj / 1000000;
+  power->energyRestPj %= 1000000;
+}
+
+
+/**
+ * @brief Average power since the previous call, closes the window
+ * @return mW, 0 if no samples were accumulated
+ */
+int32_t adc_power_average_mw(adc_power_t* power)
+{
+  int64_t sum = power->windowSumUw;
+  uint32_t samples = power->windowSamples;
+
+  power->windowSumUw = 0;
+  power->windowSamples = 0;
+  if (samples == 0) {
+    return 0;
+  }
+  return (int32_t)(sum / ((int64_t)samples * 1000));
+}
+
+
+/**
+ * @brief Energy since adc_power_init
+ * @return mJ
+ */
+int64_t adc_power_energy_mj(const adc_power_t* power)
+{
+  return power->energyUj / 1000;
+}
+
+
+/**
+ * @brief Raw reading for a value in the units of a scale, rounded towards the range inside
+ * @param scale: Scale from adc_scale_init or adc_scale_two_point
+ * @param value: Engineering units
+ * @param bits: Resolution, the result is clamped to 0..2^bits-1
+ * @param roundUp: true to round up (low thresholds), false to round down (high thresholds)
+ */
+uint16_t adc_scale_to_raw(const adc_scale_t* scale, int32_t value, uint8_t bits, bool roundUp)
+{
+  int64_t num = (int64_t)value * 65536 - (scale->add - 0x8000);
+  int64_t raw;
+  int64_t top = (1 << bits) - 1;
+
+  if (scale->mul == 0) {
+    return 0;
+  }
+  raw = num / scale->mul;
+  if (roundUp && raw * scale->mul != num && ((num < 0) == (scale->mul < 0))) {
+    raw++;
+  } else if (!roundUp && raw * scale->mul != num && ((num < 0) != (scale->mul < 0))) {
+    raw--;
+  }
+  if (raw < 0) {
+    return 0;
+  }
+  return (uint16_t)((raw > top) ? top : raw);
+}
+
+
+/**
+ * @brief Arm the analog watchdog of an ADC on one channel
+ * 
+ * The comparison runs in hardware on every conversion of the channel,
+ * whether it comes from adc_init, a scan or a dual sequence, so the
+ * reaction time is one conversion plus the interrupt entry instead of the
+ * polling cadence. The first conversion outside [low, high] calls handler
+ * directly from the interrupt, which runs at the highest priority; keep it
+ * to the protective action (e.g. disabling HRPWM outputs). The watchdog then
+ * stays latched off until adc_watchdog_rearm.
+ * 
+ * The ADC1/ADC2 and ADC3/ADC4 vectors are shared with adc_interrupt_init,
+ * which must not lower the priority afterwards.
+ * 
+ * @param ADCx: ADC peripheral, configured before this call
+ * @param channel: Guarded channel (ADC_CH_0, ADC_CH_1, ...)
+ * @param scale: Scale giving low/high units, NULL for raw thresholds
+ * @param low: Lowest allowed value
+ * @param high: Highest allowed value
+ * @param handler: Protection action (interrupt context, may be NULL to only count)
+ * @param ctx: Passed to handler
+ * @return 1 on success, 0 on invalid parameters
+ */
+int adc_watchdog_init(ADC_Module* ADCx, uint8_t channel, const adc_scale_t* scale, int32_t low, int32_t high,
+                      adc_protect_handler_t handler, void* ctx)
+{
+  NVIC_InitType NVIC_InitStructure;
+  int index = get_adc_index(ADCx);
+  adc_watchdog_t* wd;
+  uint16_t rawLow;
+  uint16_t rawHigh;
+
+  if (index < 0 || low > high) {
+    return 0;
+  }
+  if (scale == NULL) {
+    int32_t top = (1 << adc_bits[index]) - 1;
+    rawLow = (uint16_t)((low < 0) ? 0 : ((low > top) ? top : low));
+    rawHigh = (uint16_t)((high < 0) ? 0 : ((high > top) ? top : high));
+  } else if (scale->mul > 0) {
+    rawLow = adc_scale_to_raw(scale, low, adc_bits[index], true);
+    rawHigh = adc_scale_to_raw(scale, high, adc_bits[index], false);
+  } else {
+    /* Falling characteristic, the unit limits swap ends */
+    rawLow = adc_scale_to_raw(scale, high, adc_bits[index], true);
+    rawHigh = adc_scale_to_raw(scale, low, adc_bits[index], false);
+  }
+
+  wd = &adc_watchdogs[index];
+  adc_watchdog_disable(ADCx);
+  time_init();
+  wd->handler = handler;
+  wd->ctx = ctx;
+  wd->trips = 0;
+  wd->lastActionCycles = 0;
+  wd->maxActionCycles = 0;
+
+  ADC_ConfigAnalogWatchdogThresholds(ADCx, rawHigh, rawLow);
+  ADC_ConfigAnalogWatchdogSingleChannel(ADCx, channel);
+  ADC_ConfigAnalogWatchdogWorkChannelType(ADCx, ADC_AWDG_SINGLE_REG_ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel                   = (ADCx == ADC1 || ADCx == ADC2) ? ADC1_2_IRQn : ADC3_4_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority        = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd                = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  adc_watchdog_rearm(ADCx);
+  return 1;
+}
+
+
+/**
+ * @brief Re-enable a tripped watchdog, after the fault has been handled
+ */
+void adc_watchdog_rearm(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index < 0) {
+    return;
+  }
+  ADC_ClearFlag(ADCx, ADC_FLAG_AWDG);
+  adc_watchdogs[index].armed = true;
+  ADC_ConfigInt(ADCx, ADC_INT_AWD, ENABLE);
+}
+
+
+/**
+ * @brief Stop the analog watchdog of an ADC
+ */
+void adc_watchdog_disable(ADC_Module* ADCx)
+{
+  int index = get_adc_index(ADCx);
+
+  if (index < 0) {
+    return;
+  }
+  ADC_ConfigInt(ADCx, ADC_INT_AWD, DISABLE);
+  ADC_ConfigAnalogWatchdogWorkChannelType(ADCx, ADC_AWDG_NONE);
+  adc_watchdogs[index].armed = false;
+}
+
+
+/**
+ * @brief Watchdog trip count and trip-to-action time
+ */
+void adc_get_watchdog_stats(ADC_Module* ADCx, adc_watchdog_stats_t* stats)
+{
+  int index = get_adc_index(ADCx);
+  uint32_t rate = time_cycles_per_us_q16();
+
+  if (index < 0 || stats == NULL) {
+    return;
+  }
+  stats->trips = adc_watchdogs[index].trips;
+  stats->armed = adc_watchdogs[index].armed;
+  stats->lastActionNs = (uint32_t)((((uint64_t)adc_watchdogs[index].lastActionCycles * 1000) << 16) / rate);
+  stats->maxActionNs = (uint32_t)((((uint64_t)adc_watchdogs[index].maxActionCycles * 1000) << 16) / rate);
+}
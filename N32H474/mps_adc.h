@@ -7,9 +7,49 @@ extern "C" {
 
 #include "n32h47x_48x_adc.h"
 #include "n32h47x_48x_gpio.h"
+#include "n32h47x_48x_dma.h"
 #include <stdbool.h>
 #include <stddef.h>
 
+/* Scan DMA channels, one DMA2 channel per ADC */
+#define ADC1_DMA_CH              DMA2_CH1
+#define ADC1_DMA_REMAP           DMA_REMAP_ADC1
+#define ADC1_DMA_IRQn            DMA2_Channel1_IRQn
+#define ADC1_DMA_TC_FLAG         DMA_FLAG_TC1
+#define ADC1_DMA_HT_FLAG         DMA_FLAG_HT1
+
+#define ADC2_DMA_CH              DMA2_CH2
+#define ADC2_DMA_REMAP           DMA_REMAP_ADC2
+#define ADC2_DMA_IRQn            DMA2_Channel2_IRQn
+#define ADC2_DMA_TC_FLAG         DMA_FLAG_TC2
+#define ADC2_DMA_HT_FLAG         DMA_FLAG_HT2
+
+#define ADC3_DMA_CH              DMA2_CH3
+#define ADC3_DMA_REMAP           DMA_REMAP_ADC3
+#define ADC3_DMA_IRQn            DMA2_Channel3_IRQn
+#define ADC3_DMA_TC_FLAG         DMA_FLAG_TC3
+#define ADC3_DMA_HT_FLAG         DMA_FLAG_HT3
+
+#define ADC4_DMA_CH              DMA2_CH4
+#define ADC4_DMA_REMAP           DMA_REMAP_ADC4
+#define ADC4_DMA_IRQn            DMA2_Channel4_IRQn
+#define ADC4_DMA_TC_FLAG         DMA_FLAG_TC4
+#define ADC4_DMA_HT_FLAG         DMA_FLAG_HT4
+
+#define ADC_SCAN_MAX_CHANNELS    16      /* Regular sequence length */
+
+/* Reference calibration */
+#define ADC_VREF_NOMINAL_MV      3300    /* VDDA assumed until adc_calibrate_vref */
+#define ADC_VREFINT_MV           1200    /* Internal reference, typical */
+#ifndef ADC_VREFINT_CHANNEL
+#define ADC_VREFINT_CHANNEL      ADC_CH_18
+#endif
+#define ADC_VREFINT_SAMPLE_TIME  ADC_SAMP_TIME_CYCLES_239_5
+#define ADC_VREF_SAMPLES         16
+#define ADC_GAIN_UNITY           65536   /* adc_scale_init gain 1.0 in Q16 */
+
+#define ADC_INJECTED_MAX         4       /* Injected sequence length */
+
 
 typedef enum {
   ADC_RESOLUTION_6BIT = 0,      // 6-bit resolution (0-63, fastest)
@@ -18,6 +58,112 @@ typedef enum {
   ADC_RESOLUTION_12BIT          // 12-bit resolution (0-4095, highest precision)
 } adc_resolution_t;
 
+/**
+ * @brief One entry of a scan sequence
+ */
+typedef struct {
+  uint8_t channel;              // ADC channel (ADC_CH_0, ADC_CH_1, ...)
+  uint8_t sampleTime;           // ADC_SAMP_TIME_CYCLES_1_5 to ADC_SAMP_TIME_CYCLES_601_5
+  GPIO_Module* GPIOx;           // Input pin port, NULL for internal channels
+  uint16_t pin;
+} adc_scan_channel_t;
+
+/**
+ * @brief Raw to engineering unit conversion, value = (raw * mul + add) >> 16
+ */
+typedef struct {
+  int32_t mul;                  // Units per LSB, Q16
+  int64_t add;                  // Offset and rounding, Q16
+} adc_scale_t;
+
+/**
+ * @brief Dual work modes of an ADC pair (ADC1/ADC2, ADC3/ADC4)
+ */
+typedef enum {
+  ADC_DUAL_SIMULTANEOUS = 0,    // Both sequences convert at the same instant
+  ADC_DUAL_INTERLEAVED_FAST,    // Same channel, alternating, short delay
+  ADC_DUAL_INTERLEAVED_SLOW     // Same channel, alternating, long delay
+} adc_dual_mode_t;
+
+/**
+ * @brief Dual mode frame callBack (DMA interrupt context)
+ * @param frames: First frame, one packed word per channel pair
+ * @param frameCount: Frames delivered, half of the buffer
+ * @param channels: Words per frame
+ */
+typedef void (*adc_dual_callback_t)(void* ctx, const uint32_t* frames, uint16_t frameCount, uint8_t channels);
+
+/**
+ * @brief ADC interrupt events
+ */
+typedef enum {
+  ADC_EVENT_EOC = 0x01,         // End of each regular conversion
+  ADC_EVENT_EOS = 0x02,         // End of the regular sequence
+  ADC_EVENT_INJECTED = 0x04     // End of the injected sequence
+} adc_event_t;
+
+/**
+ * @brief ADC interrupt callBack (interrupt context)
+ * @param event: Event that fired
+ * @param value: Regular data register, or injected rank 1 for ADC_EVENT_INJECTED
+ */
+typedef void (*adc_callback_t)(void* ctx, adc_event_t event, uint16_t value);
+
+/**
+ * @brief ADC interrupt statistics
+ * 
+ * Latency runs from the software start (adc_start, adc_scan_start,
+ * adc_injected_start) to the callBack and includes the conversion time.
+ * Hardware triggered conversions are counted but not timed.
+ */
+typedef struct {
+  uint32_t interrupts;
+  uint32_t lastLatencyUs;
+  uint32_t maxLatencyUs;
+} adc_irq_stats_t;
+
+/**
+ * @brief Power and energy accumulator over voltage/current sample pairs
+ */
+typedef struct {
+  adc_scale_t voltage;          // Raw to mV
+  adc_scale_t current;          // Raw to mA
+  uint32_t samplePeriodUs;
+  int64_t windowSumUw;          // Power summed since adc_power_average_mw
+  uint32_t windowSamples;
+  int64_t energyUj;             // Energy since adc_power_init
+  int64_t energyRestPj;         // Part below 1 uJ, carried into the next block
+  int64_t lastPowerUw;          // Latest instantaneous power
+} adc_power_t;
+
+/**
+ * @brief Analog watchdog protection handler (highest priority interrupt)
+ * @param raw: Data register at the trip
+ */
+typedef void (*adc_protect_handler_t)(void* ctx, ADC_Module* ADCx, uint16_t raw);
+
+/**
+ * @brief Analog watchdog statistics
+ * 
+ * The action time runs from the watchdog interrupt entry to the return of
+ * the protection handler; the hardware adds the conversion in progress and
+ * the interrupt entry (12 core cycles) before it.
+ */
+typedef struct {
+  uint32_t trips;
+  bool armed;
+  uint32_t lastActionNs;
+  uint32_t maxActionNs;
+} adc_watchdog_stats_t;
+
+/**
+ * @brief Scan frame callBack (DMA interrupt context)
+ * @param frames: First frame, channel samples interleaved in sequence order
+ * @param frameCount: Frames delivered, half of the buffer
+ * @param channels: Samples per frame
+ */
+typedef void (*adc_frame_callback_t)(void* ctx, const uint16_t* frames, uint16_t frameCount, uint8_t channels);
+
 
 void adc_init(ADC_Module* ADCx,uint8_t ADC_Channel,GPIO_Module* GPIOx, uint16_t GPIO_Pin, adc_resolution_t resolution, bool continuous, uint8_t sampleTime);
 uint16_t adc_read(ADC_Module* ADCx);
@@ -26,6 +172,74 @@ void adc_stop(ADC_Module* ADCx);
 void adc_gpio_config(GPIO_Module* GPIOx, uint16_t GpioPin);
 uint16_t adc_test_voltage_pa0(void);
 
+/**
+ * @brief Convert one raw sample, a single multiply-accumulate
+ */
+static inline int32_t adc_scale_apply(const adc_scale_t* scale, uint16_t raw)
+{
+  return (int32_t)(((int64_t)raw * scale->mul + scale->add) >> 16);
+}
+
+bool adc_scale_init(adc_scale_t* scale, uint32_t vrefMv, uint8_t bits, int32_t gainQ16, int16_t offsetLsb);
+bool adc_scale_two_point(adc_scale_t* scale, uint16_t raw1, int32_t value1, uint16_t raw2, int32_t value2);
+void adc_scale_block(const adc_scale_t* scale, const uint16_t* raw, uint8_t stride, int32_t* out, uint16_t count);
+uint16_t adc_scale_to_raw(const adc_scale_t* scale, int32_t value, uint8_t bits, bool roundUp);
+uint32_t adc_calibrate_vref(ADC_Module* ADCx);
+uint32_t adc_get_vref_mv(ADC_Module* ADCx);
+uint8_t adc_get_resolution_bits(ADC_Module* ADCx);
+const adc_scale_t* adc_get_scale(ADC_Module* ADCx);
+
+int adc_scan_init(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                  adc_resolution_t resolution, bool continuous,
+                  uint16_t* buffer, uint16_t frames, adc_frame_callback_t callBack, void* ctx);
+int adc_scan_init_triggered(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count,
+                            adc_resolution_t resolution, uint32_t extTrig,
+                            uint16_t* buffer, uint16_t frames, adc_frame_callback_t callBack, void* ctx);
+void adc_scan_start(ADC_Module* ADCx);
+void adc_scan_stop(ADC_Module* ADCx);
+uint32_t adc_scan_overruns(ADC_Module* ADCx);
+void adc_scan_dma_irq(ADC_Module* ADCx, bool half);
+
+int adc_dual_init(ADC_Module* master, adc_dual_mode_t mode,
+                  const adc_scan_channel_t* masterChannels, const adc_scan_channel_t* slaveChannels, uint8_t count,
+                  adc_resolution_t resolution, bool continuous,
+                  uint32_t* buffer, uint16_t frames, adc_dual_callback_t callBack, void* ctx);
+void adc_dual_split(const uint32_t* packed, uint16_t* masterOut, uint16_t* slaveOut, uint16_t count);
+
+/**
+ * @brief Master result of a packed dual mode word
+ */
+static inline uint16_t adc_dual_master(uint32_t word)
+{
+  return (uint16_t)(word & 0xFFFF);
+}
+
+/**
+ * @brief Slave result of a packed dual mode word
+ */
+static inline uint16_t adc_dual_slave(uint32_t word)
+{
+  return (uint16_t)(word >> 16);
+}
+
+void adc_power_init(adc_power_t* power, const adc_scale_t* voltage, const adc_scale_t* current, uint32_t samplePeriodUs);
+void adc_power_process(adc_power_t* power, const uint32_t* packed, uint8_t stride, uint16_t count);
+int32_t adc_power_average_mw(adc_power_t* power);
+int64_t adc_power_energy_mj(const adc_power_t* power);
+
+int adc_interrupt_init(ADC_Module* ADCx, uint32_t events, adc_callback_t callBack, void* ctx, uint8_t priority);
+void adc_interrupt_disable(ADC_Module* ADCx);
+void adc_get_irq_stats(ADC_Module* ADCx, adc_irq_stats_t* stats);
+void adc_irq(ADC_Module* ADCx);
+int adc_watchdog_init(ADC_Module* ADCx, uint8_t channel, const adc_scale_t* scale, int32_t low, int32_t high,
+                      adc_protect_handler_t handler, void* ctx);
+void adc_watchdog_rearm(ADC_Module* ADCx);
+void adc_watchdog_disable(ADC_Module* ADCx);
+void adc_get_watchdog_stats(ADC_Module* ADCx, adc_watchdog_stats_t* stats);
+int adc_injected_init(ADC_Module* ADCx, const adc_scan_channel_t* channels, uint8_t count);
+void adc_injected_start(ADC_Module* ADCx);
+uint16_t adc_injected_read(ADC_Module* ADCx, uint8_t rank);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,82 +1,108 @@
 #include "mps_delay.h"
-#include "misc.h"
-#include "n32h47x_48x_rcc.h"
-unsigned char frequency;//command frequency
-static __inline void DWT_Delay_us(volatile uint32_t microseconds);
+#include "mps_time.h"
+
+#define DELAY_CHUNK_CYCLES  0x40000000u   /* Longest single wait, well inside the 32-bit counter */
+
+static uint32_t delayOverhead = 0;        /* Cycles spent in call, conversion and exit check */
+
+/**
+ * @brief Busy wait on the cycle counter
+ *
+ * The exit check compares the elapsed count, so a counter wrap during the
+ * wait is harmless. Waits longer than DELAY_CHUNK_CYCLES are split.
+ */
+static void delay_spin(uint32_t start, uint64_t cycles)
+{
+  while (cycles > DELAY_CHUNK_CYCLES)
+  {
+    while ((time_cycles32() - start) < DELAY_CHUNK_CYCLES);
+    start += DELAY_CHUNK_CYCLES;
+    cycles -= DELAY_CHUNK_CYCLES;
+  }
+  while ((time_cycles32() - start) < (uint32_t)cycles);
+}
+
 /**
- *\*\name    DBG_SysTick_Config.
- *\*\fun     System tick configuration.
- *\*\param   ticks :system tick
- *\*\return  none
-**/
-static uint32_t DBG_SysTick_Config(uint32_t ticks)
-{ 
-  if (ticks > SysTick_LOAD_RELOAD_Msk)  return (1);            /* Reload value impossible */
-   
-  SysTick->LOAD  = (ticks & SysTick_LOAD_RELOAD_Msk) - 1;      /* set reload register */
-  //NVIC_SetPriority (SysTick_IRQn, (1<<__NVIC_PRIO_BITS) - 1);  /* set Priority for Cortex-M4 System Interrupts */
-  SysTick->VAL   = 0;                                          /* Load the SysTick Counter Value */
-  SysTick->CTRL  = SysTick_CTRL_CLKSOURCE_Msk | 
-   SysTick_CTRL_ENABLE_Msk;                    /* Enable SysTick IRQ and SysTick Timer */
-  SysTick->CTRL  &= (~SysTick_CTRL_TICKINT_Msk);
-  return (0);                                                  /* Function successful */
+ * @brief Subtract the call overhead from a delay
+ */
+static inline uint64_t delay_net(uint64_t cycles)
+{
+  return (cycles > delayOverhead) ? cycles - delayOverhead : 0;
 }
 
 /**
- *\*\name    systick_delay_us.
- *\*\fun     microsecond delay.
- *\*\param   us :any number
- *\*\return  none
-**/
-void systick_delay_us(uint32_t us)
+ * @brief Initialize the delay service
+ *
+ * Starts the timebase and caches the core clock. Also measures the fixed cost
+ * of a delay call, which every delay then subtracts, so short delays keep
+ * sub-microsecond accuracy. Call again after changing the system clock.
+ */
+void delay_init(void)
 {
+  uint32_t start;
   uint32_t i;
-  RCC_ClocksType RCC_Clocks;
+  uint32_t best = 0xFFFFFFFFu;
 
-  RCC_GetClocksFreqValue(&RCC_Clocks);
-  DBG_SysTick_Config(RCC_Clocks.SysclkFreq / 1000000);
+  time_init();
 
-  for(i = 0; i < us; i++)
+  /* Shortest of a few zero length delays, the first runs with a cold cache */
+  delayOverhead = 0;
+  for (i = 0; i < 4; i++)
   {
-  /* When the counter value decreases to 0, bit 16 of the CRTL register will be set to 1 */
-  /* When set to 1, reading this bit will clear it to 0 */
-  while( !((SysTick->CTRL) & (1 << 16)));
+    uint32_t elapsed;
+
+    start = time_cycles32();
+    delay_cycles(0);
+    elapsed = time_cycles32() - start;
+    if (elapsed < best)
+    {
+      best = elapsed;
+    }
   }
-  /* Turn off the SysTick timer */
-  SysTick->CTRL &= (~SysTick_CTRL_ENABLE_Msk);
+  delayOverhead = best;
 }
 
 /**
- *\*\name    systick_delay_ms.
- *\*\fun     millisecond delay.
- *\*\param   ms :any number
- *\*\return  none
-**/
-void systick_delay_ms(uint32_t ms)
+ * @brief Busy wait a number of core cycles
+ * @param cycles - delay in cycles, the call overhead included
+ */
+void delay_cycles(uint32_t cycles)
 {
-  uint32_t i;
-  RCC_ClocksType RCC_Clocks;
-  
-  RCC_GetClocksFreqValue(&RCC_Clocks);
-  DBG_SysTick_Config(RCC_Clocks.SysclkFreq / 1000);
+  uint32_t start = time_cycles32();
 
-  for(i = 0; i < ms; i++)
-  {
-  /* When the counter value decreases to 0, bit 16 of the CRTL register will be set to 1 */
-  /* When set to 1, reading this bit will clear it to 0 */
-  while( !((SysTick->CTRL) & (1 << 16)));
-  }
-  /* Turn off the SysTick timer */
-  SysTick->CTRL &= (~SysTick_CTRL_ENABLE_Msk);
+  delay_spin(start, delay_net(cycles));
+}
+
+/**
+ * @brief Busy wait a number of nanoseconds
+ * @param ns - delay, resolution one core cycle
+ */
+void delay_ns(uint32_t ns)
+{
+  uint32_t start = time_cycles32();
+
+  /* Rounded to the nearest cycle, ns * cycles/us / 1000 */
+  delay_spin(start, delay_net((((uint64_t)ns * time_cycles_per_us_q16()) / 1000 + 0x8000) >> 16));
 }
 
-static __inline void DWT_Delay_us(volatile uint32_t microseconds)
+/**
+ * @brief Busy wait a number of microseconds
+ * @param us - delay
+ */
+void delay_us(uint32_t us)
 {
-  uint32_t clk_cycle_start = DWT->CYCCNT;
+  uint32_t start = time_cycles32();
+
+  delay_spin(start, delay_net(((uint64_t)us * time_cycles_per_us_q16() + 0x8000) >> 16));
+}
 
-  /* Go to number of cycles for system */
-  microseconds *= (frequency);
+/**
+ * @brief Busy wait a number of milliseconds
+ * @param ms - delay
+ */
+void delay_ms(uint32_t ms)
+{
+  uint32_t start = time_cycles32();
 
-  /* Delay till end */
-  while ((DWT->CYCCNT - clk_cycle_start) < microseconds);
+  delay_spin(start, delay_net(time_us_to_cycles((uint64_t)ms * 1000)));
 }
@@ -57,15 +57,22 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
 #include "n32h47x_48x.h"
+#else
+#include <stdint.h>
+#endif
 
-/* 延时函数 */
-void systick_delay_us(uint32_t us);
-void systick_delay_ms(uint32_t ms);
+/* 延时函数，DWT周期计数器忙等待，不占用SysTick */
+void delay_init(void);
+void delay_cycles(uint32_t cycles);
+void delay_ns(uint32_t ns);
+void delay_us(uint32_t us);
+void delay_ms(uint32_t ms);
 
-/* 为了兼容性，提供delay_us和delay_ms的宏定义 */
-#define delay_us(us)     systick_delay_us(us)
-#define delay_ms(ms)     systick_delay_ms(ms)
+/* 为了兼容性，保留systick_delay_us和systick_delay_ms的名称 */
+#define systick_delay_us(us)     delay_us(us)
+#define systick_delay_ms(ms)     delay_ms(ms)
 
 /* 外部变量声明 */
 extern uint16_t balance_Current_GUI;
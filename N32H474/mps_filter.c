@@ -0,0 +1,298 @@
+#include "mps_filter.h"
+
+/**
+ * @brief log2 of a power of two, -1 otherwise
+ */
+static int filter_log2(uint32_t value)
+{
+  int bits = 0;
+
+  if (value == 0 || (value & (value - 1)) != 0)
+  {
+    return -1;
+  }
+  while ((value >>= 1) != 0)
+  {
+    bits++;
+  }
+  return bits;
+}
+
+/**
+ * @brief Initialize a boxcar decimator
+ * @param filter - state
+ * @param ratio - inputs per output, 1 to 65535
+ * @return true on success, false on invalid parameters
+ */
+bool filter_boxcar_init(filter_boxcar_t* filter, uint16_t ratio)
+{
+  int bits = filter_log2(ratio);
+
+  if (filter == NULL || ratio == 0)
+  {
+    return false;
+  }
+  filter->ratio = ratio;
+  filter->count = 0;
+  filter->sum = 0;
+  if (bits >= 0)
+  {
+    filter->shift = (uint8_t)bits;
+    filter->scale = 0;
+  }
+  else
+  {
+    /* Reciprocal normalized to 32 significant bits, rounded. Its error adds
+       less than 2^-16 LSB to the output rounding, for any 16-bit inputs */
+    bits = 0;
+    while ((ratio >> (bits + 1)) != 0)
+    {
+      bits++;
+    }
+    filter->shift = (uint8_t)(32 + bits);
+    filter->scale = (uint32_t)(((1ULL << filter->shift) + ratio / 2) / ratio);
+  }
+  return true;
+}
+
+/**
+ * @brief Average each group of 'ratio' samples into one
+ * @param filter - state
+ * @param data - block, outputs are written compacted to its start
+ * @param count - samples in the block
+ * @param stride - distance between samples of the channel
+ * @return outputs written
+ */
+uint16_t filter_boxcar_process(filter_boxcar_t* filter, uint16_t* data, uint16_t count, uint8_t stride)
+{
+  const uint16_t* in = data;
+  uint16_t* out = data;
+  uint16_t outputs = 0;
+  uint32_t sum = filter->sum;
+  uint16_t n = filter->count;
+
+  while (count-- > 0)
+  {
+    sum += *in;
+    in += stride;
+    if (++n == filter->ratio)
+    {
+      if (filter->scale == 0)
+      {
+        *out = (uint16_t)((sum + ((1u << filter->shift) >> 1)) >> filter->shift);
+      }
+      else
+      {
+        /* Rounded like the shift, sum * scale stays below 2^63 */
+        *out = (uint16_t)(((uint64_t)sum * filter->scale + (1ULL << (filter->shift - 1))) >> filter->shift);
+      }
+      out += stride;
+      outputs++;
+      sum = 0;
+      n = 0;
+    }
+  }
+  filter->sum = sum;
+  filter->count = n;
+  return outputs;
+}
+
+/**
+ * @brief Initialize a CIC decimator
+ * @param filter - state
+ * @param order - integrator/comb stages, 1 to FILTER_CIC_MAX_ORDER
+ * @param ratio - decimation, power of two
+ * @return true on success, false on invalid parameters or a gain above 2^20
+ * @note Sized for ADC samples of up to 12 bits
+ */
+bool filter_cic_init(filter_cic_t* filter, uint8_t order, uint16_t ratio)
+{
+  int bits = filter_log2(ratio);
+  uint8_t i;
+
+  /* 12-bit samples plus the register growth must fit the 32-bit integrators */
+  if (filter == NULL || order == 0 || order > FILTER_CIC_MAX_ORDER || bits < 0 || order * bits > 20)
+  {
+    return false;
+  }
+  filter->order = order;
+  filter->ratio = ratio;
+  filter->shift = (uint8_t)(order * bits);
+  filter->count = 0;
+  for (i = 0; i < FILTER_CIC_MAX_ORDER; i++)
+  {
+    filter->integrator[i] = 0;
+    filter->comb[i] = 0;
+  }
+  return true;
+}
+
+/**
+ * @brief Decimate a block through the CIC filter
+ * @param filter - state
+ * @param data - block, outputs are written compacted to its start
+ * @param count - samples in the block
+ * @param stride - distance between samples of the channel
+ * @return outputs written
+ */
+uint16_t filter_cic_process(filter_cic_t* filter, uint16_t* data, uint16_t count, uint8_t stride)
+{
+  const uint16_t* in = data;
+  uint16_t* out = data;
+  uint16_t outputs = 0;
+  uint8_t order = filter->order;
+  uint8_t k;
+
+  while (count-- > 0)
+  {
+    uint32_t acc = *in;
+
+    in += stride;
+    for (k = 0; k < order; k++)
+    {
+      filter->integrator[k] += acc;
+      acc = filter->integrator[k];
+    }
+    if (++filter->count == filter->ratio)
+    {
+      filter->count = 0;
+      for (k = 0; k < order; k++)
+      {
+        uint32_t previous = filter->comb[k];
+        filter->comb[k] = acc;
+        acc -= previous;
+      }
+      *out = (uint16_t)(acc >> filter->shift);
+      out += stride;
+      outputs++;
+    }
+  }
+  return outputs;
+}
+
+/**
+ * @brief Initialize a first-order IIR low pass
+ * @param filter - state
+ * @param alphaQ15 - smoothing factor in Q15, 1 to 32767 (cut-off ~ alpha * fs / 2pi)
+ * @return true on success, false on invalid parameters
+ */
+bool filter_iir_init(filter_iir_t* filter, int16_t alphaQ15)
+{
+  if (filter == NULL || alphaQ15 <= 0)
+  {
+    return false;
+  }
+  filter->alphaQ15 = alphaQ15;
+  filter->y = 0;
+  filter->primed = false;
+  return true;
+}
+
+/**
+ * @brief Low pass a block in place
+ * @param filter - state
+ * @param data - block
+ * @param count - samples in the block
+ * @param stride - distance between samples of the channel
+ * @return count
+ */
+uint16_t filter_iir_process(filter_iir_t* filter, uint16_t* data, uint16_t count, uint8_t stride)
+{
+  uint16_t* p = data;
+  int32_t y = filter->y;
+  int32_t alpha = filter->alphaQ15;
+  uint16_t n;
+
+  if (count > 0 && !filter->primed)
+  {
+    y = (int32_t)data[0] << 15;
+    filter->primed = true;
+  }
+  for (n = 0; n < count; n++)
+  {
+    /* Both terms are below 2^31, so the error fits; times alpha in Q15, back to Q15 */
+    int32_t error = ((int32_t)*p << 15) - y;
+    y += (int32_t)(((int64_t)error * alpha) >> 15);
+    *p = (uint16_t)((y + 0x4000) >> 15);
+    p += stride;
+  }
+  filter->y = y;
+  return count;
+}
+
+/**
+ * @brief Initialize a running median
+ * @param filter - state
+ * @param size - window, odd, 1 to FILTER_MEDIAN_MAX
+ * @return true on success, false on invalid parameters
+ */
+bool filter_median_init(filter_median_t* filter, uint8_t size)
+{
+  if (filter == NULL || size == 0 || size > FILTER_MEDIAN_MAX || (size & 1) == 0)
+  {
+    return false;
+  }
+  filter->size = size;
+  filter->fill = 0;
+  filter->pos = 0;
+  return true;
+}
+
+/**
+ * @brief Replace each sample by the median of the window ending at it
+ *
+ * The window is kept sorted, so each sample costs one removal and one
+ * insertion of at most 'size' moves. Until the window has filled the median
+ * of the samples seen so far is used.
+ *
+ * @param filter - state
+ * @param data - block
+ * @param count - samples in the block
+ * @param stride - distance between samples of the channel
+ * @return count
+ */
+uint16_t filter_median_process(filter_median_t* filter, uint16_t* data, uint16_t count, uint8_t stride)
+{
+  uint16_t* p = data;
+  uint16_t* sorted = filter->sorted;
+  uint16_t n;
+
+  for (n = 0; n < count; n++)
+  {
+    uint16_t x = *p;
+    uint8_t fill = filter->fill;
+    uint8_t i;
+
+    if (fill == filter->size)
+    {
+      /* Drop the oldest sample from the sorted window */
+      uint16_t old = filter->history[filter->pos];
+      for (i = 0; sorted[i] != old; i++)
+      {
+      }
+      for (; i + 1 < fill; i++)
+      {
+        sorted[i] = sorted[i + 1];
+      }
+      fill--;
+    }
+
+    /* Insert the new one */
+    i = fill;
+    while (i > 0 && sorted[i - 1] > x)
+    {
+      sorted[i] = sorted[i - 1];
+      i--;
+    }
+    sorted[i] = x;
+    fill++;
+
+    filter->history[filter->pos] = x;
+    filter->pos = (uint8_t)((filter->pos + 1 == filter->size) ? 0 : filter->pos + 1);
+    filter->fill = fill;
+
+    *p = sorted[fill / 2];
+    p += stride;
+  }
+  return count;
+}
@@ -0,0 +1,96 @@
+#ifndef __MPS_FILTER_H__
+#define __MPS_FILTER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Streaming fixed-point filters for ADC sample blocks
+ *
+ * Every filter works in place on a block of raw samples, for example a half
+ * buffer delivered by adc_scan_init. With interleaved multi-channel frames
+ * pass the channel's first sample and the frame size as stride; each channel
+ * needs its own filter state. State carries over between blocks, so block
+ * boundaries are invisible in the output.
+ *
+ * Decimating filters (boxcar, CIC) write their outputs compacted to the
+ * start of the block (same stride) and return how many they wrote. The
+ * others replace each sample and return the block length.
+ *
+ * No floating point, no division per sample: gains are powers of two, Q15
+ * multipliers or rounded reciprocals.
+ */
+
+#define FILTER_CIC_MAX_ORDER     4
+#define FILTER_MEDIAN_MAX        9        /* Median window, odd */
+
+/**
+ * @brief Boxcar (moving sum) decimator, one output per 'ratio' inputs
+ */
+typedef struct {
+  uint16_t ratio;
+  uint16_t count;               /* Inputs summed so far */
+  uint32_t sum;
+  uint32_t scale;               /* 2^shift / ratio, used when ratio is not a power of two */
+  uint8_t shift;                /* log2(ratio) when it is, else 32 + floor(log2(ratio)) */
+} filter_boxcar_t;
+
+/**
+ * @brief CIC decimator, 'order' integrators at the input rate and combs at the output rate
+ *
+ * Gain is ratio^order, removed by a right shift, so ratio must be a power of
+ * two. Integrators wrap modulo 2^32 by design; the output is exact as long as
+ * input bits + order * log2(ratio) <= 32; filter_cic_init allows a gain up to
+ * 2^20 for 12-bit samples (order 4 up to ratio 32, order 2 up to ratio 1024).
+ */
+typedef struct {
+  uint8_t order;
+  uint8_t shift;                /* order * log2(ratio) */
+  uint16_t ratio;
+  uint16_t count;
+  uint32_t integrator[FILTER_CIC_MAX_ORDER];
+  uint32_t comb[FILTER_CIC_MAX_ORDER];      /* Previous comb inputs */
+} filter_cic_t;
+
+/**
+ * @brief First-order IIR low pass, y += alpha * (x - y)
+ */
+typedef struct {
+  int32_t y;                    /* Output, Q15 of the sample */
+  int16_t alphaQ15;             /* 1..32767, smaller = lower cut-off */
+  bool primed;                  /* Starts at the first sample instead of 0 */
+} filter_iir_t;
+
+/**
+ * @brief Running median of the last 'size' samples
+ */
+typedef struct {
+  uint8_t size;                 /* Odd, up to FILTER_MEDIAN_MAX */
+  uint8_t fill;
+  uint8_t pos;                  /* Oldest entry of history */
+  uint16_t history[FILTER_MEDIAN_MAX];
+  uint16_t sorted[FILTER_MEDIAN_MAX];
+} filter_median_t;
+
+bool filter_boxcar_init(filter_boxcar_t* filter, uint16_t ratio);
+uint16_t filter_boxcar_process(filter_boxcar_t* filter, uint16_t* data, uint16_t count, uint8_t stride);
+
+bool filter_cic_init(filter_cic_t* filter, uint8_t order, uint16_t ratio);
+uint16_t filter_cic_process(filter_cic_t* filter, uint16_t* data, uint16_t count, uint8_t stride);
+
+bool filter_iir_init(filter_iir_t* filter, int16_t alphaQ15);
+uint16_t filter_iir_process(filter_iir_t* filter, uint16_t* data, uint16_t count, uint8_t stride);
+
+bool filter_median_init(filter_median_t* filter, uint8_t size);
+uint16_t filter_median_process(filter_median_t* filter, uint16_t* data, uint16_t count, uint8_t stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_FILTER_H__ */
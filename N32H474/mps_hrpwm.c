@@ -1,25 +1,48 @@
 #include "mps_hrpwm.h"
 #include "n32h47x_48x_rcc.h"
 #include "n32h47x_48x_gpio.h"
+#include "mps_time.h"
 
 /* SHRTIM input clock frequency (250MHz) */
 #define SHRTIM_INPUT_CLOCK  250000000
 
+/* HSE feeding the SHRTPLL */
+#define SHRTIM_HSE_CLOCK    8000000
+
+/* Clock bring-up state, shared by every timer */
+static bool shrtimClockReady = false;
+
 /* Internal structure to store PWM configurations */
 typedef struct {
   uint32_t period;
   uint32_t compareValue;
   uint32_t prescalerMultiplier;  /* Stores the prescaler multiplier used */
+  uint32_t shrtimTimer;          /* SHRTIM_TIMER_x, resolved once */
+  uint32_t dutyScale;            /* period - 1, compare = (dutyQ16 * dutyScale) >> 16 */
+  uint32_t dutyQ16;              /* Last duty, kept across frequency changes */
   bool is_initialized;
 } hrpwm_config_t;
 
 /* Static storage for each timer's configuration */
 static hrpwm_config_t hrpwmConfigs[6] = {{0}};  // Timer A-F
 
+/* ADC trigger routing, the position lives in compare 3 of the source timer */
+typedef struct {
+  bool active;
+  hrpwm_timer_t timer;
+  uint16_t positionPermille;    /* Of the period, or HRPWM_ADC_ON_CENTER */
+} hrpwm_adc_trig_config_t;
+
+static hrpwm_adc_trig_config_t hrpwmAdcTrigs[2];  // ADC trigger 1 and 3
+
+/* Smallest compare value the SHRTIM accepts */
+#define SHRTIM_MIN_COMPARE  3
+
 /* Static function declarations */
 
 static uint32_t get_shrtim_timer(hrpwm_timer_t timer);
 static uint32_t get_shrtim_output(hrpwm_timer_t timer, hrpwm_channel_t channel);
+static void update_adc_trigger_compare(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer);
 
 /**
  * @brief Calculate frequency parameters (prescaler and period)
@@ -60,19 +83,15 @@ static uint32_t calculate_frequency_parameters(uint32_t frequencyHz, uint32_t* p
 }
 
 /**
- * @brief Calculate duty cycle compare value with high precision
- * @param dutyPercent: Duty cycle in percent (0.0-100.0, supports decimal places)
- * @param period: Timer period value
- * @return Calculated compare value
+ * @brief Convert a duty or phase percentage to Q16 of the period
+ * @param percent: 0.0-100.0, clamped
  */
-static uint32_t calculate_duty_compare_value(float dutyPercent, uint32_t period)
+static uint32_t percent_to_q16(float percent)
 {
-  if (dutyPercent > 100.0f) dutyPercent = 100.0f;
-  if (dutyPercent < 0.0f) dutyPercent = 0.0f;
+  if (percent > 100.0f) percent = 100.0f;
+  if (percent < 0.0f) percent = 0.0f;
   
-  /* Use high precision calculation like official example */
-  /* compareValue = (duty_percent * (period - 1)) / 100 */
-  return (uint32_t)((dutyPercent * (float)(period - 1)) / 100.0f);
+  return (uint32_t)(percent * (HRPWM_Q16_ONE / 100.0f) + 0.5f);
 }
 
 /**
@@ -117,8 +136,10 @@ static uint32_t calculate_duty_compare_value(float dutyPercent, uint32_t period)
  *   - Typical motor control: 20-50kHz, Power supplies: 50-200kHz
  * @param dutyPercent: PWM duty cycle percentage (0.0-100.0, supports decimal like 67.5)
  * @param deadtimeNs: Dead time in nanoseconds (0-31875ns, resolution ~125ps)
+ * @return HRPWM_OK, or the hrpwm_clock_init error (timer left untouched)
+ * @note Only configures, the timer runs after hrpwm_start; other timers keep running
  */
- void hrpwm_init(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t frequencyHz, float dutyPercent, uint16_t deadtimeNs)
+ hrpwm_status_t hrpwm_init(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t frequencyHz, float dutyPercent, uint16_t deadtimeNs)
  {
    uint32_t shrtimTimer = get_shrtim_timer(timer);
    uint32_t shrtimOutputCh1 = get_shrtim_output(timer, HRPWM_CHANNEL_1);
@@ -126,6 +147,17 @@ static uint32_t calculate_duty_compare_value(float dutyPercent, uint32_t period)
    uint32_t period;
    uint32_t prescalerMultiplier;
    uint32_t shrtimPrescaler;
+   hrpwm_status_t status;
+   
+   if (timer > HRPWM_TIMER_F) {
+     return HRPWM_ERR_PARAM;
+   }
+   
+   /* Shared clock, brought up by the first call only */
+   status = hrpwm_clock_init();
+   if (status != HRPWM_OK) {
+     return status;
+   }
    
      /* Calculate period and prescaler for desired frequency */
   period = calculate_frequency_parameters(frequencyHz, &prescalerMultiplier, &shrtimPrescaler);
@@ -133,26 +165,9 @@ static uint32_t calculate_duty_compare_value(float dutyPercent, uint32_t period)
    /* Store configuration */
   hrpwmConfigs[timer].period = period;
   hrpwmConfigs[timer].prescalerMultiplier = prescalerMultiplier;
+  hrpwmConfigs[timer].shrtimTimer = shrtimTimer;
+  hrpwmConfigs[timer].dutyScale = period - 1;
   hrpwmConfigs[timer].is_initialized = true;
-     
-  /* Configure SHRTPLL */
-  /* Enable HSE */
-  RCC_ConfigHse(RCC_HSE_ENABLE);
-  
-  /* Wait till HSE is ready */
-  RCC_WaitHseStable();
-  
-  /* Configure SHRTPLL: HSE=8MHz -> 250MHz */
-  RCC_ConfigSHRTPll(RCC_SHRTPLL_SRC_HSE, 8000000, SHRTIM_INPUT_CLOCK, ENABLE);
-  
-  /* Wait till SHRTPLL is ready */
-  while (RCC_GetFlagStatus(RCC_FLAG_SHRTPLLRDF) != SET) {
-    // Wait for PLL lock
-  }
-     
-   /* Enable SHRTIM clock */
-   RCC_EnableAHBPeriphClk(RCC_AHB_PERIPHEN_SHRTIM, ENABLE);
-   
    
      /* Configure SHRTIM timer - basic settings */
   SHRTIM_TIM_SetPrescaler(SHRTIMx, shrtimTimer, shrtimPrescaler);
@@ -181,10 +196,96 @@ static uint32_t calculate_duty_compare_value(float dutyPercent, uint32_t period)
   
   /* Force update to apply all settings */
   SHRTIM_ForceUpdate(SHRTIMx, shrtimTimer);
-
+  
+  return HRPWM_OK;
  }
 
 
+/**
+ * @brief Bring up the SHRTIM clock: HSE, SHRTPLL lock, peripheral clock
+ * 
+ * Done once for all timers; later calls return at once, so initializing a
+ * timer never touches the PLL under timers that are already running. A PLL
+ * that stays unlocked for HRPWM_PLL_LOCK_TIMEOUT_US is reported instead of
+ * hanging, and the next call retries.
+ * 
+ * @return HRPWM_OK, HRPWM_ERR_HSE or HRPWM_ERR_PLL_TIMEOUT
+ */
+hrpwm_status_t hrpwm_clock_init(void)
+{
+  time_deadline_t timeout;
+  
+  if (shrtimClockReady) {
+    return HRPWM_OK;
+  }
+  
+  /* Enable HSE, the SDK wait has its own timeout */
+  RCC_ConfigHse(RCC_HSE_ENABLE);
+  if (RCC_WaitHseStable() != SUCCESS) {
+    return HRPWM_ERR_HSE;
+  }
+  
+  /* Configure SHRTPLL: HSE=8MHz -> 250MHz, unless already locked (e.g. after a warm restart of this code) */
+  if (RCC_GetFlagStatus(RCC_FLAG_SHRTPLLRDF) != SET) {
+    RCC_ConfigSHRTPll(RCC_SHRTPLL_SRC_HSE, SHRTIM_HSE_CLOCK, SHRTIM_INPUT_CLOCK, ENABLE);
+    
+    time_init();
+    timeout = time_deadline_us(HRPWM_PLL_LOCK_TIMEOUT_US);
+    while (RCC_GetFlagStatus(RCC_FLAG_SHRTPLLRDF) != SET) {
+      if (time_expired(timeout)) {
+        return HRPWM_ERR_PLL_TIMEOUT;
+      }
+    }
+  }
+  
+  /* Enable SHRTIM clock */
+  RCC_EnableAHBPeriphClk(RCC_AHB_PERIPHEN_SHRTIM, ENABLE);
+  shrtimClockReady = true;
+  return HRPWM_OK;
+}
+
+
+/**
+ * @brief Initialize several timers from a table and start them together
+ * 
+ * Every entry is configured as by hrpwm_init, then all outputs are enabled
+ * and the counters reset and enabled with one write each, so the timers
+ * start on the same SHRTIM clock edge and keep a fixed phase relationship.
+ * Timers not in the table are left alone.
+ * 
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param configs: One entry per timer, each timer at most once
+ * @param count: Entries in configs (1-6)
+ * @return HRPWM_OK, HRPWM_ERR_PARAM for a bad table (nothing configured), or a clock error
+ */
+hrpwm_status_t hrpwm_init_multi(SHRTIM_Module* SHRTIMx, const hrpwm_timer_config_t* configs, uint8_t count)
+{
+  uint8_t timerMask = 0;
+  uint8_t i;
+  hrpwm_status_t status;
+  
+  if (configs == NULL || count == 0 || count > 6) {
+    return HRPWM_ERR_PARAM;
+  }
+  for (i = 0; i < count; i++) {
+    if (configs[i].timer > HRPWM_TIMER_F || (timerMask & HRPWM_TIMER_MASK(configs[i].timer)) != 0) {
+      return HRPWM_ERR_PARAM;
+    }
+    timerMask |= HRPWM_TIMER_MASK(configs[i].timer);
+  }
+  
+  for (i = 0; i < count; i++) {
+    status = hrpwm_init(SHRTIMx, configs[i].timer, configs[i].frequencyHz, configs[i].dutyPercent, configs[i].deadtimeNs);
+    if (status != HRPWM_OK) {
+      return status;
+    }
+  }
+  
+  hrpwm_start_multi(SHRTIMx, timerMask);
+  return HRPWM_OK;
+}
+
+
 /**
  * @brief Get SHRTIM timer constant from enum
  */
@@ -236,19 +337,73 @@ static uint32_t get_shrtim_output(hrpwm_timer_t timer, hrpwm_channel_t channel)
  * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
  * @param timer: HRPWM timer selection
  * @param dutyPercent: New duty cycle in percent (0-100)
+ * @note Converts once and calls hrpwm_set_duty_q16, use that from control loops
  */
 void hrpwm_set_duty(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, float dutyPercent)
 {
-  uint32_t shrtimTimer = get_shrtim_timer(timer);
-  uint32_t compareValue;
-  
-  /* Calculate new compare value using the helper function */
-  compareValue = calculate_duty_compare_value(dutyPercent, hrpwmConfigs[timer].period);
-  hrpwmConfigs[timer].compareValue = compareValue;
+  hrpwm_set_duty_q16(SHRTIMx, timer, percent_to_q16(dutyPercent));
+}
+
+
+/**
+ * @brief Clamp and write a duty compare value, the timer already checked
+ */
+static void write_duty_compare(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, hrpwm_config_t* config,
+                               uint32_t compareValue)
+{
+  if (compareValue > config->dutyScale) {
+    compareValue = config->dutyScale;
+  }
+  config->compareValue = compareValue;
   
   /* Update both channels for true complementary operation */
-  SHRTIM_TIM_SetCompare1(SHRTIMx, shrtimTimer, compareValue);  // Channel 1 (high-side)
-  SHRTIM_TIM_SetCompare2(SHRTIMx, shrtimTimer, compareValue);  // Channel 2 (starts when CH1 ends)
+  SHRTIM_TIM_SetCompare1(SHRTIMx, config->shrtimTimer, compareValue);  // Channel 1 (high-side)
+  SHRTIM_TIM_SetCompare2(SHRTIMx, config->shrtimTimer, compareValue);  // Channel 2 (starts when CH1 ends)
+  
+  /* Keep a centered ADC trigger in the middle of the new on-time */
+  update_adc_trigger_compare(SHRTIMx, timer);
+}
+
+
+/**
+ * @brief Set complementary PWM duty cycle, fixed point
+ * 
+ * One multiply (a single UMULL) and shift with the scale cached at the last
+ * frequency change, then the compare registers. No float, no division, so it
+ * fits a control loop interrupt.
+ * 
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param timer: HRPWM timer selection
+ * @param dutyQ16: Duty in Q16 of the period, 0 to HRPWM_Q16_ONE (100%), clamped
+ */
+void hrpwm_set_duty_q16(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t dutyQ16)
+{
+  hrpwm_config_t* config;
+
+  if (timer > HRPWM_TIMER_F || !hrpwmConfigs[timer].is_initialized) {
+    return;
+  }
+  config = &hrpwmConfigs[timer];
+  if (dutyQ16 > HRPWM_Q16_ONE) {
+    dutyQ16 = HRPWM_Q16_ONE;
+  }
+  config->dutyQ16 = dutyQ16;
+  write_duty_compare(SHRTIMx, timer, config, (uint32_t)(((uint64_t)dutyQ16 * config->dutyScale) >> 16));
+}
+
+
+/**
+ * @brief Set complementary PWM duty cycle as a raw compare value
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param timer: HRPWM timer selection
+ * @param compareValue: On-time in SHRTIM ticks, 0 to period - 1 (hrpwm_get_state), clamped
+ */
+void hrpwm_set_duty_ticks(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t compareValue)
+{
+  if (timer > HRPWM_TIMER_F || !hrpwmConfigs[timer].is_initialized) {
+    return;
+  }
+  write_duty_compare(SHRTIMx, timer, &hrpwmConfigs[timer], compareValue);
 }
 
 
@@ -272,6 +427,35 @@ void hrpwm_start(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer)
 }
 
 
+/**
+ * @brief Start several timers in the same clock cycle
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param timerMask: ORed HRPWM_TIMER_MASK() of initialized timers
+ */
+void hrpwm_start_multi(SHRTIM_Module* SHRTIMx, uint8_t timerMask)
+{
+  uint32_t shrtimTimers = 0;
+  uint32_t shrtimOutputs = 0;
+  uint8_t timer;
+  
+  for (timer = HRPWM_TIMER_A; timer <= HRPWM_TIMER_F; timer++) {
+    if ((timerMask & HRPWM_TIMER_MASK(timer)) != 0) {
+      shrtimTimers |= get_shrtim_timer((hrpwm_timer_t)timer);
+      shrtimOutputs |= get_shrtim_output((hrpwm_timer_t)timer, HRPWM_CHANNEL_1);
+      shrtimOutputs |= get_shrtim_output((hrpwm_timer_t)timer, HRPWM_CHANNEL_2);
+    }
+  }
+  if (shrtimTimers == 0) {
+    return;
+  }
+  
+  /* Outputs first, then counters from zero with one write to the master control register */
+  SHRTIM_EnableOutput(SHRTIMx, shrtimOutputs);
+  SHRTIM_ForceReset(SHRTIMx, shrtimTimers);
+  SHRTIM_TIM_CounterEnable(SHRTIMx, shrtimTimers);
+}
+
+
 /**
  * @brief Stop complementary PWM output
  * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
@@ -300,28 +484,27 @@ void hrpwm_set_frequency(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t f
   uint32_t shrtimTimer = get_shrtim_timer(timer);
   uint32_t period;
   uint32_t compareValue;
-  uint8_t currentDuty;
   uint32_t prescalerMultiplier;
   uint32_t shrtimPrescaler;
   
-  /* Calculate current duty cycle percentage */
-  currentDuty = (uint8_t)(((uint64_t)hrpwmConfigs[timer].compareValue * 100) / hrpwmConfigs[timer].period);
-  
   /* Calculate new period and prescaler using the helper function */
   period = calculate_frequency_parameters(frequencyHz, &prescalerMultiplier, &shrtimPrescaler);
   
-  /* Calculate new compare value to maintain duty cycle */
-  compareValue = (uint32_t)(((uint64_t)currentDuty * period) / 100);
+  /* Rescale the stored duty, and cache the scale for the fixed-point setters */
+  compareValue = (uint32_t)(((uint64_t)hrpwmConfigs[timer].dutyQ16 * (period - 1)) >> 16);
   
   /* Update configuration */
   hrpwmConfigs[timer].period = period;
   hrpwmConfigs[timer].compareValue = compareValue;
   hrpwmConfigs[timer].prescalerMultiplier = prescalerMultiplier;
+  hrpwmConfigs[timer].dutyScale = period - 1;
   
   /* Update SHRTIM registers */
   SHRTIM_TIM_SetPrescaler(SHRTIMx, shrtimTimer, shrtimPrescaler);
   SHRTIM_TIM_SetPeriod(SHRTIMx, shrtimTimer, period);
   SHRTIM_TIM_SetCompare1(SHRTIMx, shrtimTimer, compareValue);
+  SHRTIM_TIM_SetCompare2(SHRTIMx, shrtimTimer, compareValue);
+  update_adc_trigger_compare(SHRTIMx, timer);
   
   /* Force update - verified from official examples */
   SHRTIM_ForceUpdate(SHRTIMx, shrtimTimer);
@@ -335,38 +518,42 @@ void hrpwm_set_frequency(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t f
  * @param phasePercent: Phase shift in percent (0.0-100.0, supports decimal like 10.5)
  *   - High precision: 0.1% = 0.36° @ 100kHz, 0.036° @ 50kHz
  *   - Shifts both channels together maintaining complementary relationship
+ * @note Converts once and calls hrpwm_set_phase_q16
  */
 void hrpwm_set_phase(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, float phasePercent)
 {
-  uint32_t shrtimTimer = get_shrtim_timer(timer);
-  uint32_t period;
-  uint32_t phaseOffset;
-  uint32_t compareValueCh1, compareValueCh2;
-  
-  period = hrpwmConfigs[timer].period;
-  
-  /* Validate and clamp phase percentage */
-  if (phasePercent > 100.0f) phasePercent = 100.0f;
-  if (phasePercent < 0.0f) phasePercent = 0.0f;
-  
-  /* Calculate phase offset with high precision: Phase = (period * phasePercent) / 100 */
-  phaseOffset = (uint32_t)((phasePercent * (float)period) / 100.0f);
-  
-  /* Get current duty cycle compare value and add phase offset for both channels */
-  compareValueCh1 = hrpwmConfigs[timer].compareValue + phaseOffset;
-  compareValueCh2 = hrpwmConfigs[timer].compareValue + phaseOffset;  // True complementary: both channels use same compare value
+  hrpwm_set_phase_q16(SHRTIMx, timer, percent_to_q16(phasePercent));
+}
+
+
+/**
+ * @brief Set complementary PWM phase shift, fixed point
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param timer: HRPWM timer selection
+ * @param phaseQ16: Phase in Q16 of the period, 0 to HRPWM_Q16_ONE, clamped
+ */
+void hrpwm_set_phase_q16(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t phaseQ16)
+{
+  hrpwm_config_t* config;
+  uint32_t compareValue;
   
-  /* Wrap around if exceeds period */
-  if (compareValueCh1 >= period) {
-    compareValueCh1 -= period;
+  if (timer > HRPWM_TIMER_F || !hrpwmConfigs[timer].is_initialized) {
+    return;
+  }
+  config = &hrpwmConfigs[timer];
+  if (phaseQ16 > HRPWM_Q16_ONE) {
+    phaseQ16 = HRPWM_Q16_ONE;
   }
-  if (compareValueCh2 >= period) {
-    compareValueCh2 -= period;
+  
+  /* Duty compare value plus the offset, wrapped into the period */
+  compareValue = config->compareValue + (uint32_t)(((uint64_t)phaseQ16 * config->period) >> 16);
+  if (compareValue >= config->period) {
+    compareValue -= config->period;
   }
   
-  /* Set phase-shifted compare values for both complementary channels */
-  SHRTIM_TIM_SetCompare1(SHRTIMx, shrtimTimer, compareValueCh1);
-  SHRTIM_TIM_SetCompare2(SHRTIMx, shrtimTimer, compareValueCh2);
+  /* True complementary: both channels use the same compare value */
+  SHRTIM_TIM_SetCompare1(SHRTIMx, config->shrtimTimer, compareValue);
+  SHRTIM_TIM_SetCompare2(SHRTIMx, config->shrtimTimer, compareValue);
 }
 
 
@@ -421,3 +608,141 @@ void hrpwm_set_deadtime(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint16_t de
   /* Force update to ensure settings take effect immediately */
   SHRTIM_ForceUpdate(SHRTIMx, shrtimTimer);
 }
+
+/**
+ * @brief Get the stored configuration of a timer
+ * @param timer: Timer selection (A-F)
+ * @param period: Output period in SHRTIM ticks
+ * @param compareValue: Output duty compare value
+ * @param prescalerMultiplier: Output prescaler multiplier
+ * @return true if the timer has been initialized
+ */
+bool hrpwm_get_state(hrpwm_timer_t timer, uint32_t* period, uint32_t* compareValue, uint32_t* prescalerMultiplier)
+{
+  if (timer > HRPWM_TIMER_F || !hrpwmConfigs[timer].is_initialized) {
+    return false;
+  }
+  
+  *period = hrpwmConfigs[timer].period;
+  *compareValue = hrpwmConfigs[timer].compareValue;
+  *prescalerMultiplier = hrpwmConfigs[timer].prescalerMultiplier;
+  return true;
+}
+
+
+/**
+ * @brief Get the SHRTIM ADC trigger constant
+ */
+static uint32_t get_shrtim_adc_trig(hrpwm_adc_trig_t trigger)
+{
+  return (trigger == HRPWM_ADC_TRIG_3) ? SHRTIM_ADCTRIG_3 : SHRTIM_ADCTRIG_1;
+}
+
+
+/**
+ * @brief Get the compare 3 trigger source of a timer for an ADC trigger
+ */
+static uint32_t get_shrtim_adc_trig_src(hrpwm_timer_t timer)
+{
+  switch (timer) {
+    case HRPWM_TIMER_A: return SHRTIM_ADCTRIG_SRC13_TIMACMP3;
+    case HRPWM_TIMER_B: return SHRTIM_ADCTRIG_SRC13_TIMBCMP3;
+    case HRPWM_TIMER_C: return SHRTIM_ADCTRIG_SRC13_TIMCCMP3;
+    case HRPWM_TIMER_D: return SHRTIM_ADCTRIG_SRC13_TIMDCMP3;
+    case HRPWM_TIMER_E: return SHRTIM_ADCTRIG_SRC13_TIMECMP3;
+    case HRPWM_TIMER_F: return SHRTIM_ADCTRIG_SRC13_TIMFCMP3;
+    default: return SHRTIM_ADCTRIG_SRC13_TIMACMP3;
+  }
+}
+
+
+/**
+ * @brief Get the ADC trigger update source of a timer
+ */
+static uint32_t get_shrtim_adc_trig_update(hrpwm_timer_t timer)
+{
+  switch (timer) {
+    case HRPWM_TIMER_A: return SHRTIM_ADCTRIG_UPDATE_TIMER_A;
+    case HRPWM_TIMER_B: return SHRTIM_ADCTRIG_UPDATE_TIMER_B;
+    case HRPWM_TIMER_C: return SHRTIM_ADCTRIG_UPDATE_TIMER_C;
+    case HRPWM_TIMER_D: return SHRTIM_ADCTRIG_UPDATE_TIMER_D;
+    case HRPWM_TIMER_E: return SHRTIM_ADCTRIG_UPDATE_TIMER_E;
+    case HRPWM_TIMER_F: return SHRTIM_ADCTRIG_UPDATE_TIMER_F;
+    default: return SHRTIM_ADCTRIG_UPDATE_TIMER_A;
+  }
+}
+
+
+/**
+ * @brief Recompute compare 3 of a timer from the ADC trigger position
+ */
+static void update_adc_trigger_compare(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer)
+{
+  uint32_t period = hrpwmConfigs[timer].period;
+  uint32_t compareValue;
+  uint8_t i;
+
+  for (i = 0; i < 2; i++) {
+    if (!hrpwmAdcTrigs[i].active || hrpwmAdcTrigs[i].timer != timer) {
+      continue;
+    }
+    if (hrpwmAdcTrigs[i].positionPermille == HRPWM_ADC_ON_CENTER) {
+      /* Output is on from the period event to compare 1 */
+      compareValue = hrpwmConfigs[timer].compareValue / 2;
+    } else {
+      compareValue = (uint32_t)(((uint64_t)period * hrpwmAdcTrigs[i].positionPermille) / 1000);
+    }
+    if (compareValue < SHRTIM_MIN_COMPARE) {
+      compareValue = SHRTIM_MIN_COMPARE;
+    }
+    if (compareValue >= period) {
+      compareValue = period - 1;
+    }
+    SHRTIM_TIM_SetCompare3(SHRTIMx, get_shrtim_timer(timer), compareValue);
+  }
+}
+
+
+/**
+ * @brief Trigger ADC conversions at a fixed point of every PWM period
+ * 
+ * Routes compare 3 of the timer to a SHRTIM ADC trigger output. Pair it with
+ * adc_scan_init_triggered on an ADC whose regular trigger is that output, so
+ * each period converts one sample set away from the switching edges. The
+ * compare is preloaded with the timer, so a new position or duty applies from
+ * the next period. Both ADC triggers on one timer share its compare 3.
+ * 
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param timer: HRPWM timer, initialized with hrpwm_init
+ * @param trigger: SHRTIM ADC trigger output
+ * @param positionPermille: Trigger point in permille of the period (0-999), or
+ *   HRPWM_ADC_ON_CENTER for the middle of the on-time, following hrpwm_set_duty
+ */
+void hrpwm_adc_trigger(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, hrpwm_adc_trig_t trigger, uint16_t positionPermille)
+{
+  hrpwm_adc_trig_config_t* config = &hrpwmAdcTrigs[trigger];
+
+  if (positionPermille != HRPWM_ADC_ON_CENTER && positionPermille > 999) {
+    positionPermille = 999;
+  }
+  config->timer = timer;
+  config->positionPermille = positionPermille;
+  config->active = true;
+  update_adc_trigger_compare(SHRTIMx, timer);
+
+  SHRTIM_ConfigADCTrig(SHRTIMx, get_shrtim_adc_trig(trigger),
+                       get_shrtim_adc_trig_update(timer), get_shrtim_adc_trig_src(timer));
+  SHRTIM_ForceUpdate(SHRTIMx, get_shrtim_timer(timer));
+}
+
+
+/**
+ * @brief Stop an ADC trigger output
+ * @param SHRTIMx: SHRTIM module (e.g., SHRTIM1)
+ * @param trigger: SHRTIM ADC trigger output
+ */
+void hrpwm_adc_trigger_disable(SHRTIM_Module* SHRTIMx, hrpwm_adc_trig_t trigger)
+{
+  SHRTIM_SetADCTrigSrc(SHRTIMx, get_shrtim_adc_trig(trigger), SHRTIM_ADCTRIG_SRC13_NONE);
+  hrpwmAdcTrigs[trigger].active = false;
+}
@@ -29,14 +29,64 @@ typedef enum {
   HRPWM_CHANNEL_2       // Channel 2 output (complementary)
 } hrpwm_channel_t;
 
+/**
+ * @brief Result of the SHRTIM bring-up and initialization
+ */
+typedef enum {
+  HRPWM_OK = 0,
+  HRPWM_ERR_PARAM,        // Invalid timer or table
+  HRPWM_ERR_HSE,          // HSE did not start
+  HRPWM_ERR_PLL_TIMEOUT   // SHRTPLL did not lock in HRPWM_PLL_LOCK_TIMEOUT_US
+} hrpwm_status_t;
+
+/**
+ * @brief One timer of a hrpwm_init_multi table, parameters as for hrpwm_init
+ */
+typedef struct {
+  hrpwm_timer_t timer;
+  uint32_t frequencyHz;
+  float dutyPercent;
+  uint16_t deadtimeNs;
+} hrpwm_timer_config_t;
+
+/* Bit of a timer in the hrpwm_start_multi mask */
+#define HRPWM_TIMER_MASK(timer)  (1u << (timer))
+
+/* Longest wait for the SHRTPLL to lock */
+#define HRPWM_PLL_LOCK_TIMEOUT_US  2000
+
+/**
+ * @brief SHRTIM ADC trigger output, routed to the ADC external trigger inputs
+ */
+typedef enum {
+  HRPWM_ADC_TRIG_1 = 0, // SHRTIM ADC trigger 1
+  HRPWM_ADC_TRIG_3      // SHRTIM ADC trigger 3
+} hrpwm_adc_trig_t;
+
+/* Q16 duty and phase: HRPWM_Q16_ONE is 100% of the period */
+#define HRPWM_Q16_ONE        65536u
+#define HRPWM_Q16(percent)   ((uint32_t)(((uint64_t)(percent) * HRPWM_Q16_ONE + 50) / 100))
+
+/* Trigger position that follows the middle of the on-time as the duty changes */
+#define HRPWM_ADC_ON_CENTER  0xFFFF
+
 void configure_hrpwm_gpio(void);
-void hrpwm_init(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t frequencyHz, float dutyPercent, uint16_t deadtimeNs);
+hrpwm_status_t hrpwm_clock_init(void);
+hrpwm_status_t hrpwm_init(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t frequencyHz, float dutyPercent, uint16_t deadtimeNs);
+hrpwm_status_t hrpwm_init_multi(SHRTIM_Module* SHRTIMx, const hrpwm_timer_config_t* configs, uint8_t count);
 void hrpwm_set_duty(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, float dutyPercent);
+void hrpwm_set_duty_q16(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t dutyQ16);
+void hrpwm_set_duty_ticks(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t compareValue);
 void hrpwm_start(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer);
+void hrpwm_start_multi(SHRTIM_Module* SHRTIMx, uint8_t timerMask);
 void hrpwm_stop(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer);
 void hrpwm_set_frequency(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t frequencyHz);
 void hrpwm_set_phase(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, float phasePercent);
+void hrpwm_set_phase_q16(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint32_t phaseQ16);
 void hrpwm_set_deadtime(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, uint16_t deadtimeNs);
+void hrpwm_adc_trigger(SHRTIM_Module* SHRTIMx, hrpwm_timer_t timer, hrpwm_adc_trig_t trigger, uint16_t positionPermille);
+void hrpwm_adc_trigger_disable(SHRTIM_Module* SHRTIMx, hrpwm_adc_trig_t trigger);
+bool hrpwm_get_state(hrpwm_timer_t timer, uint32_t* period, uint32_t* compareValue, uint32_t* prescalerMultiplier);
 
 #ifdef __cplusplus
 }
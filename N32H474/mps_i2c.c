@@ -14,13 +14,13 @@
 int8_t i2c_start(I2C_Module* I2Cx, uint8_t devAddr)
 {
   /* Check parameters */
-  uint32_t I2CTimeout;
+  time_deadline_t I2CTimeout;
   
   /* Wait until I2C bus is not busy */
-  I2CTimeout = I2C_TIMEOUT_BUSY_FLAG;
+  I2CTimeout = time_deadline_us(I2C_TIMEOUT_BUSY_FLAG);
   while (I2C_GetFlag(I2Cx, I2C_FLAG_BUSY))
   {
-    if ((I2CTimeout--) == 0)
+    if (time_expired(I2CTimeout))
     {
     return 0;
     }
@@ -30,10 +30,10 @@ int8_t i2c_start(I2C_Module* I2Cx, uint8_t devAddr)
   I2C_GenerateStart(I2Cx, ENABLE);
   
   /* Wait for EV5: START transmitted */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
+  I2CTimeout = time_deadline_us(I2C_TIMEOUT_FLAG);
   while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_MODE_FLAG))
   {
-    if ((I2CTimeout--) == 0)
+    if (time_expired(I2CTimeout))
     {
     return 0;
     }
@@ -43,10 +43,10 @@ int8_t i2c_start(I2C_Module* I2Cx, uint8_t devAddr)
   I2C_SendAddr7bit(I2Cx, devAddr, I2C_DIRECTION_SEND);
   
   /* Wait for EV6: address sent, ACK received */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
+  I2CTimeout = time_deadline_us(I2C_TIMEOUT_FLAG);
   while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_TXMODE_FLAG))
   {
-    if ((I2CTimeout--) == 0)
+    if (time_expired(I2CTimeout))
     {
     return 0;
   }
@@ -64,16 +64,16 @@ int8_t i2c_start(I2C_Module* I2Cx, uint8_t devAddr)
  */
 int8_t i2c_write(I2C_Module* I2Cx, uint8_t data)
 {
-  uint32_t I2CTimeout;
+  time_deadline_t I2CTimeout;
 
   /* Send data byte to I2C data register */
   I2C_SendData(I2Cx, data);
   
   /* Wait for EV8: data byte sent (data register empty and byte transmission complete) */
-  I2CTimeout = I2C_TIMEOUT_FLAG;
+  I2CTimeout = time_deadline_us(I2C_TIMEOUT_FLAG);
   while (!I2C_CheckEvent(I2Cx, I2C_EVT_MASTER_DATA_SENDING))
   {
-    if ((I2CTimeout--) == 0)
+    if (time_expired(I2CTimeout))
     {
     /* Timeout occurred during data transmission */
     return 0;
@@ -93,6 +93,9 @@ int i2c_master_init(I2C_Module* I2Cx, uint32_t speedKhz)
   I2C_InitType i2cx_master;
   GPIO_InitType i2cx_gpio;
   
+  /* Timeouts are measured against the cycle counter */
+  time_init();
+  
   /* Select configuration based on I2C interface */
   if (I2Cx == I2C1)
   {
@@ -10,7 +10,8 @@
 
 #include "mps_spi.h"    /* For spi_master_init */
 #include "mps_uart.h"   /* For uart_init and uart_dma_init */
-#include "mps_delay.h"  /* For systick_delay_ms */
+#include "mps_delay.h"  /* For delay_ms */
+#include "mps_time.h"   /* For timeout deadlines */
 
 
 
@@ -64,7 +65,7 @@ extern "C" {
 #define I2C_MASTER_ADDR   0x30
 #define I2C_SLAVE_ADDR    0x10
 
-/* Timeout values for I2C operations */
+/* Timeout values for I2C operations, in microseconds (mps_time.h) */
 #define I2C_TIMEOUT_FLAG      1000
 #define I2C_TIMEOUT_BUSY_FLAG   1000
 #define I2C_TIMEOUT_STOP_FLAG   1000
@@ -2,6 +2,10 @@
 #include "n32h47x_48x_tim.h"
 #include "n32h47x_48x_rcc.h"
 #include "n32h47x_48x_usart.h"
+#include "n32h47x_48x_dma.h"
+#include "mps_uart.h"
+#include "mps_adc.h"
+#include "mps_sched.h"
 #include "misc.h"
 #include <stddef.h>
 
@@ -13,13 +17,8 @@ static gpio_callback_t gpio_callbacks[16] = {NULL};
 /* ADC callback storage */
 static void (*adc1_callback)(uint16_t value) = NULL;
 static void (*adc2_callback)(uint16_t value) = NULL;
-
-/* External UART buffer variables (defined in main.c) */
-extern uint8_t rxBuffer[];
-extern volatile uint16_t rxCount;
-
-/* UART buffer size definition */
-#define UART_BUFFER_SIZE 256
+static void (*adc3_callback)(uint16_t value) = NULL;
+static void (*adc4_callback)(uint16_t value) = NULL;
 
 /**
  * @brief Set timer callBack function - simplified
@@ -124,6 +123,7 @@ void EXTI0_IRQHandler(void)
 {
   if (EXTI_GetITStatus(EXTI_LINE0) != RESET) {
     EXTI_ClrITPendBit(EXTI_LINE0);  // Clear interrupt flag
+    sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + 0));
     if (gpio_callbacks[0] != NULL) {
       gpio_callbacks[0]();  // Call user callBack function
         }
@@ -137,6 +137,7 @@ void EXTI1_IRQHandler(void)
 {
   if (EXTI_GetITStatus(EXTI_LINE1) != RESET) {
     EXTI_ClrITPendBit(EXTI_LINE1);
+    sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + 1));
     if (gpio_callbacks[1] != NULL) {
       gpio_callbacks[1]();
         }
@@ -150,6 +151,7 @@ void EXTI2_IRQHandler(void)
 {
   if (EXTI_GetITStatus(EXTI_LINE2) != RESET) {
     EXTI_ClrITPendBit(EXTI_LINE2);
+    sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + 2));
     if (gpio_callbacks[2] != NULL) {
       gpio_callbacks[2]();
         }
@@ -163,6 +165,7 @@ void EXTI3_IRQHandler(void)
 {
   if (EXTI_GetITStatus(EXTI_LINE3) != RESET) {
     EXTI_ClrITPendBit(EXTI_LINE3);
+    sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + 3));
     if (gpio_callbacks[3] != NULL) {
       gpio_callbacks[3]();
         }
@@ -176,6 +179,7 @@ void EXTI4_IRQHandler(void)
 {
   if (EXTI_GetITStatus(EXTI_LINE4) != RESET) {
     EXTI_ClrITPendBit(EXTI_LINE4);
+    sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + 4));
     if (gpio_callbacks[4] != NULL) {
       gpio_callbacks[4]();
         }
@@ -192,6 +196,7 @@ void EXTI9_5_IRQHandler(void)
     uint32_t exti_line = 1 << i;
       if (EXTI_GetITStatus(exti_line) != RESET) {
         EXTI_ClrITPendBit(exti_line);
+        sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + i));
         if (gpio_callbacks[i] != NULL) {
           gpio_callbacks[i]();
             }
@@ -209,6 +214,7 @@ void EXTI15_10_IRQHandler(void)
     uint32_t exti_line = 1 << i;
       if (EXTI_GetITStatus(exti_line) != RESET) {
         EXTI_ClrITPendBit(exti_line);
+        sched_signal((sched_source_t)(SCHED_SRC_EXTI0 + i));
         if (gpio_callbacks[i] != NULL) {
           gpio_callbacks[i]();
             }
@@ -219,18 +225,18 @@ void EXTI15_10_IRQHandler(void)
 /* UART interrupt handlers */
 
 /**
- * @brief USART1 IRQ Handler with simple buffer for echo
+ * @brief USART1 IRQ Handler, publishes DMA received data on IDLE line
  */
 void USART1_IRQHandler(void)
 {
-    /* Check if receive data register not empty interrupt occurred */
-    if ((USART_GetFlagStatus(USART1, USART_FLAG_RXDNE) != RESET) &&
-        (USART_GetIntStatus(USART1, USART_INT_RXDNE) != RESET))
+    /* IDLE line detected: the sender paused, publish what the DMA has received */
+    if ((USART_GetFlagStatus(USART1, USART_FLAG_IDLEF) != RESET) &&
+        (USART_GetIntStatus(USART1, USART_INT_IDLEF) != RESET))
     {
-        /* Read data from the receive data register */
-        if (rxCount < UART_BUFFER_SIZE) {
-            rxBuffer[rxCount++] = USART_ReceiveData(USART1);
-        }
+        /* Clear IDLE flag by reading STS then DAT */
+        (void)USART1->STS;
+        (void)USART1->DAT;
+        uart_rx_dma_irq(USART1);
     }
     
     /* Check for other UART interrupts and handle them */
@@ -263,6 +269,15 @@ void USART2_IRQHandler(void)
         /* Process received data here... */
     }
     
+    /* IDLE line detected: publish data received by circular DMA */
+    if ((USART_GetFlagStatus(USART2, USART_FLAG_IDLEF) != RESET) &&
+        (USART_GetIntStatus(USART2, USART_INT_IDLEF) != RESET))
+    {
+        (void)USART2->STS;
+        (void)USART2->DAT;
+        uart_rx_dma_irq(USART2);
+    }
+    
     /* Handle error flags */
     if ((USART_GetFlagStatus(USART2, USART_FLAG_OREF) != RESET) || 
         (USART_GetFlagStatus(USART2, USART_FLAG_NEF) != RESET) ||
@@ -291,6 +306,15 @@ void USART3_IRQHandler(void)
         /* Process received data here... */
     }
     
+    /* IDLE line detected: publish data received by circular DMA */
+    if ((USART_GetFlagStatus(USART3, USART_FLAG_IDLEF) != RESET) &&
+        (USART_GetIntStatus(USART3, USART_INT_IDLEF) != RESET))
+    {
+        (void)USART3->STS;
+        (void)USART3->DAT;
+        uart_rx_dma_irq(USART3);
+    }
+    
     /* Handle error flags */
     if ((USART_GetFlagStatus(USART3, USART_FLAG_OREF) != RESET) || 
         (USART_GetFlagStatus(USART3, USART_FLAG_NEF) != RESET) ||
@@ -301,3 +325,205 @@ void USART3_IRQHandler(void)
         (void)USART3->DAT;
     }
 }
+
+/* UART RX DMA interrupt handlers */
+
+/**
+ * @brief DMA1 channel 5 handler (USART1 RX), half/full transfer of the receive ring
+ */
+void DMA1_Channel5_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART1_RX_DMA_HT_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART1_RX_DMA_HT_FLAG, DMA1);
+        uart_rx_dma_irq(USART1);
+    }
+    if (DMA_GetFlagStatus(USART1_RX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART1_RX_DMA_FLAG, DMA1);
+        uart_rx_dma_irq(USART1);
+    }
+}
+
+/**
+ * @brief DMA1 channel 6 handler (USART2 RX), half/full transfer of the receive ring
+ */
+void DMA1_Channel6_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART2_RX_DMA_HT_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART2_RX_DMA_HT_FLAG, DMA1);
+        uart_rx_dma_irq(USART2);
+    }
+    if (DMA_GetFlagStatus(USART2_RX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART2_RX_DMA_FLAG, DMA1);
+        uart_rx_dma_irq(USART2);
+    }
+}
+
+/**
+ * @brief DMA1 channel 3 handler (USART3 RX), half/full transfer of the receive ring
+ */
+void DMA1_Channel3_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART3_RX_DMA_HT_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART3_RX_DMA_HT_FLAG, DMA1);
+        uart_rx_dma_irq(USART3);
+    }
+    if (DMA_GetFlagStatus(USART3_RX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART3_RX_DMA_FLAG, DMA1);
+        uart_rx_dma_irq(USART3);
+    }
+}
+
+/* UART TX DMA interrupt handlers */
+
+/**
+ * @brief DMA1 channel 4 handler (USART1 TX), chains the next queued transfer
+ */
+void DMA1_Channel4_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART1_TX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART1_TX_DMA_FLAG, DMA1);
+        uart_tx_dma_irq(USART1);
+    }
+}
+
+/**
+ * @brief DMA1 channel 7 handler (USART2 TX), chains the next queued transfer
+ */
+void DMA1_Channel7_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART2_TX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART2_TX_DMA_FLAG, DMA1);
+        uart_tx_dma_irq(USART2);
+    }
+}
+
+/**
+ * @brief DMA1 channel 2 handler (USART3 TX), chains the next queued transfer
+ */
+void DMA1_Channel2_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(USART3_TX_DMA_FLAG, DMA1) != RESET) {
+        DMA_ClearFlag(USART3_TX_DMA_FLAG, DMA1);
+        uart_tx_dma_irq(USART3);
+    }
+}
+
+/* ADC scan DMA interrupt handlers */
+
+/**
+ * @brief DMA2 channel 1 handler (ADC1 scan), half/full transfer of the sample buffer
+ */
+void DMA2_Channel1_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(ADC1_DMA_HT_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC1_DMA_HT_FLAG, DMA2);
+        adc_scan_dma_irq(ADC1, true);
+    }
+    if (DMA_GetFlagStatus(ADC1_DMA_TC_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC1_DMA_TC_FLAG, DMA2);
+        adc_scan_dma_irq(ADC1, false);
+    }
+}
+
+/**
+ * @brief DMA2 channel 2 handler (ADC2 scan), half/full transfer of the sample buffer
+ */
+void DMA2_Channel2_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(ADC2_DMA_HT_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC2_DMA_HT_FLAG, DMA2);
+        adc_scan_dma_irq(ADC2, true);
+    }
+    if (DMA_GetFlagStatus(ADC2_DMA_TC_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC2_DMA_TC_FLAG, DMA2);
+        adc_scan_dma_irq(ADC2, false);
+    }
+}
+
+/**
+ * @brief DMA2 channel 3 handler (ADC3 scan), half/full transfer of the sample buffer
+ */
+void DMA2_Channel3_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(ADC3_DMA_HT_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC3_DMA_HT_FLAG, DMA2);
+        adc_scan_dma_irq(ADC3, true);
+    }
+    if (DMA_GetFlagStatus(ADC3_DMA_TC_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC3_DMA_TC_FLAG, DMA2);
+        adc_scan_dma_irq(ADC3, false);
+    }
+}
+
+/**
+ * @brief DMA2 channel 4 handler (ADC4 scan), half/full transfer of the sample buffer
+ */
+void DMA2_Channel4_IRQHandler(void)
+{
+    if (DMA_GetFlagStatus(ADC4_DMA_HT_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC4_DMA_HT_FLAG, DMA2);
+        adc_scan_dma_irq(ADC4, true);
+    }
+    if (DMA_GetFlagStatus(ADC4_DMA_TC_FLAG, DMA2) != RESET) {
+        DMA_ClearFlag(ADC4_DMA_TC_FLAG, DMA2);
+        adc_scan_dma_irq(ADC4, false);
+    }
+}
+
+/**
+ * @brief Forward an end of conversion to a value-only callBack, ctx = its storage
+ */
+static void adc_value_dispatch(void* ctx, adc_event_t event, uint16_t value)
+{
+    void (**callBack)(uint16_t value) = (void (**)(uint16_t))ctx;
+
+    (void)event;
+    if (*callBack != NULL) {
+        (*callBack)(value);
+    }
+}
+
+/**
+ * @brief Set ADC end of conversion callBack - simple version
+ * @param adc_number: 1-4 for ADC1-ADC4
+ * @param callBack: Called with each result from the interrupt, NULL to disable
+ * @note Single channel use (adc_init); see adc_interrupt_init for events and context
+ */
+void adc_set_callback(uint8_t adc_number, void (*callBack)(uint16_t value))
+{
+    ADC_Module* ADCx;
+    void (**storage)(uint16_t value);
+
+    if (adc_number == 1) { ADCx = ADC1; storage = &adc1_callback; }
+    else if (adc_number == 2) { ADCx = ADC2; storage = &adc2_callback; }
+    else if (adc_number == 3) { ADCx = ADC3; storage = &adc3_callback; }
+    else if (adc_number == 4) { ADCx = ADC4; storage = &adc4_callback; }
+    else return;
+
+    *storage = callBack;
+    if (callBack != NULL) {
+        adc_interrupt_init(ADCx, ADC_EVENT_EOS, adc_value_dispatch, (void*)storage, 1);
+    } else {
+        adc_interrupt_disable(ADCx);
+    }
+}
+
+/* ADC interrupt handlers */
+
+/**
+ * @brief ADC1/ADC2 shared handler, end of conversion, sequence and injected sequence
+ */
+void ADC1_2_IRQHandler(void)
+{
+    adc_irq(ADC1);
+    adc_irq(ADC2);
+}
+
+/**
+ * @brief ADC3/ADC4 shared handler, end of conversion, sequence and injected sequence
+ */
+void ADC3_4_IRQHandler(void)
+{
+    adc_irq(ADC3);
+    adc_irq(ADC4);
+}
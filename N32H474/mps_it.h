@@ -56,6 +56,26 @@ void USART1_IRQHandler(void);
 void USART2_IRQHandler(void);
 void USART3_IRQHandler(void);
 
+/* UART RX DMA interrupt handlers */
+void DMA1_Channel5_IRQHandler(void);
+void DMA1_Channel6_IRQHandler(void);
+void DMA1_Channel3_IRQHandler(void);
+
+/* UART TX DMA interrupt handlers */
+void DMA1_Channel4_IRQHandler(void);
+void DMA1_Channel7_IRQHandler(void);
+void DMA1_Channel2_IRQHandler(void);
+
+/* ADC interrupt handlers */
+void ADC1_2_IRQHandler(void);
+void ADC3_4_IRQHandler(void);
+
+/* ADC scan DMA interrupt handlers */
+void DMA2_Channel1_IRQHandler(void);
+void DMA2_Channel2_IRQHandler(void);
+void DMA2_Channel3_IRQHandler(void);
+void DMA2_Channel4_IRQHandler(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,232 @@
+#include "mps_log.h"
+#include "mps_telemetry.h"
+#include <stddef.h>
+
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+#include "n32h47x_48x.h"
+#include "mps_time.h"
+#define LOG_BARRIER()               __DMB()
+#define LOG_TIMESTAMP()             time_cycles32()
+#else
+#define LOG_BARRIER()               __sync_synchronize()
+#define LOG_TIMESTAMP()             0u
+#endif
+
+#define LOG_RING_MASK               (MPS_LOG_RING_WORDS - 1)
+
+/* Record header word: size in words (never 0 once committed), argument count, ID */
+#define LOG_HDR(size, count, id)    (((uint32_t)(size) << 24) | ((uint32_t)(count) << 16) | (uint32_t)(id))
+#define LOG_HDR_SIZE(h)             ((h) >> 24)
+#define LOG_HDR_COUNT(h)            (((h) >> 16) & 0xFF)
+#define LOG_HDR_ID(h)               ((h) & 0xFFFF)
+
+/* Filler at the end of the ring when a record does not fit before the wrap */
+#define LOG_PAD_ID                  0xFFFF
+
+#if (MPS_LOG_RING_WORDS & (MPS_LOG_RING_WORDS - 1)) != 0
+#error "MPS_LOG_RING_WORDS must be a power of two"
+#endif
+
+static uint32_t logRing[MPS_LOG_RING_WORDS];
+static volatile uint32_t logHead;   /* Reserved words (free running), advanced by producers */
+static volatile uint32_t logTail;   /* Released words (free running), advanced by the drain */
+static volatile uint32_t logDropped;
+static volatile uint32_t logWritten;
+static uint32_t logSent;
+
+/**
+ * @brief Atomically move logHead from expected to desired
+ * @return true if logHead was still expected
+ */
+static inline bool log_reserve(uint32_t expected, uint32_t desired)
+{
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+  /* An interrupt between LDREX and STREX clears the monitor, the STREX then fails */
+  if (__LDREXW((volatile uint32_t*)&logHead) != expected)
+  {
+    __CLREX();
+    return false;
+  }
+  return __STREXW(desired, (volatile uint32_t*)&logHead) == 0;
+#else
+  return __sync_bool_compare_and_swap(&logHead, expected, desired);
+#endif
+}
+
+/**
+ * @brief Increment a counter shared between interrupt levels
+ */
+static inline void log_count(volatile uint32_t* counter)
+{
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+  uint32_t value;
+  do {
+    value = __LDREXW(counter) + 1;
+  } while (__STREXW(value, counter) != 0);
+#else
+  __sync_fetch_and_add(counter, 1);
+#endif
+}
+
+/**
+ * @brief Reset the log ring and start the timebase used for timestamps
+ */
+void mps_log_init(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < MPS_LOG_RING_WORDS; i++)
+  {
+    logRing[i] = 0;
+  }
+  logHead = 0;
+  logTail = 0;
+  logDropped = 0;
+  logWritten = 0;
+  logSent = 0;
+
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+  time_init();
+#endif
+}
+
+/**
+ * @brief Store one record, callable from any context including interrupts
+ *
+ * Space is reserved with a compare-and-swap on the head, so concurrent writers
+ * never block each other. The header word is written last and marks the
+ * record complete for the drain.
+ *
+ * @param id - format string offset in the mps_log_fmt section
+ * @param args - argument words
+ * @param count - number of arguments (at most MPS_LOG_MAX_ARGS)
+ */
+void mps_log_write(uint16_t id, const uint32_t* args, uint8_t count)
+{
+  uint32_t timestamp = LOG_TIMESTAMP();
+  uint32_t size;
+  uint32_t head;
+  uint32_t index;
+  uint32_t pad;
+  uint8_t i;
+
+  if (count > MPS_LOG_MAX_ARGS)
+  {
+    count = MPS_LOG_MAX_ARGS;
+  }
+  size = 2u + count;
+
+  do {
+    head = logHead;
+    index = head & LOG_RING_MASK;
+    pad = (MPS_LOG_RING_WORDS - index < size) ? (MPS_LOG_RING_WORDS - index) : 0;
+    if ((head + pad + size) - logTail > MPS_LOG_RING_WORDS)
+    {
+      log_count(&logDropped);
+      return;
+    }
+  } while (!log_reserve(head, head + pad + size));
+
+  if (pad != 0)
+  {
+    logRing[index] = LOG_HDR(pad, 0, LOG_PAD_ID);
+    index = 0;
+  }
+
+  logRing[index + 1] = timestamp;
+  for (i = 0; i < count; i++)
+  {
+    logRing[index + 2 + i] = args[i];
+  }
+  LOG_BARRIER();
+  logRing[index] = LOG_HDR(size, count, id);
+  log_count(&logWritten);
+}
+
+/**
+ * @brief Send completed records as one TELEM_TYPE_LOG telemetry frame
+ *
+ * Call from the main loop (or a low priority task). Records stay in the ring
+ * while telemetry has no budget or buffer, so nothing is lost until the ring
+ * itself overflows.
+ *
+ * @param timestampUs - frame timestamp
+ * @return number of records sent
+ */
+uint32_t mps_log_drain(uint32_t timestampUs)
+{
+  telem_frame_t* frame;
+  uint32_t sent = 0;
+  uint32_t tail = logTail;
+
+  if (tail == logHead || logRing[tail & LOG_RING_MASK] == 0)
+  {
+    return 0;
+  }
+
+  frame = telem_begin(TELEM_TYPE_LOG, timestampUs);
+  if (frame == NULL)
+  {
+    return 0;
+  }
+
+  while (tail != logHead)
+  {
+    uint32_t index = tail & LOG_RING_MASK;
+    uint32_t header = logRing[index];
+    uint32_t size = LOG_HDR_SIZE(header);
+    uint32_t i;
+
+    if (header == 0)
+    {
+      break;  /* Reserved but not completed yet */
+    }
+
+    if (LOG_HDR_ID(header) != LOG_PAD_ID || LOG_HDR_COUNT(header) != 0)
+    {
+      /* id u16, count u8, reserved u8, cycles u32, args u32 */
+      if (frame->length + 4u * size > TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD)
+      {
+        break;  /* Frame full, rest goes in the next one */
+      }
+      telem_put_u16(frame, (uint16_t)LOG_HDR_ID(header));
+      telem_put_u8(frame, (uint8_t)LOG_HDR_COUNT(header));
+      telem_put_u8(frame, 0);
+      for (i = 1; i < size; i++)
+      {
+        telem_put_u32(frame, logRing[index + i]);
+      }
+      sent++;
+    }
+    tail += size;
+  }
+
+  if (sent == 0)
+  {
+    telem_abort(frame);
+  }
+  else if (!telem_commit(frame))
+  {
+    return 0;  /* Records stay in the ring for the next drain */
+  }
+
+  /* Release the records, clearing them first so producers always find zeroed headers */
+  for (uint32_t pos = logTail; pos != tail; pos++)
+  {
+    logRing[pos & LOG_RING_MASK] = 0;
+  }
+  LOG_BARRIER();
+  logTail = tail;
+  logSent += sent;
+  return sent;
+}
+
+/**
+ * @brief Copy the log statistics
+ */
+void mps_log_get_stats(mps_log_stats_t* stats)
+{
+  stats->written = logWritten;
+  stats->dropped = logDropped;
+  stats->sent = logSent;
+}
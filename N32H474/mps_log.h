@@ -0,0 +1,87 @@
+#ifndef __MPS_LOG_H__
+#define __MPS_LOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Deferred binary logging
+ *
+ * MPS_LOG("adc %u over limit %d", value, limit) does not format anything on
+ * the target. The format string is placed in the mps_log_fmt section and the
+ * record only carries its offset in that section (the ID), a DWT cycle
+ * timestamp and the raw 32-bit arguments. Records go into a lock-free RAM ring
+ * that any context, including interrupts, may write; mps_log_drain sends them
+ * as TELEM_TYPE_LOG telemetry frames. Tools/log_expand rebuilds the text from
+ * the firmware ELF.
+ *
+ * Arguments are passed as 32-bit words: integers and characters are
+ * supported directly, pointers with MPS_LOG_PTR(p) and floats with
+ * MPS_LOG_FLOAT(x). %s is not expanded.
+ */
+
+/* Ring size in 32-bit words, must be a power of two */
+#define MPS_LOG_RING_WORDS      256
+
+/* Maximum arguments per record */
+#define MPS_LOG_MAX_ARGS        6
+
+/* Section holding the format strings, ID = offset in this section */
+#define MPS_LOG_SECTION         "mps_log_fmt"
+
+/* Start of the format section, provided by the GNU linker for C-identifier section names */
+#ifndef MPS_LOG_SECTION_START
+#define MPS_LOG_SECTION_START   __start_mps_log_fmt
+#endif
+extern const char MPS_LOG_SECTION_START[];
+
+/* Pass a float argument by its bit pattern */
+#define MPS_LOG_FLOAT(x)        mps_log_float_bits(x)
+
+/* Pass a pointer argument (%p) as its address */
+#define MPS_LOG_PTR(p)          ((uint32_t)(uintptr_t)(p))
+
+/**
+ * @brief Log a message without formatting it on the target
+ * @param fmt - string literal, printf style
+ * @param ... - up to MPS_LOG_MAX_ARGS integer arguments
+ */
+#define MPS_LOG(fmt, ...) \
+  do { \
+    static const char mps_log_fmt_[] __attribute__((section(MPS_LOG_SECTION), used)) = fmt; \
+    const uint32_t mps_log_args_[] = { 0, ##__VA_ARGS__ }; \
+    mps_log_write((uint16_t)(mps_log_fmt_ - MPS_LOG_SECTION_START), &mps_log_args_[1], \
+                  (uint8_t)(sizeof(mps_log_args_) / sizeof(uint32_t) - 1)); \
+  } while (0)
+
+/**
+ * @brief Log statistics
+ */
+typedef struct {
+  uint32_t written;   /* Records stored */
+  uint32_t dropped;   /* Records lost because the ring was full */
+  uint32_t sent;      /* Records handed to telemetry */
+} mps_log_stats_t;
+
+static inline uint32_t mps_log_float_bits(float value)
+{
+  union { float f; uint32_t u; } bits;
+
+  bits.f = value;
+  return bits.u;
+}
+
+void mps_log_init(void);
+void mps_log_write(uint16_t id, const uint32_t* args, uint8_t count);
+uint32_t mps_log_drain(uint32_t timestampUs);
+void mps_log_get_stats(mps_log_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_LOG_H__ */
@@ -8,6 +8,7 @@
 #include "mps_mpq2645.h" // Include balance module header file
 
 #include "mps_delay.h"   // Use custom delay module
+#include "mps_sleep.h"   // Sleeping waits for long delays
 
 
 
@@ -219,7 +220,7 @@ void balanceBatteries(int32_t* Current_capacity)
   if(groups.state!=Idle)
   {
   CTRL_L; //Pull CTRL pin low during execution
-  systick_delay_us(250); // MP2645 delay time
+  delay_us(250); // MP2645 delay time
   
   //1. Send corresponding current setting to MPQ2645
   if(groups.current==balance_Current_GUI)
@@ -246,7 +247,7 @@ void balanceBatteries(int32_t* Current_capacity)
 	}
 	
 	
-  systick_delay_ms(1000); // Execution time
+  sleep_ms(1000); // Execution time, core sleeps
 	Send_ctrl_pulse(0,2); // Turn off all balancing
 	CTRL_H;	// Pull CTRL high, stop execution, prepare for next MCU sampling
 }
@@ -345,25 +346,25 @@ void balanceBatteries(int32_t* Current_capacity)
 
 void Send_ctrl_pulse(uint16_t ADDR_num, uint16_t Commond_num)
 {
-	systick_delay_us(5); 
+	delay_us(5); 
 
 	for(char i=0;i<ADDR_num;i++)// sent address
 	{
 		CTRL_H;
-		systick_delay_us(5);
+		delay_us(5);
 		CTRL_L;
-		systick_delay_us(5);
+		delay_us(5);
 	}
-	systick_delay_us(50); //t_store=50us
+	delay_us(50); //t_store=50us
 	
 	for(char i=0;i<Commond_num;i++)// send command
 	{
 		CTRL_H;
-		systick_delay_us(5);
+		delay_us(5);
 		CTRL_L;
-		systick_delay_us(5);
+		delay_us(5);
 	}
-	systick_delay_us(50); //t_store=50us
+	delay_us(50); //t_store=50us
 }
 
 
@@ -0,0 +1,158 @@
+#include "mps_ring.h"
+#include <string.h>
+
+/**
+ * @brief Initialize a ring on caller-provided storage
+ * @param ring: ring to initialize
+ * @param buffer: storage of size bytes
+ * @param size: storage size, must be a power of two
+ * @return true if successful, false if size is not a power of two
+ */
+bool ring_init(mps_ring_t* ring, uint8_t* buffer, uint32_t size)
+{
+  if (ring == NULL || buffer == NULL || size == 0 || (size & (size - 1)) != 0)
+  {
+    return false;
+  }
+  ring->buffer = buffer;
+  ring->size = size;
+  ring->mask = size - 1;
+  ring->head = 0;
+  ring->tail = 0;
+  return true;
+}
+
+/**
+ * @brief Drop all data (only while neither side is active)
+ */
+void ring_reset(mps_ring_t* ring)
+{
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+/**
+ * @brief Number of bytes available to the consumer
+ */
+uint32_t ring_count(const mps_ring_t* ring)
+{
+  return ring->head - ring->tail;
+}
+
+/**
+ * @brief Number of bytes the producer may still write
+ */
+uint32_t ring_space(const mps_ring_t* ring)
+{
+  return ring->size - (ring->head - ring->tail);
+}
+
+/**
+ * @brief Get the largest contiguous free span (producer side)
+ * @param len: receives the span length, 0 if the ring is full
+ * @return pointer to the span, fill it and call ring_write_commit
+ */
+uint8_t* ring_write_peek(mps_ring_t* ring, uint32_t* len)
+{
+  uint32_t head = ring->head;
+  uint32_t free = ring->size - (head - ring->tail);
+  uint32_t offset = head & ring->mask;
+  uint32_t toEnd = ring->size - offset;
+
+  *len = (free < toEnd) ? free : toEnd;
+  return &ring->buffer[offset];
+}
+
+/**
+ * @brief Publish len bytes written into the span from ring_write_peek
+ */
+void ring_write_commit(mps_ring_t* ring, uint32_t len)
+{
+  /* Data must be visible before the consumer sees the new head */
+  RING_BARRIER();
+  ring->head += len;
+}
+
+/**
+ * @brief Copy data into the ring (producer side)
+ * @return number of bytes written, less than len if the ring is full
+ */
+uint32_t ring_write(mps_ring_t* ring, const uint8_t* data, uint32_t len)
+{
+  uint32_t written = 0;
+  uint32_t span;
+  uint8_t* dst;
+
+  while (written < len)
+  {
+    dst = ring_write_peek(ring, &span);
+    if (span == 0)
+    {
+      break;
+    }
+    if (span > len - written)
+    {
+      span = len - written;
+    }
+    memcpy(dst, &data[written], span);
+    ring_write_commit(ring, span);
+    written += span;
+  }
+  return written;
+}
+
+/**
+ * @brief Get the largest contiguous readable span (consumer side)
+ * @param len: receives the span length, 0 if the ring is empty
+ * @return pointer to the span, release it with ring_read_commit
+ */
+const uint8_t* ring_read_peek(mps_ring_t* ring, uint32_t* len)
+{
+  uint32_t tail = ring->tail;
+  uint32_t used = ring->head - tail;
+  uint32_t offset = tail & ring->mask;
+  uint32_t toEnd = ring->size - offset;
+
+  /* Do not read buffer contents before the head has been observed */
+  RING_BARRIER();
+  *len = (used < toEnd) ? used : toEnd;
+  return &ring->buffer[offset];
+}
+
+/**
+ * @brief Release len bytes returned by ring_read_peek
+ */
+void ring_read_commit(mps_ring_t* ring, uint32_t len)
+{
+  /* Finish reading the span before handing it back to the producer */
+  RING_BARRIER();
+  ring->tail += len;
+}
+
+/**
+ * @brief Copy data out of the ring (consumer side)
+ * @return number of bytes read
+ */
+uint32_t ring_read(mps_ring_t* ring, uint8_t* data, uint32_t len)
+{
+  uint32_t done = 0;
+  uint32_t span;
+  const uint8_t* src;
+
+  while (done < len)
+  {
+    src = ring_read_peek(ring, &span);
+    if (span == 0)
+    {
+      break;
+    }
+    if (span > len - done)
+    {
+      span = len - done;
+    }
+    memcpy(&data[done], src, span);
+    ring_read_commit(ring, span);
+    done += span;
+  }
+  return done;
+}
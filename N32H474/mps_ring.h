@@ -0,0 +1,57 @@
+#ifndef __MPS_RING_H__
+#define __MPS_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Memory barrier ordering buffer accesses against index updates
+ */
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+#include "n32h47x_48x.h"
+#define RING_BARRIER()  __DMB()
+#else
+#define RING_BARRIER()  __sync_synchronize()
+#endif
+
+/**
+ * @brief Lock-free single-producer/single-consumer byte ring
+ *
+ * head is only written by the producer and tail only by the consumer, both
+ * are free running and wrap naturally at 2^32. The size must be a power of
+ * two so positions are reduced with a mask. One producer (e.g. an ISR or a
+ * DMA publisher) and one consumer may run concurrently without locking.
+ */
+typedef struct {
+  uint8_t* buffer;            // Storage, size bytes
+  uint32_t size;              // Power of two
+  uint32_t mask;              // size - 1
+  volatile uint32_t head;     // Total bytes produced
+  volatile uint32_t tail;     // Total bytes consumed
+} mps_ring_t;
+
+bool ring_init(mps_ring_t* ring, uint8_t* buffer, uint32_t size);
+void ring_reset(mps_ring_t* ring);
+uint32_t ring_count(const mps_ring_t* ring);
+uint32_t ring_space(const mps_ring_t* ring);
+
+/* Producer side */
+uint32_t ring_write(mps_ring_t* ring, const uint8_t* data, uint32_t len);
+uint8_t* ring_write_peek(mps_ring_t* ring, uint32_t* len);
+void ring_write_commit(mps_ring_t* ring, uint32_t len);
+
+/* Consumer side */
+uint32_t ring_read(mps_ring_t* ring, uint8_t* data, uint32_t len);
+const uint8_t* ring_read_peek(mps_ring_t* ring, uint32_t* len);
+void ring_read_commit(mps_ring_t* ring, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_RING_H__ */
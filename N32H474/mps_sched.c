@@ -0,0 +1,424 @@
+#include "mps_sched.h"
+#include "mps_timer.h"
+#include "mps_time.h"
+#include "mps_sleep.h"
+#include "n32h47x_48x.h"
+
+#define SCHED_CYCLES()      time_cycles32()
+#define SCHED_KEEPALIVE_US  1000000     /* Timebase read interval, well below a CYCCNT wrap */
+
+/* Ready queues, one FIFO per priority */
+static sched_task_t* readyHead[SCHED_PRIORITIES];
+static sched_task_t* readyTail[SCHED_PRIORITIES];
+static volatile uint32_t readyMask;          /* Bit n = priority n has ready tasks */
+
+static sched_task_t* taskList = NULL;        /* All initialized tasks */
+
+/* Interrupt source bindings */
+static struct {
+  sched_task_t* task;
+  uint32_t events;
+} sources[SCHED_SRC_COUNT];
+
+static uint32_t schedTickUs = 0;             /* Timer wheel tick, 0 = no periodic tasks */
+static swtimer_t keepAlive;                  /* Keeps the 64-bit timebase extension current */
+static uint32_t idleCycles = 0;              /* Idle time in the current load window */
+static uint32_t windowStart = 0;
+
+/**
+ * @brief Queue a task at the tail of its priority, interrupts must be masked
+ */
+static void sched_enqueue(sched_task_t* task)
+{
+  uint8_t priority = task->priority;
+
+  task->next = NULL;
+  if (readyHead[priority] == NULL)
+  {
+    readyHead[priority] = task;
+  }
+  else
+  {
+    readyTail[priority]->next = task;
+  }
+  readyTail[priority] = task;
+  task->queued = true;
+  readyMask |= 1u << priority;
+}
+
+/**
+ * @brief Pop the highest priority ready task, interrupts must be masked
+ */
+static sched_task_t* sched_dequeue(void)
+{
+  uint32_t priority;
+  sched_task_t* task;
+
+  if (readyMask == 0)
+  {
+    return NULL;
+  }
+  priority = __CLZ(__RBIT(readyMask));
+  task = readyHead[priority];
+  readyHead[priority] = task->next;
+  if (readyHead[priority] == NULL)
+  {
+    readyTail[priority] = NULL;
+    readyMask &= ~(1u << priority);
+  }
+  task->next = NULL;
+  task->queued = false;
+  return task;
+}
+
+/**
+ * @brief Timer wheel callBack releasing a periodic task
+ */
+static void sched_release(void* ctx)
+{
+  sched_task_t* task = (sched_task_t*)ctx;
+
+  if ((task->events & SCHED_EVENT_PERIOD) != 0)
+  {
+    /* Previous release has not started yet */
+    task->deadlineMisses++;
+  }
+  task->releaseCycles = SCHED_CYCLES();
+  sched_post(task, SCHED_EVENT_PERIOD);
+}
+
+/**
+ * @brief Read the timebase so no CYCCNT wrap goes unseen
+ */
+static void sched_keepalive(void* ctx)
+{
+  (void)ctx;
+  (void)time_now_cycles();
+}
+
+/**
+ * @brief Initialize the scheduler
+ * @param TIMx - GTIM dedicated to the timer wheel releasing periodic tasks, NULL if none
+ * @param tickUs - wheel tick in microseconds, the period resolution
+ * @return 1 on success, 0 if the timer could not be configured
+ */
+int sched_init(TIM_Module* TIMx, uint32_t tickUs)
+{
+  uint32_t i;
+
+  for (i = 0; i < SCHED_PRIORITIES; i++)
+  {
+    readyHead[i] = NULL;
+    readyTail[i] = NULL;
+  }
+  readyMask = 0;
+  for (i = 0; i < SCHED_SRC_COUNT; i++)
+  {
+    sources[i].task = NULL;
+    sources[i].events = 0;
+  }
+
+  /* Cycle counter for run time accounting */
+  time_init();
+  idleCycles = 0;
+  windowStart = SCHED_CYCLES();
+
+  schedTickUs = 0;
+  if (TIMx != NULL)
+  {
+    if (!timer_wheel_init(TIMx, tickUs, true))
+    {
+      return 0;
+    }
+    timer_start(TIMx);
+    schedTickUs = tickUs;
+    swtimer_start(&keepAlive, SCHED_KEEPALIVE_US / tickUs, SCHED_KEEPALIVE_US / tickUs, sched_keepalive, NULL);
+  }
+  return 1;
+}
+
+/**
+ * @brief Initialize a task
+ * @param task - control block, must stay valid
+ * @param name - for diagnostics
+ * @param priority - 0 (highest) to SCHED_PRIORITIES - 1
+ * @param handler - run with the pending events
+ * @param ctx - passed to handler
+ */
+void sched_task_init(sched_task_t* task, const char* name, uint8_t priority,
+                     sched_handler_t handler, void* ctx)
+{
+  sched_task_t* t;
+
+  if (task == NULL || handler == NULL)
+  {
+    return;
+  }
+  for (t = taskList; t != NULL; t = t->allNext)
+  {
+    if (t == task)
+    {
+      break;
+    }
+  }
+  if (t != NULL)
+  {
+    /* Re-initialized: unlink a running release timer before clearing it */
+    swtimer_stop(&task->timer);
+  }
+
+  task->next = NULL;
+  task->name = name;
+  task->handler = handler;
+  task->ctx = ctx;
+  task->priority = (priority < SCHED_PRIORITIES) ? priority : (SCHED_PRIORITIES - 1);
+  task->queued = false;
+  task->events = 0;
+  task->timer.active = false;
+  task->deadlineCycles = 0;
+  task->releaseCycles = 0;
+  task->runCycles = 0;
+  task->runs = 0;
+  task->maxRunCycles = 0;
+  task->maxLatencyCycles = 0;
+  task->deadlineMisses = 0;
+  task->windowCycles = 0;
+  task->loadPermille = 0;
+
+  if (t == NULL)
+  {
+    task->allNext = taskList;
+    taskList = task;
+  }
+}
+
+/**
+ * @brief Release a task periodically with SCHED_EVENT_PERIOD
+ * @param task - initialized task
+ * @param periodUs - release period, rounded to the wheel tick
+ * @param deadlineUs - maximum release to start latency, 0 = not checked
+ * @return 1 on success, 0 if the scheduler has no timer or the period is shorter than a tick
+ */
+int sched_task_periodic(sched_task_t* task, uint32_t periodUs, uint32_t deadlineUs)
+{
+  uint32_t ticks;
+  uint64_t deadline;
+
+  if (task == NULL || schedTickUs == 0 || periodUs < schedTickUs)
+  {
+    return 0;
+  }
+  ticks = (periodUs + schedTickUs / 2) / schedTickUs;
+
+  /* Latency is measured on the 32-bit counter, clamp longer deadlines */
+  deadline = time_us_to_cycles(deadlineUs);
+  task->deadlineCycles = (deadline > UINT32_MAX) ? UINT32_MAX : (uint32_t)deadline;
+  swtimer_start(&task->timer, ticks, ticks, sched_release, task);
+  return 1;
+}
+
+/**
+ * @brief Stop periodic releases of a task
+ */
+void sched_task_stop(sched_task_t* task)
+{
+  if (task != NULL)
+  {
+    swtimer_stop(&task->timer);
+  }
+}
+
+/**
+ * @brief Post events to a task, safe from interrupts
+ * @param task - target task
+ * @param events - bits ORed into the pending events
+ */
+void sched_post(sched_task_t* task, uint32_t events)
+{
+  uint32_t primask;
+
+  if (task == NULL || events == 0)
+  {
+    return;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  task->events |= events;
+  if (!task->queued)
+  {
+    sched_enqueue(task);
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Route a driver interrupt source to a task
+ * @param source - interrupt source
+ * @param task - task to post to, NULL to unbind
+ * @param events - bits posted when the source fires
+ */
+void sched_bind(sched_source_t source, sched_task_t* task, uint32_t events)
+{
+  uint32_t primask;
+
+  if (source >= SCHED_SRC_COUNT)
+  {
+    return;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  sources[source].task = task;
+  sources[source].events = events;
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Called by drivers from their interrupt handlers
+ * @param source - interrupt source that fired
+ */
+void sched_signal(sched_source_t source)
+{
+  if (source < SCHED_SRC_COUNT && sources[source].task != NULL)
+  {
+    sched_post(sources[source].task, sources[source].events);
+  }
+}
+
+/**
+ * @brief Run the highest priority ready task to completion
+ * @return true if a task ran, false if none was ready
+ */
+bool sched_run_once(void)
+{
+  uint32_t primask;
+  sched_task_t* task;
+  uint32_t events;
+  uint32_t release;
+  uint32_t start;
+  uint32_t elapsed;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  task = sched_dequeue();
+  if (task == NULL)
+  {
+    __set_PRIMASK(primask);
+    return false;
+  }
+  events = task->events;
+  task->events = 0;
+  release = task->releaseCycles;
+  __set_PRIMASK(primask);
+
+  start = SCHED_CYCLES();
+  if ((events & SCHED_EVENT_PERIOD) != 0)
+  {
+    uint32_t latency = start - release;
+    if (latency > task->maxLatencyCycles)
+    {
+      task->maxLatencyCycles = latency;
+    }
+    if (task->deadlineCycles != 0 && latency > task->deadlineCycles)
+    {
+      task->deadlineMisses++;
+    }
+  }
+
+  task->handler(task->ctx, events);
+
+  elapsed = SCHED_CYCLES() - start;
+  task->runs++;
+  task->runCycles += elapsed;
+  task->windowCycles += elapsed;
+  if (elapsed > task->maxRunCycles)
+  {
+    task->maxRunCycles = elapsed;
+  }
+  return true;
+}
+
+/**
+ * @brief Scheduler loop, never returns
+ *
+ * Sleeps in WFI when no task is ready. Interrupts are masked between the
+ * ready check and WFI so a post from an interrupt cannot be missed: the
+ * pending interrupt wakes the core, and runs once they are unmasked.
+ */
+void sched_run(void)
+{
+  while (1)
+  {
+    if (sched_run_once())
+    {
+      continue;
+    }
+    __disable_irq();
+    if (readyMask == 0)
+    {
+      idleCycles += sleep_idle();
+    }
+    __enable_irq();
+  }
+}
+
+/**
+ * @brief Close the load window and return the CPU load
+ *
+ * Also latches each task's share of the window (sched_get_task_stats). Call
+ * at a fixed rate, at least once per DWT counter wrap (2^32 cycles).
+ *
+ * @return busy time in permille of the window (interrupts count as busy)
+ */
+uint16_t sched_cpu_load(void)
+{
+  uint32_t primask;
+  uint32_t now;
+  uint32_t window;
+  uint32_t idle;
+  sched_task_t* task;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  now = SCHED_CYCLES();
+  window = now - windowStart;
+  windowStart = now;
+  idle = idleCycles;
+  idleCycles = 0;
+  __set_PRIMASK(primask);
+
+  if (window == 0)
+  {
+    return 0;
+  }
+  for (task = taskList; task != NULL; task = task->allNext)
+  {
+    task->loadPermille = (uint16_t)(((uint64_t)task->windowCycles * 1000) / window);
+    task->windowCycles = 0;
+  }
+  if (idle > window)
+  {
+    idle = window;
+  }
+  return (uint16_t)(((uint64_t)(window - idle) * 1000) / window);
+}
+
+/**
+ * @brief Read the accounting of a task
+ * @param task - task
+ * @param stats - output
+ */
+void sched_get_task_stats(const sched_task_t* task, sched_task_stats_t* stats)
+{
+  uint32_t rate = time_cycles_per_us_q16();
+
+  if (task == NULL || stats == NULL)
+  {
+    return;
+  }
+  stats->runs = task->runs;
+  /* Q16 rate keeps the fraction of non-integer MHz clocks */
+  stats->maxRunUs = (uint32_t)(((uint64_t)task->maxRunCycles << 16) / rate);
+  stats->maxLatencyUs = (uint32_t)(((uint64_t)task->maxLatencyCycles << 16) / rate);
+  stats->deadlineMisses = task->deadlineMisses;
+  stats->loadPermille = task->loadPermille;
+}
@@ -0,0 +1,122 @@
+#ifndef __MPS_SCHED_H__
+#define __MPS_SCHED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "n32h47x_48x_tim.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mps_swtimer.h"
+
+/**
+ * @brief Cooperative run-to-completion scheduler
+ *
+ * Tasks are handler functions that run when events are posted to them. Events
+ * are bits ORed into the task, so posting is O(1), never blocks and is safe
+ * from any interrupt; the handler receives and clears all pending bits at
+ * once. Ready tasks run highest priority first (0 is highest), FIFO within a
+ * priority, and the CPU sleeps in WFI when nothing is ready.
+ *
+ * Periodic tasks are released by the timer wheel (mps_swtimer.h) on the GTIM
+ * given to sched_init, with their release-to-start latency checked against a
+ * deadline. Run time of every task and of the idle loop is measured with the
+ * DWT cycle counter.
+ *
+ * Drivers post events through sched_signal: an interrupt source bound with
+ * sched_bind posts its events to a task, unbound sources cost one table read.
+ */
+
+#define SCHED_PRIORITIES    4
+#define SCHED_EVENT_PERIOD  (1u << 31)    /* Periodic release, other bits are free */
+
+/**
+ * @brief Task handler, events = all bits posted since the previous run
+ */
+typedef void (*sched_handler_t)(void* ctx, uint32_t events);
+
+/**
+ * @brief Interrupt sources drivers signal
+ */
+typedef enum {
+  SCHED_SRC_UART1_RX = 0,         /* New data in the RX ring */
+  SCHED_SRC_UART2_RX,
+  SCHED_SRC_UART3_RX,
+  SCHED_SRC_UART1_TX,             /* TX DMA transfer complete */
+  SCHED_SRC_UART2_TX,
+  SCHED_SRC_UART3_TX,
+  SCHED_SRC_GTIM1,                /* Timer update */
+  SCHED_SRC_GTIM2,
+  SCHED_SRC_GTIM3,
+  SCHED_SRC_GTIM4,
+  SCHED_SRC_GTIM5,
+  SCHED_SRC_GTIM6,
+  SCHED_SRC_GTIM7,
+  SCHED_SRC_ADC1,                 /* End of regular sequence (adc_interrupt_init) */
+  SCHED_SRC_ADC2,
+  SCHED_SRC_ADC3,
+  SCHED_SRC_ADC4,
+  SCHED_SRC_EXTI0,                /* EXTI line 0-15 */
+  SCHED_SRC_EXTI15 = SCHED_SRC_EXTI0 + 15,
+  SCHED_SRC_COUNT
+} sched_source_t;
+
+/**
+ * @brief Task control block, owned by the caller
+ */
+typedef struct sched_task {
+  struct sched_task* next;        /* Ready queue link */
+  struct sched_task* allNext;     /* Registry of all tasks */
+  const char* name;
+  sched_handler_t handler;
+  void* ctx;
+  uint8_t priority;
+  volatile bool queued;
+  volatile uint32_t events;       /* Pending event bits */
+
+  /* Periodic release */
+  swtimer_t timer;
+  uint32_t deadlineCycles;        /* Release to start, 0 = not checked */
+  volatile uint32_t releaseCycles;
+
+  /* Accounting */
+  uint64_t runCycles;             /* Total handler run time */
+  uint32_t runs;
+  uint32_t maxRunCycles;
+  uint32_t maxLatencyCycles;      /* Worst release to start */
+  uint32_t deadlineMisses;        /* Late starts and overrun releases */
+  uint32_t windowCycles;          /* Run time in the current load window */
+  uint16_t loadPermille;          /* Share of the CPU in the last closed window */
+} sched_task_t;
+
+/**
+ * @brief Task statistics
+ */
+typedef struct {
+  uint32_t runs;
+  uint32_t maxRunUs;
+  uint32_t maxLatencyUs;
+  uint32_t deadlineMisses;
+  uint16_t loadPermille;          /* Share of the CPU in the window closed by sched_cpu_load */
+} sched_task_stats_t;
+
+int sched_init(TIM_Module* TIMx, uint32_t tickUs);
+void sched_task_init(sched_task_t* task, const char* name, uint8_t priority,
+                     sched_handler_t handler, void* ctx);
+int sched_task_periodic(sched_task_t* task, uint32_t periodUs, uint32_t deadlineUs);
+void sched_task_stop(sched_task_t* task);
+void sched_post(sched_task_t* task, uint32_t events);
+void sched_bind(sched_source_t source, sched_task_t* task, uint32_t events);
+void sched_signal(sched_source_t source);
+bool sched_run_once(void);
+void sched_run(void);
+uint16_t sched_cpu_load(void);
+void sched_get_task_stats(const sched_task_t* task, sched_task_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_SCHED_H__ */
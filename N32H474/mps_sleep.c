@@ -0,0 +1,190 @@
+#include "mps_sleep.h"
+#include "mps_timer.h"
+#include "n32h47x_48x.h"
+
+#define SLEEP_MAX_TICKS     0x10000u      /* Longest single timer pulse */
+
+static TIM_Module* sleepTimer = NULL;     /* Wake-up timer, NULL = always spin */
+static uint32_t sleepTickCyclesQ16 = 1u << 16;   /* Core cycles per timer tick, Q16.16 rounded up */
+static volatile bool sleepWoke = false;   /* Wake-up pulse has ended */
+static uint32_t sleepCycles = 0;          /* Time asleep in the current window */
+static uint32_t windowStart = 0;
+
+/**
+ * @brief Wake-up timer update interrupt, the pulse has ended
+ */
+static void sleep_wakeup(void)
+{
+  sleepWoke = true;
+}
+
+/**
+ * @brief Dedicate a timer to sleeping waits
+ * @param TIMx - GTIM1-GTIM7, not shared with anything else
+ * @return 1 on success, 0 on invalid parameters
+ */
+int sleep_init(TIM_Module* TIMx)
+{
+  TIM_TimeBaseInitType timer_config;
+  uint32_t prescaler;
+
+  time_init();
+  windowStart = time_cycles32();
+  sleepCycles = 0;
+
+  prescaler = timer_get_clock() / 1000000;
+  if (prescaler == 0 || prescaler > 65536 || !timer_init_oneshot(TIMx, 1000, sleep_wakeup))
+  {
+    sleepTimer = NULL;
+    return 0;
+  }
+
+  /* Same clock and interrupt setup as a one-shot timer, then counter in 1 us ticks */
+  TIM_Enable(TIMx, DISABLE);
+  timer_config.Prescaler = (uint16_t)(prescaler - 1);
+  timer_config.Period = 0xFFFF;
+  timer_config.CounterMode = TIM_CNT_MODE_UP;
+  timer_config.ClkDiv = TIM_CLK_DIV1;
+  timer_config.RepetCnt = 0;
+  TIM_InitTimeBase(TIMx, &timer_config);
+  TIM_ConfigPrescaler(TIMx, timer_config.Prescaler, TIM_PSC_RELOAD_MODE_IMMEDIATE);
+  TIM_ConfigArPreload(TIMx, DISABLE);   /* Each pulse length must act immediately */
+  TIM_ClrIntPendingBit(TIMx, TIM_INT_UPDATE);
+
+  /* Rounded up, so a pulse never ends after the deadline */
+  sleepTickCyclesQ16 = (uint32_t)(((uint64_t)time_cycles_per_us_q16() * 1000000 * prescaler +
+                                   timer_get_clock() - 1) / timer_get_clock());
+  sleepTimer = TIMx;
+  return 1;
+}
+
+/**
+ * @brief Start one wake-up pulse
+ * @param ticks - pulse length, 1..SLEEP_MAX_TICKS
+ */
+static void sleep_arm(uint32_t ticks)
+{
+  TIM_Enable(sleepTimer, DISABLE);
+  sleepWoke = false;
+  TIM_SetAutoReload(sleepTimer, (uint16_t)(ticks - 1));
+  TIM_SetCnt(sleepTimer, 0);
+  TIM_ClrIntPendingBit(sleepTimer, TIM_INT_UPDATE);
+  TIM_Enable(sleepTimer, ENABLE);   /* One pulse mode stops the counter at the update */
+}
+
+/**
+ * @brief Wait for any interrupt in Sleep mode, call with interrupts masked
+ *
+ * For idle loops: check for work with interrupts masked, then call this so
+ * an interrupt arriving in between still wakes the core. Interrupts are
+ * served after the caller unmasks them.
+ *
+ * @return cycles spent asleep
+ */
+uint32_t sleep_idle(void)
+{
+  uint32_t start = time_cycles32();
+  uint32_t slept;
+
+  __WFI();
+  slept = time_cycles32() - start;
+  sleepCycles += slept;
+  return slept;
+}
+
+/**
+ * @brief Wait until a deadline, sleeping while it is far enough away
+ * @param deadline - absolute time, see time_deadline_us
+ */
+void sleep_until(time_deadline_t deadline)
+{
+  uint64_t spinCycles = time_us_to_cycles(SLEEP_SPIN_US);
+
+  while (1)
+  {
+    uint64_t now = time_now_cycles();
+    uint64_t remaining;
+    uint64_t ticks;
+
+    if (now >= deadline)
+    {
+      return;
+    }
+    remaining = deadline - now;
+    if (sleepTimer == NULL || remaining <= spinCycles)
+    {
+      break;
+    }
+
+    /* Sleep up to the spun tail, in pulses of at most SLEEP_MAX_TICKS */
+    remaining -= spinCycles;
+    if (remaining > ((uint64_t)SLEEP_MAX_TICKS * sleepTickCyclesQ16) >> 16)
+    {
+      remaining = ((uint64_t)SLEEP_MAX_TICKS * sleepTickCyclesQ16) >> 16;
+    }
+    ticks = (remaining << 16) / sleepTickCyclesQ16;
+    if (ticks == 0)
+    {
+      break;
+    }
+    sleep_arm((ticks > SLEEP_MAX_TICKS) ? SLEEP_MAX_TICKS : (uint32_t)ticks);
+
+    __disable_irq();
+    if (!sleepWoke)
+    {
+      (void)sleep_idle();
+    }
+    __enable_irq();
+  }
+
+  while (!time_expired(deadline));
+}
+
+/**
+ * @brief Sleeping wait of a number of microseconds
+ */
+void sleep_us(uint32_t us)
+{
+  sleep_until(time_deadline_us(us));
+}
+
+/**
+ * @brief Sleeping wait of a number of milliseconds
+ */
+void sleep_ms(uint32_t ms)
+{
+  sleep_until(time_now_cycles() + time_us_to_cycles((uint64_t)ms * 1000));
+}
+
+/**
+ * @brief Close the accounting window and return the time spent asleep
+ *
+ * Call at a fixed rate, at least once per DWT counter wrap (2^32 cycles).
+ *
+ * @return time asleep in permille of the window
+ */
+uint16_t sleep_idle_permille(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t now;
+  uint32_t window;
+  uint32_t slept;
+
+  __disable_irq();
+  now = time_cycles32();
+  window = now - windowStart;
+  windowStart = now;
+  slept = sleepCycles;
+  sleepCycles = 0;
+  __set_PRIMASK(primask);
+
+  if (window == 0)
+  {
+    return 0;
+  }
+  if (slept > window)
+  {
+    slept = window;
+  }
+  return (uint16_t)(((uint64_t)slept * 1000) / window);
+}
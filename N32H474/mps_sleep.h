@@ -0,0 +1,44 @@
+#ifndef __MPS_SLEEP_H__
+#define __MPS_SLEEP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "n32h47x_48x_tim.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "mps_time.h"
+
+/**
+ * @brief Sleeping waits
+ *
+ * sleep_until puts the core in Sleep mode (WFI) until a deadline of the
+ * monotonic timebase (mps_time.h). A GTIM dedicated to sleep_init runs one
+ * pulse in 1 us ticks and its update interrupt wakes the core; any other
+ * interrupt wakes it too and is served, the wait then goes back to sleep.
+ * The last SLEEP_SPIN_US before the deadline are spun on the cycle counter,
+ * which hides the wake-up latency and keeps the deadline accurate, so
+ * intervals shorter than that never sleep at all. Without sleep_init every
+ * wait spins.
+ *
+ * Interrupts must be enabled while waiting, so do not call from an ISR.
+ *
+ * Sleep time is accounted, both from sleep_until and from the idle loop
+ * (sleep_idle), and sleep_idle_permille reports the share of time asleep.
+ */
+
+#define SLEEP_SPIN_US       20      /* Spun tail of every wait, covers timer arming and wake-up */
+
+int sleep_init(TIM_Module* TIMx);
+void sleep_until(time_deadline_t deadline);
+void sleep_us(uint32_t us);
+void sleep_ms(uint32_t ms);
+uint32_t sleep_idle(void);
+uint16_t sleep_idle_permille(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_SLEEP_H__ */
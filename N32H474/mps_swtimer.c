@@ -0,0 +1,338 @@
+#include "mps_swtimer.h"
+
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+#include "n32h47x_48x.h"
+#define SWTIMER_LOCK()      uint32_t primask_ = __get_PRIMASK(); __disable_irq()
+#define SWTIMER_UNLOCK()    __set_PRIMASK(primask_)
+#define SWTIMER_CTZ(x)      __CLZ(__RBIT(x))
+#else
+#define SWTIMER_LOCK()      do { } while (0)
+#define SWTIMER_UNLOCK()    do { } while (0)
+#define SWTIMER_CTZ(x)      ((uint32_t)__builtin_ctz(x))
+#endif
+
+#define SWTIMER_MASK        (SWTIMER_SLOTS - 1)
+
+static swtimer_t* wheel[SWTIMER_LEVELS][SWTIMER_SLOTS];
+static uint32_t occupied[SWTIMER_LEVELS][SWTIMER_SLOTS / 32];   /* Bit set = slot not empty */
+static uint32_t wheelNow;           /* Last processed tick */
+static swtimer_hw_t wheelHw;
+static bool wheelAdvancing;         /* Inside swtimer_advance, schedule once at the end */
+
+/**
+ * @brief Ticks counted by the hardware but not yet processed
+ *
+ * Inside swtimer_advance the wheel time is the expiry being processed, so a
+ * callBack that restarts its timer measures from its own expiry without drift.
+ */
+static inline uint32_t wheel_pending(void)
+{
+  return (wheelHw.pending != NULL && !wheelAdvancing) ? wheelHw.pending() : 0;
+}
+
+/**
+ * @brief Slot index of a level for an absolute tick
+ */
+static inline uint32_t slot_of(uint32_t tick, uint32_t level)
+{
+  return (tick >> (SWTIMER_SLOT_BITS * level)) & SWTIMER_MASK;
+}
+
+/**
+ * @brief Link a timer into the slot matching its expiry
+ */
+static void wheel_insert(swtimer_t* timer)
+{
+  uint32_t delta = timer->expires - wheelNow;
+  uint32_t tick = timer->expires;
+  uint32_t level = 0;
+  uint32_t slot;
+  swtimer_t** head;
+
+  while (level < SWTIMER_LEVELS - 1 && delta >= (1u << (SWTIMER_SLOT_BITS * (level + 1))))
+  {
+    level++;
+  }
+  if (delta >= SWTIMER_RANGE)
+  {
+    /* Beyond the wheel: park at the far end of the top level, re-cascaded later */
+    tick = wheelNow + SWTIMER_RANGE - 1;
+  }
+  slot = slot_of(tick, level);
+
+  head = &wheel[level][slot];
+  timer->prev = NULL;
+  timer->next = *head;
+  if (*head != NULL)
+  {
+    (*head)->prev = timer;
+  }
+  *head = timer;
+  timer->level = (uint8_t)level;
+  timer->slot = (uint8_t)slot;
+  occupied[level][slot / 32] |= 1u << (slot % 32);
+}
+
+/**
+ * @brief Unlink a queued timer
+ */
+static void wheel_remove(swtimer_t* timer)
+{
+  swtimer_t** head = &wheel[timer->level][timer->slot];
+
+  if (timer->prev != NULL)
+  {
+    timer->prev->next = timer->next;
+  }
+  else
+  {
+    *head = timer->next;
+  }
+  if (timer->next != NULL)
+  {
+    timer->next->prev = timer->prev;
+  }
+  if (*head == NULL)
+  {
+    occupied[timer->level][timer->slot / 32] &= ~(1u << (timer->slot % 32));
+  }
+  timer->next = NULL;
+  timer->prev = NULL;
+}
+
+/**
+ * @brief Distance from slot index 'from' to the next occupied slot of a level
+ * @return 1..SWTIMER_SLOTS, 0 if the level is empty
+ */
+static uint32_t next_occupied(uint32_t level, uint32_t from)
+{
+  uint32_t k;
+
+  for (k = 1; k <= SWTIMER_SLOTS; )
+  {
+    uint32_t slot = (from + k) & SWTIMER_MASK;
+    uint32_t bits = occupied[level][slot / 32] >> (slot % 32);
+
+    if (bits != 0)
+    {
+      return k + SWTIMER_CTZ(bits);
+    }
+    k += 32 - (slot % 32);   /* Skip to the next word */
+  }
+  return 0;
+}
+
+/**
+ * @brief Ticks from wheelNow to the next tick that has work (expiry or cascade)
+ */
+static uint32_t ticks_to_next(void)
+{
+  uint32_t best = SWTIMER_RANGE;
+  uint32_t level;
+
+  for (level = 0; level < SWTIMER_LEVELS; level++)
+  {
+    uint32_t shift = SWTIMER_SLOT_BITS * level;
+    uint32_t k = next_occupied(level, slot_of(wheelNow, level));
+    if (k != 0)
+    {
+      /* Level 0 slot expires at that tick, higher slots cascade at their boundary */
+      uint32_t when = (((wheelNow >> shift) + k) << shift) - wheelNow;
+      if (when < best)
+      {
+        best = when;
+      }
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Process one tick: cascade higher levels, then run expired timers
+ */
+static void wheel_tick(void)
+{
+  uint32_t level;
+  swtimer_t* timer;
+
+  wheelNow++;
+
+  for (level = 1; level < SWTIMER_LEVELS; level++)
+  {
+    uint32_t slot;
+
+    if ((wheelNow & ((1u << (SWTIMER_SLOT_BITS * level)) - 1)) != 0)
+    {
+      break;
+    }
+    slot = slot_of(wheelNow, level);
+    while ((timer = wheel[level][slot]) != NULL)
+    {
+      wheel_remove(timer);
+      wheel_insert(timer);
+    }
+  }
+
+  while ((timer = wheel[0][wheelNow & SWTIMER_MASK]) != NULL)
+  {
+    wheel_remove(timer);
+    if (timer->period != 0)
+    {
+      timer->expires += timer->period;
+      wheel_insert(timer);
+    }
+    else
+    {
+      timer->active = false;
+    }
+    timer->callBack(timer->ctx);
+  }
+}
+
+/**
+ * @brief Ask the hardware for the next advance (tickless mode only)
+ */
+static void wheel_schedule(void)
+{
+  if (wheelHw.schedule != NULL && !wheelAdvancing)
+  {
+    wheelHw.schedule(ticks_to_next());
+  }
+}
+
+/**
+ * @brief Reset the wheel
+ * @param hw - tickless hardware binding, NULL when ticking at a fixed rate
+ */
+void swtimer_wheel_init(const swtimer_hw_t* hw)
+{
+  uint32_t level;
+  uint32_t slot;
+
+  for (level = 0; level < SWTIMER_LEVELS; level++)
+  {
+    for (slot = 0; slot < SWTIMER_SLOTS; slot++)
+    {
+      wheel[level][slot] = NULL;
+    }
+    for (slot = 0; slot < SWTIMER_SLOTS / 32; slot++)
+    {
+      occupied[level][slot] = 0;
+    }
+  }
+  wheelNow = 0;
+  wheelAdvancing = false;
+  wheelHw.pending = (hw != NULL) ? hw->pending : NULL;
+  wheelHw.schedule = (hw != NULL) ? hw->schedule : NULL;
+}
+
+/**
+ * @brief Start (or restart) a timer
+ * @param timer - entry, must stay valid while active
+ * @param delayTicks - ticks until the first expiry (0 is treated as 1)
+ * @param periodTicks - reload after each expiry, 0 for a one-shot timer
+ * @param callBack - function called from the tick interrupt
+ * @param ctx - passed to callBack
+ */
+void swtimer_start(swtimer_t* timer, uint32_t delayTicks, uint32_t periodTicks,
+                   swtimer_callback_t callBack, void* ctx)
+{
+  if (timer == NULL || callBack == NULL)
+  {
+    return;
+  }
+  if (delayTicks == 0)
+  {
+    delayTicks = 1;
+  }
+
+  SWTIMER_LOCK();
+  if (timer->active)
+  {
+    wheel_remove(timer);
+  }
+  timer->expires = wheelNow + wheel_pending() + delayTicks;
+  timer->period = periodTicks;
+  timer->callBack = callBack;
+  timer->ctx = ctx;
+  timer->active = true;
+  wheel_insert(timer);
+  wheel_schedule();
+  SWTIMER_UNLOCK();
+}
+
+/**
+ * @brief Stop a timer, safe to call on an inactive timer or from its own callBack
+ */
+void swtimer_stop(swtimer_t* timer)
+{
+  if (timer == NULL)
+  {
+    return;
+  }
+  SWTIMER_LOCK();
+  if (timer->active)
+  {
+    wheel_remove(timer);
+    timer->active = false;
+  }
+  SWTIMER_UNLOCK();
+}
+
+/**
+ * @brief Check whether a timer is queued
+ */
+bool swtimer_active(const swtimer_t* timer)
+{
+  return timer != NULL && timer->active;
+}
+
+/**
+ * @brief Advance the wheel, running every timer that expires on the way
+ *
+ * Stretches without work are skipped in one step, so a tickless wake-up after
+ * a long sleep costs time proportional to the number of expiries and cascades,
+ * not to the number of ticks. Call from the tick interrupt.
+ *
+ * @param ticks - ticks elapsed since the previous call
+ */
+void swtimer_advance(uint32_t ticks)
+{
+  uint32_t target = wheelNow + ticks;
+
+  wheelAdvancing = true;
+  while (wheelNow != target)
+  {
+    uint32_t step = ticks_to_next();
+    uint32_t remaining = target - wheelNow;
+
+    if (step > remaining)
+    {
+      wheelNow = target;
+      break;
+    }
+    wheelNow += step - 1;
+    wheel_tick();
+  }
+  wheelAdvancing = false;
+  wheel_schedule();
+}
+
+/**
+ * @brief Ticks from now until the next expiry or cascade, at most SWTIMER_RANGE
+ */
+uint32_t swtimer_next(void)
+{
+  uint32_t pending = wheel_pending();
+  uint32_t next = ticks_to_next();
+
+  return (next > pending) ? next - pending : 0;
+}
+
+/**
+ * @brief Current time in ticks
+ */
+uint32_t swtimer_now(void)
+{
+  return wheelNow + wheel_pending();
+}
@@ -0,0 +1,72 @@
+#ifndef __MPS_SWTIMER_H__
+#define __MPS_SWTIMER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Hierarchical timing wheel
+ *
+ * Any number of software timers share one hardware tick source. Time is
+ * counted in ticks; the wheel has SWTIMER_LEVELS levels of SWTIMER_SLOTS
+ * slots, level n covering delays up to SWTIMER_SLOTS^(n+1) ticks. Entries are
+ * intrusive doubly-linked list nodes, so start and stop are O(1) and need no
+ * allocation. Longer delays are parked in the top level and re-cascaded.
+ *
+ * The wheel itself does not touch hardware. timer_wheel_init (mps_timer.c)
+ * binds it to a GTIM, either ticking at a fixed rate or tickless, where the
+ * GTIM is reprogrammed to fire only at the next expiry.
+ */
+
+#define SWTIMER_SLOT_BITS   6
+#define SWTIMER_SLOTS       (1u << SWTIMER_SLOT_BITS)
+#define SWTIMER_LEVELS      4
+#define SWTIMER_RANGE       (1u << (SWTIMER_SLOT_BITS * SWTIMER_LEVELS))   /* Longest exact delay */
+
+/**
+ * @brief Software timer callBack, runs in the tick interrupt
+ */
+typedef void (*swtimer_callback_t)(void* ctx);
+
+/**
+ * @brief Software timer entry, owned by the caller (static or embedded in a struct)
+ */
+typedef struct swtimer {
+  struct swtimer* next;
+  struct swtimer* prev;
+  uint32_t expires;               /* Absolute tick */
+  uint32_t period;                /* Reload in ticks, 0 = one-shot */
+  swtimer_callback_t callBack;
+  void* ctx;
+  uint8_t level;                  /* Position while queued */
+  uint8_t slot;
+  bool active;
+} swtimer_t;
+
+/**
+ * @brief Hardware binding used in tickless mode
+ */
+typedef struct {
+  uint32_t (*pending)(void);            /* Ticks elapsed since the wheel was last advanced */
+  void (*schedule)(uint32_t ticks);     /* Request an advance after this many ticks from the last advance */
+} swtimer_hw_t;
+
+void swtimer_wheel_init(const swtimer_hw_t* hw);
+void swtimer_start(swtimer_t* timer, uint32_t delayTicks, uint32_t periodTicks,
+                   swtimer_callback_t callBack, void* ctx);
+void swtimer_stop(swtimer_t* timer);
+bool swtimer_active(const swtimer_t* timer);
+void swtimer_advance(uint32_t ticks);
+uint32_t swtimer_next(void);
+uint32_t swtimer_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_SWTIMER_H__ */
@@ -0,0 +1,495 @@
+#include "mps_telemetry.h"
+#include "mps_uart.h"
+#include "mps_crc.h"
+#include "mps_hrpwm.h"
+#include "mpf4279x_decode.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Bits per byte on the wire for 8N1 (start + 8 data + stop) */
+#define TELEM_BITS_PER_BYTE     10
+
+/* Period after which an automatically raised decimation is relaxed again */
+#define TELEM_RELAX_PERIOD_US   1000000
+
+/* Per-channel policy */
+typedef struct {
+  telem_priority_t priority;
+  uint16_t decimation;        /* Configured: send every Nth sample */
+  uint16_t activeDecimation;  /* Effective, raised while over budget */
+  uint16_t counter;           /* Samples since the last sent one */
+  uint16_t lastSize;          /* Encoded size of the last frame, budget estimate */
+  bool droppedInWindow;       /* Budget drop since the last relax */
+} telem_channel_t;
+
+static USART_Module* telemPort = NULL;
+static telem_frame_t telemPool[TELEM_POOL_SIZE];
+static volatile uint32_t telemFreeMask;     /* Bit set = buffer free */
+static telem_channel_t telemChannels[TELEM_TYPE_COUNT];
+static int32_t telemTokens;                 /* Bytes that may be sent now */
+static int32_t telemBurst;                  /* Bucket size in bytes */
+static uint32_t telemRemainder;             /* Sub-byte refill carry */
+static uint32_t telemRelaxUs;
+static uint8_t telemSeq;
+static telem_stats_t telemStats;
+
+/**
+ * @brief Ownership-return callBack of the UART driver, frees a frame buffer
+ */
+static void telem_tx_done(void* ctx, const uint8_t* data, uint16_t length)
+{
+  (void)data;
+  (void)length;
+  telemFreeMask |= (uint32_t)ctx;
+}
+
+/**
+ * @brief Take a free frame buffer, NULL if all are queued on the DMA
+ */
+static telem_frame_t* telem_alloc(void)
+{
+  telem_frame_t* frame = NULL;
+  uint32_t primask = __get_PRIMASK();
+  uint8_t i;
+
+  __disable_irq();
+  for (i = 0; i < TELEM_POOL_SIZE; i++)
+  {
+    if (telemFreeMask & (1UL << i))
+    {
+      telemFreeMask &= ~(1UL << i);
+      frame = &telemPool[i];
+      break;
+    }
+  }
+  __set_PRIMASK(primask);
+  return frame;
+}
+
+/**
+ * @brief Return an unsent frame buffer to the pool
+ */
+static void telem_release(telem_frame_t* frame)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  telemFreeMask |= 1UL << (uint32_t)(frame - telemPool);
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Minimum bucket level that must remain after sending at a priority
+ */
+static int32_t telem_reserve(telem_priority_t priority)
+{
+  if (priority == TELEM_PRIO_LOW) return telemBurst / 2;
+  else if (priority == TELEM_PRIO_NORMAL) return telemBurst / 4;
+  else return 0;
+}
+
+/**
+ * @brief COBS encode in place
+ *
+ * The frame occupies buffer[1..length]; buffer[0] is reserved for the first
+ * code byte. Each zero is replaced by the distance to the next zero (or to the
+ * end), which is valid without inserting bytes because length <= 253.
+ *
+ * @return encoded length including the trailing delimiter
+ */
+static uint16_t telem_cobs_encode(uint8_t* buffer, uint16_t length)
+{
+  uint16_t code = 0;
+  uint16_t i;
+
+  for (i = 1; i <= length; i++)
+  {
+    if (buffer[i] == 0)
+    {
+      buffer[code] = (uint8_t)(i - code);
+      code = i;
+    }
+  }
+  buffer[code] = (uint8_t)(length + 1 - code);
+  buffer[length + 1] = TELEM_DELIMITER;
+  return length + 2;
+}
+
+/**
+ * @brief Start streaming telemetry on an initialized UART
+ * @param USARTx - UART port, its achieved baud rate sets the link bandwidth
+ * @param budgetPercent - share of the link bandwidth telemetry may use (1-100)
+ * @return 1 if successful, 0 if failed
+ */
+int telem_init(USART_Module* USARTx, uint8_t budgetPercent)
+{
+  uint8_t i;
+
+  if (budgetPercent == 0 || budgetPercent > 100 || uart_get_baud(USARTx) == 0)
+  {
+    return 0;
+  }
+
+  telemPort = USARTx;
+  telemFreeMask = (1UL << TELEM_POOL_SIZE) - 1;
+  telemSeq = 0;
+  telemRelaxUs = 0;
+  memset(&telemStats, 0, sizeof(telemStats));
+
+  for (i = 0; i < TELEM_TYPE_COUNT; i++)
+  {
+    telemChannels[i].priority = TELEM_PRIO_NORMAL;
+    telemChannels[i].decimation = 1;
+    telemChannels[i].activeDecimation = 1;
+    telemChannels[i].counter = 0;
+    telemChannels[i].lastSize = TELEM_MAX_FRAME;
+    telemChannels[i].droppedInWindow = false;
+  }
+  telemChannels[TELEM_TYPE_STATS].priority = TELEM_PRIO_HIGH;
+  telemChannels[TELEM_TYPE_LOG].priority = TELEM_PRIO_HIGH;
+
+  telem_set_bandwidth((uart_get_baud(USARTx) / TELEM_BITS_PER_BYTE) * budgetPercent / 100);
+  return 1;
+}
+
+/**
+ * @brief Set the telemetry budget, e.g. after uart_set_baud
+ * @param bytesPerSecond - bytes per second telemetry may put on the wire
+ */
+void telem_set_bandwidth(uint32_t bytesPerSecond)
+{
+  telemStats.bandwidth = bytesPerSecond;
+
+  /* Allow a 50ms burst, but always at least two full frames */
+  telemBurst = (int32_t)(bytesPerSecond / 20);
+  if (telemBurst < 2 * TELEM_MAX_FRAME)
+  {
+    telemBurst = 2 * TELEM_MAX_FRAME;
+  }
+  telemTokens = telemBurst;
+  telemRemainder = 0;
+}
+
+/**
+ * @brief Configure the policy of one channel
+ * @param type - channel
+ * @param priority - share of the token bucket the channel may use
+ * @param decimation - send every Nth sample offered to telem_begin (1 = all)
+ */
+void telem_channel_config(telem_type_t type, telem_priority_t priority, uint16_t decimation)
+{
+  if (type >= TELEM_TYPE_COUNT)
+  {
+    return;
+  }
+  if (decimation == 0)
+  {
+    decimation = 1;
+  }
+  telemChannels[type].priority = priority;
+  telemChannels[type].decimation = decimation;
+  telemChannels[type].activeDecimation = decimation;
+  telemChannels[type].counter = 0;
+}
+
+/**
+ * @brief Refill the token bucket and relax automatic decimation
+ * @param elapsedUs - time since the previous call
+ */
+void telem_refill(uint32_t elapsedUs)
+{
+  uint64_t credit = (uint64_t)elapsedUs * telemStats.bandwidth + telemRemainder;
+  uint8_t i;
+
+  telemTokens += (int32_t)(credit / 1000000);
+  telemRemainder = (uint32_t)(credit % 1000000);
+  if (telemTokens > telemBurst)
+  {
+    telemTokens = telemBurst;
+    telemRemainder = 0;
+  }
+
+  telemRelaxUs += elapsedUs;
+  if (telemRelaxUs >= TELEM_RELAX_PERIOD_US)
+  {
+    telemRelaxUs = 0;
+    for (i = 0; i < TELEM_TYPE_COUNT; i++)
+    {
+      telem_channel_t* ch = &telemChannels[i];
+      if (!ch->droppedInWindow && ch->activeDecimation > ch->decimation)
+      {
+        ch->activeDecimation /= 2;
+        if (ch->activeDecimation < ch->decimation)
+        {
+          ch->activeDecimation = ch->decimation;
+        }
+      }
+      ch->droppedInWindow = false;
+    }
+  }
+}
+
+/**
+ * @brief Offer a sample to a channel and open a frame if it is to be sent
+ *
+ * Applies decimation first, then the bandwidth budget, so skipped samples cost
+ * no encoding work. A channel that hits the budget gets its decimation doubled
+ * until it fits again.
+ *
+ * @param type - channel
+ * @param timestampUs - sample time
+ * @return frame to fill with telem_put_* and send with telem_commit, NULL to skip
+ */
+telem_frame_t* telem_begin(telem_type_t type, uint32_t timestampUs)
+{
+  telem_channel_t* ch;
+  telem_frame_t* frame;
+
+  if (telemPort == NULL || type >= TELEM_TYPE_COUNT)
+  {
+    return NULL;
+  }
+  ch = &telemChannels[type];
+
+  if (++ch->counter < ch->activeDecimation)
+  {
+    return NULL;
+  }
+  ch->counter = 0;
+
+  if (telemTokens - (int32_t)ch->lastSize < telem_reserve(ch->priority))
+  {
+    telemStats.budgetDrops[type]++;
+    ch->droppedInWindow = true;
+    if (ch->activeDecimation < TELEM_MAX_DECIMATION)
+    {
+      ch->activeDecimation *= 2;
+    }
+    return NULL;
+  }
+
+  frame = telem_alloc();
+  if (frame == NULL)
+  {
+    telemStats.bufferDrops[type]++;
+    return NULL;
+  }
+
+  /* Header after the COBS code byte; seq is filled in at commit */
+  frame->type = (uint8_t)type;
+  frame->overflow = false;
+  frame->buffer[1] = (uint8_t)type;
+  frame->length = 2;
+  telem_put_u32(frame, timestampUs);
+  return frame;
+}
+
+/**
+ * @brief Append a byte to the frame payload
+ */
+void telem_put_u8(telem_frame_t* frame, uint8_t value)
+{
+  if (frame->length >= TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD)
+  {
+    frame->overflow = true;
+    return;
+  }
+  frame->buffer[1 + frame->length++] = value;
+}
+
+/**
+ * @brief Append a little-endian 16-bit value to the frame payload
+ */
+void telem_put_u16(telem_frame_t* frame, uint16_t value)
+{
+  telem_put_u8(frame, (uint8_t)value);
+  telem_put_u8(frame, (uint8_t)(value >> 8));
+}
+
+/**
+ * @brief Append a little-endian 32-bit value to the frame payload
+ */
+void telem_put_u32(telem_frame_t* frame, uint32_t value)
+{
+  telem_put_u16(frame, (uint16_t)value);
+  telem_put_u16(frame, (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Seal a frame (sequence, CRC16, COBS) and queue it on the TX DMA
+ * @param frame - frame from telem_begin, owned by the driver afterwards
+ * @return 1 if queued, 0 if dropped
+ */
+int telem_commit(telem_frame_t* frame)
+{
+  telem_channel_t* ch = &telemChannels[frame->type];
+  uint16_t bodyLength;
+  uint16_t crc;
+  uint16_t encoded;
+  uint32_t index = (uint32_t)(frame - telemPool);
+
+  if (frame->overflow)
+  {
+    telem_release(frame);
+    return 0;
+  }
+
+  /* CRC over type/seq (as register address), timestamp and payload */
+  frame->buffer[2] = telemSeq;
+  bodyLength = frame->length - 2;
+  crc = Calculate_CRC16(((uint16_t)telemSeq << 8) | frame->type, (uint8_t)bodyLength, &frame->buffer[3]);
+  frame->buffer[1 + frame->length++] = (uint8_t)crc;
+  frame->buffer[1 + frame->length++] = (uint8_t)(crc >> 8);
+
+  encoded = telem_cobs_encode(frame->buffer, frame->length);
+
+  if (!uart_write_async(telemPort, frame->buffer, encoded, telem_tx_done, (void*)(1UL << index)))
+  {
+    telemStats.bufferDrops[frame->type]++;
+    telem_release(frame);
+    return 0;
+  }
+
+  telemSeq++;
+  telemTokens -= encoded;
+  ch->lastSize = encoded;
+  telemStats.framesSent++;
+  telemStats.bytesSent += encoded;
+  return 1;
+}
+
+/**
+ * @brief Discard a frame from telem_begin without sending it
+ */
+void telem_abort(telem_frame_t* frame)
+{
+  telem_release(frame);
+}
+
+/**
+ * @brief Send raw ADC samples
+ * @param samples - raw conversion results
+ * @param count - number of samples (up to (TELEM_MAX_PAYLOAD - 1) / 2)
+ * @param timestampUs - sample time
+ * @return 1 if queued, 0 if skipped or dropped
+ */
+int telem_send_adc(const uint16_t* samples, uint8_t count, uint32_t timestampUs)
+{
+  telem_frame_t* frame = telem_begin(TELEM_TYPE_ADC, timestampUs);
+  uint8_t i;
+
+  if (frame == NULL)
+  {
+    return 0;
+  }
+  telem_put_u8(frame, count);
+  for (i = 0; i < count; i++)
+  {
+    telem_put_u16(frame, samples[i]);
+  }
+  return telem_commit(frame);
+}
+
+/**
+ * @brief Send the main fields of a raw MPF4279x Meas_REG frame
+ * @param measReg - Meas_REG bytes as read from the device
+ * @param timestampUs - sample time
+ * @return 1 if queued, 0 if skipped or dropped
+ */
+int telem_send_meas(const uint8_t* measReg, uint32_t timestampUs)
+{
+  telem_frame_t* frame = telem_begin(TELEM_TYPE_MEAS, timestampUs);
+  uint8_t i;
+
+  if (frame == NULL)
+  {
+    return 0;
+  }
+  telem_put_u8(frame, SETMAX_NCELLS_SER);
+  for (i = 0; i < SETMAX_NCELLS_SER; i++)
+  {
+    telem_put_u16(frame, mpf4279x_meas_cell(measReg, i));
+  }
+  telem_put_u16(frame, mpf4279x_meas_vpack(measReg));
+  telem_put_u32(frame, (uint32_t)mpf4279x_meas_pack_current(measReg));
+  for (i = 0; i < TELEM_MEAS_TEMPS; i++)
+  {
+    telem_put_u16(frame, (uint16_t)mpf4279x_meas_temp(measReg, i));
+  }
+  telem_put_u16(frame, (uint16_t)mpf4279x_meas_tchip(measReg));
+  telem_put_u16(frame, mpf4279x_meas_cells_balancing(measReg));
+  return telem_commit(frame);
+}
+
+/**
+ * @brief Send the state of every initialized HRPWM timer
+ * @param timestampUs - sample time
+ * @return 1 if queued, 0 if skipped or dropped
+ */
+int telem_send_hrpwm(uint32_t timestampUs)
+{
+  telem_frame_t* frame = telem_begin(TELEM_TYPE_HRPWM, timestampUs);
+  uint32_t period;
+  uint32_t compareValue;
+  uint32_t prescalerMultiplier;
+  uint8_t timer;
+
+  if (frame == NULL)
+  {
+    return 0;
+  }
+  for (timer = HRPWM_TIMER_A; timer <= HRPWM_TIMER_F; timer++)
+  {
+    if (hrpwm_get_state((hrpwm_timer_t)timer, &period, &compareValue, &prescalerMultiplier))
+    {
+      telem_put_u8(frame, timer);
+      telem_put_u32(frame, period);
+      telem_put_u32(frame, compareValue);
+      telem_put_u8(frame, (uint8_t)prescalerMultiplier);
+    }
+  }
+  return telem_commit(frame);
+}
+
+/**
+ * @brief Send the stream statistics
+ * @param timestampUs - sample time
+ * @return 1 if queued, 0 if skipped or dropped
+ */
+int telem_send_stats(uint32_t timestampUs)
+{
+  telem_frame_t* frame = telem_begin(TELEM_TYPE_STATS, timestampUs);
+  uint32_t budgetDrops = 0;
+  uint32_t bufferDrops = 0;
+  uint8_t i;
+
+  if (frame == NULL)
+  {
+    return 0;
+  }
+  for (i = 0; i < TELEM_TYPE_COUNT; i++)
+  {
+    budgetDrops += telemStats.budgetDrops[i];
+    bufferDrops += telemStats.bufferDrops[i];
+  }
+  telem_put_u32(frame, telemStats.framesSent);
+  telem_put_u32(frame, telemStats.bytesSent);
+  telem_put_u32(frame, budgetDrops);
+  telem_put_u32(frame, bufferDrops);
+  telem_put_u32(frame, telemStats.bandwidth);
+  return telem_commit(frame);
+}
+
+/**
+ * @brief Copy the stream statistics
+ */
+void telem_get_stats(telem_stats_t* stats)
+{
+  uint8_t i;
+
+  *stats = telemStats;
+  for (i = 0; i < TELEM_TYPE_COUNT; i++)
+  {
+    stats->decimation[i] = telemChannels[i].activeDecimation;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef __MPS_TELEMETRY_H__
+#define __MPS_TELEMETRY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "n32h47x_48x.h"
+#include "n32h47x_48x_usart.h"
+#include "mps_telemetry_proto.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Frame buffers handed to the TX DMA, one frame each */
+#define TELEM_POOL_SIZE         4
+
+/* Largest automatic decimation applied to a channel that exceeds the budget */
+#define TELEM_MAX_DECIMATION    64
+
+/**
+ * @brief Channel priority, higher priorities may use more of the token bucket
+ */
+typedef enum {
+  TELEM_PRIO_LOW = 0,   /* Only sent while at least half the burst is available */
+  TELEM_PRIO_NORMAL,    /* Only sent while at least a quarter of the burst is available */
+  TELEM_PRIO_HIGH       /* Sent whenever the bucket covers the frame */
+} telem_priority_t;
+
+/**
+ * @brief Frame under construction, payload is written straight into the DMA buffer
+ */
+typedef struct {
+  uint8_t buffer[TELEM_MAX_FRAME];  /* Code byte, header, payload, CRC, delimiter */
+  uint16_t length;                  /* Bytes after the code byte written so far */
+  uint8_t type;                     /* Channel type */
+  bool overflow;                    /* A put did not fit, commit will fail */
+} telem_frame_t;
+
+/**
+ * @brief Stream statistics
+ */
+typedef struct {
+  uint32_t framesSent;
+  uint32_t bytesSent;                           /* Encoded bytes incl. delimiters */
+  uint32_t budgetDrops[TELEM_TYPE_COUNT];       /* Frames skipped by the bandwidth budget */
+  uint32_t bufferDrops[TELEM_TYPE_COUNT];       /* Frames skipped with no free DMA buffer */
+  uint16_t decimation[TELEM_TYPE_COUNT];        /* Current effective decimation */
+  uint32_t bandwidth;                           /* Budget in bytes/s */
+} telem_stats_t;
+
+int telem_init(USART_Module* USARTx, uint8_t budgetPercent);
+void telem_set_bandwidth(uint32_t bytesPerSecond);
+void telem_channel_config(telem_type_t type, telem_priority_t priority, uint16_t decimation);
+void telem_refill(uint32_t elapsedUs);
+
+telem_frame_t* telem_begin(telem_type_t type, uint32_t timestampUs);
+void telem_put_u8(telem_frame_t* frame, uint8_t value);
+void telem_put_u16(telem_frame_t* frame, uint16_t value);
+void telem_put_u32(telem_frame_t* frame, uint32_t value);
+int telem_commit(telem_frame_t* frame);
+void telem_abort(telem_frame_t* frame);
+
+int telem_send_adc(const uint16_t* samples, uint8_t count, uint32_t timestampUs);
+int telem_send_meas(const uint8_t* measReg, uint32_t timestampUs);
+int telem_send_hrpwm(uint32_t timestampUs);
+int telem_send_stats(uint32_t timestampUs);
+void telem_get_stats(telem_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_TELEMETRY_H__ */
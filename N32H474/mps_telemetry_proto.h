@@ -0,0 +1,104 @@
+#ifndef __MPS_TELEMETRY_PROTO_H__
+#define __MPS_TELEMETRY_PROTO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Telemetry wire format, shared by the firmware and the host tools
+ *
+ * Every frame is COBS encoded and terminated by a single 0x00 byte:
+ *
+ *   COBS( type | seq | timestamp[4] | payload[n] | crc16[2] ) 0x00
+ *
+ * - type:      channel type (telem_type_t)
+ * - seq:       stream sequence number, +1 for every frame put on the wire,
+ *              so a gap means frames were lost on the link
+ * - timestamp: device time of the sample in microseconds, little-endian
+ * - crc16:     Calculate_CRC16((seq << 8) | type, 4 + n, timestamp..payload),
+ *              little-endian
+ *
+ * All multi-byte fields are little-endian. The decoded frame is never longer
+ * than 253 bytes, so COBS never needs more than the one leading code byte and
+ * frames are encoded in place.
+ */
+
+#define TELEM_DELIMITER       0x00
+#define TELEM_HEADER_SIZE     6       /* type, seq, timestamp */
+#define TELEM_CRC_SIZE        2
+#define TELEM_MAX_PAYLOAD     240
+#define TELEM_MAX_DECODED     (TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD + TELEM_CRC_SIZE)
+#define TELEM_MAX_FRAME       (1 + TELEM_MAX_DECODED + 1)   /* code byte + delimiter */
+
+/**
+ * @brief Channel types
+ *
+ * Payload layouts:
+ * - TELEM_TYPE_ADC:   count u8, count x raw sample u16
+ * - TELEM_TYPE_MEAS:  nCells u8, nCells x cell mV u16, vpack u16,
+ *                     pack current s32, 4 x temperature s16, tchip s16,
+ *                     balancing mask u16
+ * - TELEM_TYPE_HRPWM: per running timer: timer u8, period u32, compare u32,
+ *                     prescaler multiplier u8
+ * - TELEM_TYPE_STATS: frames sent u32, bytes sent u32, budget drops u32,
+ *                     buffer drops u32, link bandwidth in bytes/s u32
+ * - TELEM_TYPE_LOG:   log records, each: format ID u16, argument count u8,
+ *                     reserved u8, DWT cycles u32, count x argument u32
+ */
+typedef enum {
+  TELEM_TYPE_ADC = 0,
+  TELEM_TYPE_MEAS,
+  TELEM_TYPE_HRPWM,
+  TELEM_TYPE_STATS,
+  TELEM_TYPE_LOG,
+  TELEM_TYPE_COUNT
+} telem_type_t;
+
+#define TELEM_HRPWM_ENTRY_SIZE  10
+#define TELEM_MEAS_TEMPS        4
+
+/**
+ * @brief Decode one COBS block (without its 0x00 delimiter)
+ * @param in - encoded bytes
+ * @param length - number of encoded bytes
+ * @param out - decoded bytes, at least length bytes
+ * @return decoded length, -1 if the block is malformed
+ */
+static inline int telem_cobs_decode(const uint8_t* in, uint32_t length, uint8_t* out)
+{
+  uint32_t i = 0;
+  uint32_t o = 0;
+
+  while (i < length)
+  {
+    uint8_t code = in[i++];
+    uint8_t k;
+
+    if (code == 0)
+    {
+      return -1;
+    }
+    for (k = 1; k < code; k++)
+    {
+      if (i >= length || in[i] == 0)
+      {
+        return -1;
+      }
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < length)
+    {
+      out[o++] = 0;
+    }
+  }
+  return (int)o;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_TELEMETRY_PROTO_H__ */
@@ -0,0 +1,131 @@
+#include "mps_time.h"
+#include "n32h47x_48x_rcc.h"
+
+static volatile uint32_t cycleHigh = 0;      /* Wraps of CYCCNT seen so far */
+static volatile uint32_t cycleLast = 0;      /* CYCCNT at the previous read */
+static uint32_t cyclesPerUs = 1;
+static uint32_t cyclesPerUsQ16 = 1u << 16;   /* Same, Q16.16 for fractional MHz clocks */
+static uint64_t usPerCycleQ64 = UINT64_MAX;  /* 1000000 / HCLK in Q0.64, rounded up */
+
+/**
+ * @brief Start the DWT cycle counter, safe to call more than once
+ *
+ * The counter is never reset, so time stays monotonic when several drivers
+ * initialize the timebase.
+ */
+void time_init(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  __set_PRIMASK(primask);
+  time_clock_update();
+}
+
+/**
+ * @brief Refresh the cached core clock, call after changing the system clock
+ *
+ * The cycle count itself is unaffected, only the cycle to microsecond
+ * conversion. Intervals measured across a clock change are not corrected.
+ */
+void time_clock_update(void)
+{
+  RCC_ClocksType clocks;
+  uint32_t perUs;
+  uint32_t perUsQ16;
+  uint64_t perCycle = UINT64_MAX;
+
+  RCC_GetClocksFreqValue(&clocks);
+  perUs = clocks.HclkFreq / 1000000;
+  perUsQ16 = (uint32_t)(((uint64_t)clocks.HclkFreq << 16) / 1000000);
+  if (perUs == 0)
+  {
+    perUs = 1;
+    perUsQ16 = 1u << 16;
+  }
+  if (clocks.HclkFreq > 1000000)
+  {
+    /* 2^64 * 1000000 / HCLK as two 32-bit long division steps, the low word
+       rounded up so that time_cycles_to_us truncates like an exact division */
+    uint64_t dividend = 1000000ULL << 32;
+    uint64_t high = dividend / clocks.HclkFreq;
+    uint64_t rest = dividend % clocks.HclkFreq;
+    uint64_t low = ((rest << 32) + clocks.HclkFreq - 1) / clocks.HclkFreq;
+
+    perCycle = (high << 32) + low;
+  }
+  cyclesPerUs = perUs;
+  cyclesPerUsQ16 = perUsQ16;
+  usPerCycleQ64 = perCycle;
+}
+
+/**
+ * @brief Cycles since the counter was started, 64-bit
+ */
+uint64_t time_now_cycles(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t low;
+  uint32_t high;
+
+  __disable_irq();
+  low = DWT->CYCCNT;
+  if (low < cycleLast)
+  {
+    cycleHigh++;
+  }
+  cycleLast = low;
+  high = cycleHigh;
+  __set_PRIMASK(primask);
+
+  return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Convert cycles to microseconds (rounded down)
+ *
+ * Multiplies by the cached reciprocal of the core clock and keeps the high
+ * 64 bits of the 128-bit product, four 32x32 multiplies instead of a 64-bit
+ * library division. Matches the exact division for fractional MHz clocks
+ * too; only after years of uptime can the result be 1 us high.
+ */
+uint64_t time_cycles_to_us(uint64_t cycles)
+{
+  uint64_t factor = usPerCycleQ64;
+  uint64_t lowLow = (uint64_t)(uint32_t)cycles * (uint32_t)factor;
+  uint64_t lowHigh = (uint64_t)(uint32_t)cycles * (uint32_t)(factor >> 32);
+  uint64_t highLow = (uint64_t)(uint32_t)(cycles >> 32) * (uint32_t)factor;
+  uint64_t highHigh = (uint64_t)(uint32_t)(cycles >> 32) * (uint32_t)(factor >> 32);
+  uint64_t middle = (lowLow >> 32) + (uint32_t)lowHigh + (uint32_t)highLow;
+
+  return highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+}
+
+/**
+ * @brief Microseconds since the counter was started
+ */
+uint64_t time_now_us(void)
+{
+  return time_cycles_to_us(time_now_cycles());
+}
+
+/**
+ * @brief Core cycles per microsecond
+ */
+uint32_t time_cycles_per_us(void)
+{
+  return cyclesPerUs;
+}
+
+/**
+ * @brief Core cycles per microsecond in Q16.16, exact for fractional MHz clocks
+ */
+uint32_t time_cycles_per_us_q16(void)
+{
+  return cyclesPerUsQ16;
+}
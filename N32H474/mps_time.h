@@ -0,0 +1,94 @@
+#ifndef __MPS_TIME_H__
+#define __MPS_TIME_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+#include "n32h47x_48x.h"
+#endif
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Monotonic timebase
+ *
+ * The DWT cycle counter is extended to 64 bits by counting its wraps, which
+ * never overflows in practice. Every read goes through one short critical
+ * section, so the functions are safe from interrupts and thread code alike.
+ * A wrap is only seen if the time is read at least once per 2^32 cycles
+ * (17.9 s at 240 MHz); sched_init keeps a timer for that.
+ *
+ * Deadlines are absolute cycle counts (time_deadline_t), so checking one in
+ * a polling loop costs no division. Conversions use the exact core clock
+ * (fractional MHz included) and multiply instead of divide in both directions.
+ */
+
+typedef uint64_t time_deadline_t;
+
+void time_init(void);
+uint64_t time_now_cycles(void);
+uint64_t time_now_us(void);
+void time_clock_update(void);
+uint32_t time_cycles_per_us(void);
+uint32_t time_cycles_per_us_q16(void);
+uint64_t time_cycles_to_us(uint64_t cycles);
+
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
+/**
+ * @brief Raw 32-bit cycle count, for short intervals and profiling
+ */
+static inline uint32_t time_cycles32(void)
+{
+  return DWT->CYCCNT;
+}
+#else
+/* Host builds (Tools/) supply a simulated counter */
+uint32_t time_cycles32(void);
+#endif
+
+/**
+ * @brief Convert microseconds to cycles
+ *
+ * The whole and fractional 2^16 us parts are scaled separately, so the
+ * result equals (us * rate) >> 16 without the product leaving 64 bits.
+ */
+static inline uint64_t time_us_to_cycles(uint64_t us)
+{
+  uint32_t rate = time_cycles_per_us_q16();
+
+  return (us >> 16) * rate + (((us & 0xFFFFu) * rate) >> 16);
+}
+
+/**
+ * @brief Deadline a number of microseconds from now
+ */
+static inline time_deadline_t time_deadline_us(uint32_t us)
+{
+  return time_now_cycles() + time_us_to_cycles(us);
+}
+
+/**
+ * @brief Check whether a deadline has passed
+ */
+static inline bool time_expired(time_deadline_t deadline)
+{
+  return time_now_cycles() >= deadline;
+}
+
+/**
+ * @brief Microseconds left until a deadline, 0 once it has passed
+ */
+static inline uint32_t time_remaining_us(time_deadline_t deadline)
+{
+  uint64_t now = time_now_cycles();
+
+  return (now >= deadline) ? 0 : (uint32_t)time_cycles_to_us(deadline - now);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPS_TIME_H__ */
@@ -1,15 +1,49 @@
 #include "mps_timer.h"
 #include "n32h47x_48x_tim.h"
 #include "n32h47x_48x_rcc.h"
+#include "n32h47x_48x_dma.h"
 #include "misc.h"
+#include "mps_sched.h"
 #include <stddef.h>
 
-/* External system clock variable */
-extern uint32_t SystemCoreClock;
-
 /* Static array to store callBack functions for GTIM1-7 */
 static timer_callback_t timer_callbacks[7] = {NULL};
 
+/* GTIM driving the software timer wheel */
+static TIM_Module* wheelTimer = NULL;
+static volatile uint32_t wheelReload = 0;   /* Ticks per update in tickless mode, minus one */
+
+/* Input capture channel state */
+typedef struct {
+  timer_capture_callback_t callBack;   /* Interrupt mode */
+  void* ctx;
+  uint16_t decimation;                 /* Software part of the decimation */
+  uint16_t countdown;
+  bool haveLast;
+  uint32_t last;                       /* Last reported (or unwrapped) timestamp */
+  uint16_t lastRaw;                    /* DMA mode: last raw counter value */
+  DMA_ChannelType* dmaChannel;         /* DMA mode */
+  uint16_t* buffer;
+  uint16_t count;
+  uint16_t readPos;
+} timer_capture_channel_t;
+
+/* Input capture timer state */
+typedef struct {
+  bool active;
+  bool pwmMode;
+  volatile bool pwmOverflowed;         /* PWM input: no edge for a full counter period */
+  volatile uint32_t overflows;         /* Upper 16 bits of the extended counter */
+  uint32_t tickHz;
+  timer_capture_channel_t ch[4];
+} timer_capture_t;
+
+static timer_capture_t timer_captures[7];
+
+static const uint16_t timerChannels[4] = {TIM_CH_1, TIM_CH_2, TIM_CH_3, TIM_CH_4};
+static const uint16_t timerCcInts[4] = {TIM_INT_CC1, TIM_INT_CC2, TIM_INT_CC3, TIM_INT_CC4};
+static const uint16_t timerCcDmas[4] = {TIM_DMA_CC1, TIM_DMA_CC2, TIM_DMA_CC3, TIM_DMA_CC4};
+
 
 /**
  * @brief Get timer IRQ channel
@@ -29,18 +63,28 @@ static IRQn_Type get_timer_irq(TIM_Module* TIMx)
 }
 
 /**
- * @brief Initialize timer - super simple version
- * @param TIMx: Timer peripheral (GTIM1-GTIM7) 
- * @param periodUs: Timer period in microseconds (10-42949017, any value)
- * @param callBack: Your function to call every periodUs (like LED_ON)
+ * @brief Get timer index (0 for GTIM1 ... 6 for GTIM7)
+ * @param TIMx: Timer peripheral
+ * @return index or -1 if invalid
  */
-void timer_init(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack)
+static int get_timer_index(TIM_Module* TIMx)
+{
+  if (TIMx == GTIM1) return 0;
+  else if (TIMx == GTIM2) return 1;
+  else if (TIMx == GTIM3) return 2;
+  else if (TIMx == GTIM4) return 3;
+  else if (TIMx == GTIM5) return 4;
+  else if (TIMx == GTIM6) return 5;
+  else if (TIMx == GTIM7) return 6;
+  else return -1;
+}
+
+/**
+ * @brief Enable the APB1 clock of a GTIM
+ * @param TIMx: Timer peripheral
+ */
+static void timer_enable_clock(TIM_Module* TIMx)
 {
-  TIM_TimeBaseInitType timer_config;
-  
-  /* Configure RCC for the timer */
-  RCC_ConfigPclk1(RCC_HCLK_DIV4);
-  
   if (TIMx == GTIM1) {
     RCC_EnableAPB1PeriphClk(RCC_APB1_PERIPH_GTIM1, ENABLE);
   } else if (TIMx == GTIM2) {
@@ -56,39 +100,134 @@ void timer_init(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack)
   } else if (TIMx == GTIM7) {
     RCC_EnableAPB1PeriphClk(RCC_APB1_PERIPH_GTIM7, ENABLE);
   }
-  
-  uint32_t timerClock = SystemCoreClock / 2;  // Timer clock = HCLK/2 (auto ×2 rule)
-  uint64_t totalCycles = ((uint64_t)periodUs * timerClock) / 1000000;
-  uint32_t prescaler = (uint32_t)((totalCycles + 65535) / 65536);
-  uint32_t period = (uint32_t)(totalCycles / prescaler) - 1;
-  
-  timer_config.Prescaler = prescaler - 1;  // Register value (prescaler - 1)
-  timer_config.Period = period;
+}
+
+/**
+ * @brief Get the counter clock of the GTIMs (APB1)
+ *
+ * The timer clock is PCLK1 when APB1 is not divided, and twice PCLK1 when it
+ * is, so it is read from the actual bus setup instead of being assumed.
+ *
+ * @return clock in Hz
+ */
+uint32_t timer_get_clock(void)
+{
+  RCC_ClocksType RCC_Clocks;
+
+  RCC_GetClocksFreqValue(&RCC_Clocks);
+  if (RCC_Clocks.Pclk1Freq == RCC_Clocks.HclkFreq)
+  {
+    return RCC_Clocks.Pclk1Freq;
+  }
+  return RCC_Clocks.Pclk1Freq * 2;
+}
+
+/**
+ * @brief Shared periodic / one-shot setup
+ */
+static int timer_setup(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack, bool oneShot)
+{
+  TIM_TimeBaseInitType timer_config;
+  NVIC_InitType NVIC_InitStructure;
+  timer_period_t solved;
+  int index = get_timer_index(TIMx);
+
+  if (index < 0 || !timer_solve_period(timer_get_clock(), periodUs, &solved))
+  {
+    return 0;
+  }
+
+  timer_enable_clock(TIMx);
+  timer_captures[index].active = false;  // Back to a periodic timer
+  TIM_Enable(TIMx, DISABLE);
+
+  timer_config.Prescaler = solved.prescaler - 1;  // Register value (prescaler - 1)
+  timer_config.Period = solved.reload - 1;
   timer_config.CounterMode = TIM_CNT_MODE_UP;      // Up counting mode
   timer_config.ClkDiv = TIM_CLK_DIV1;              // No clock division
   timer_config.RepetCnt = 0;                       // Repetition counter (only for ATIM)
-  
 
-  IRQn_Type irq = get_timer_irq(TIMx);
-  NVIC_InitType NVIC_InitStructure;
-  
   /* Enable timer update interrupt */
   TIM_ConfigInt(TIMx, TIM_INT_UPDATE, ENABLE);
-  
+
   /* Configure NVIC */
-  NVIC_InitStructure.NVIC_IRQChannel = irq;
+  NVIC_InitStructure.NVIC_IRQChannel = get_timer_irq(TIMx);
   NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
   NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
   NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
   NVIC_Init(&NVIC_InitStructure);
-  
+
   /* Apply timer configuration */
   TIM_InitTimeBase(TIMx, &timer_config);
-  
+
   /* Configure prescaler with immediate reload */
   TIM_ConfigPrescaler(TIMx, timer_config.Prescaler, TIM_PSC_RELOAD_MODE_IMMEDIATE);
+
+  /* Buffered reload so timer_set_period takes effect at the update event */
+  TIM_ConfigArPreload(TIMx, ENABLE);
+  TIM_SelectOnePulseMode(TIMx, oneShot ? TIM_OPMODE_SINGLE : TIM_OPMODE_REPET);
+  TIM_ClrIntPendingBit(TIMx, TIM_INT_UPDATE);
+
   /* Set callBack function */
   timer_set_callback(TIMx, callBack);
+  return 1;
+}
+
+/**
+ * @brief Initialize timer - super simple version
+ * @param TIMx: Timer peripheral (GTIM1-GTIM7) 
+ * @param periodUs: Timer period in microseconds, see timer_solve_period for the range
+ * @param callBack: Your function to call every periodUs (like LED_ON)
+ * @note The APB1 clock is left as configured by the system clock setup
+ */
+void timer_init(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack)
+{
+  (void)timer_setup(TIMx, periodUs, callBack, false);
+}
+
+/**
+ * @brief Initialize a one-shot timer
+ *
+ * Each timer_start runs one period, calls callBack once from the update
+ * interrupt and stops the counter in hardware.
+ *
+ * @param TIMx: Timer peripheral (GTIM1-GTIM7)
+ * @param periodUs: Delay in microseconds
+ * @param callBack: Function called when the delay has elapsed
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_init_oneshot(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack)
+{
+  return timer_setup(TIMx, periodUs, callBack, true);
+}
+
+/**
+ * @brief Retune the period of a running timer without a glitch
+ *
+ * Prescaler and reload are both buffered and move to the active registers
+ * together at the next update event, so the period in progress finishes
+ * unchanged and the counter never stops. Update events are held off while
+ * the two are written, so one cannot latch the new prescaler with the old
+ * reload; a counter wrap inside that window of a few cycles raises no update
+ * and the new period starts one period later.
+ *
+ * @param TIMx: Timer peripheral set up with timer_init or timer_init_oneshot
+ * @param periodUs: New period in microseconds
+ * @return 1 on success, 0 if the period is out of range
+ */
+int timer_set_period(TIM_Module* TIMx, uint32_t periodUs)
+{
+  timer_period_t solved;
+
+  if (get_timer_index(TIMx) < 0 || !timer_solve_period(timer_get_clock(), periodUs, &solved))
+  {
+    return 0;
+  }
+  TIM_EnableUpdateEvt(TIMx, DISABLE);
+  TIM_ConfigPrescaler(TIMx, (uint16_t)(solved.prescaler - 1), TIM_PSC_RELOAD_MODE_UPDATE);
+  TIM_SetAutoReload(TIMx, (uint16_t)(solved.reload - 1));
+  TIM_EnableUpdateEvt(TIMx, ENABLE);
+  return 1;
 }
 
 
@@ -127,6 +266,637 @@ void timer_set_callback(TIM_Module* TIMx, timer_callback_t callBack)
   else if (TIMx == GTIM7) timer_callbacks[6] = callBack;
 }
 
+/**
+ * @brief Wheel tick at a fixed rate, one tick per update
+ */
+static void timer_wheel_tick(void)
+{
+  swtimer_advance(1);
+}
+
+/**
+ * @brief Tickless wake-up: the programmed interval has elapsed
+ */
+static void timer_wheel_wakeup(void)
+{
+  swtimer_advance(wheelReload + 1);
+}
+
+/**
+ * @brief Ticks counted since the last tickless wake-up
+ */
+static uint32_t timer_wheel_pending(void)
+{
+  uint32_t count = TIM_GetCnt(wheelTimer);
+
+  if (TIM_GetFlagStatus(wheelTimer, TIM_FLAG_UPDATE) != RESET)
+  {
+    /* Wrapped but the interrupt has not run yet (called with interrupts masked) */
+    count = TIM_GetCnt(wheelTimer) + wheelReload + 1;
+  }
+  return count;
+}
+
+/**
+ * @brief Program the next tickless wake-up
+ * @param ticks: Ticks from the last wake-up, capped to the 16-bit counter
+ */
+static void timer_wheel_schedule(uint32_t ticks)
+{
+  uint32_t count;
+
+  if (TIM_GetFlagStatus(wheelTimer, TIM_FLAG_UPDATE) != RESET)
+  {
+    /* The pending interrupt advances the wheel and reprograms */
+    return;
+  }
+  if (ticks == 0)
+  {
+    ticks = 1;
+  }
+  else if (ticks > 0x10000)
+  {
+    ticks = 0x10000;
+  }
+  count = TIM_GetCnt(wheelTimer);
+  if (ticks - 1 <= count)
+  {
+    if (count >= 0xFFFE)
+    {
+      /* Wraps on the next count anyway */
+      return;
+    }
+    /* Already due: wrap on the next count */
+    ticks = count + 2;
+  }
+  wheelReload = ticks - 1;
+  TIM_SetAutoReload(wheelTimer, (uint16_t)wheelReload);
+}
+
+/**
+ * @brief Drive the software timer wheel (mps_swtimer.h) from one GTIM
+ *
+ * In tickless mode the counter runs at the tick rate and the auto-reload is
+ * rewritten after every wake-up so the interrupt only fires at the next
+ * expiry, at most every 65536 ticks. The reload is never written at or below
+ * the running count, so an expiry right after a wake-up can be delivered up to
+ * two ticks late; the wheel time itself stays exact.
+ *
+ * @param TIMx: Timer peripheral (GTIM1-GTIM7), dedicated to the wheel
+ * @param tickUs: Wheel tick in microseconds (tickless: the prescaler must fit 16 bits)
+ * @param tickless: false = interrupt every tick, true = interrupt only at expiries
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_wheel_init(TIM_Module* TIMx, uint32_t tickUs, bool tickless)
+{
+  static const swtimer_hw_t wheelHw = { timer_wheel_pending, timer_wheel_schedule };
+  TIM_TimeBaseInitType timer_config;
+  uint64_t prescaler;
+
+  if (get_timer_irq(TIMx) == (IRQn_Type)-1 || tickUs == 0)
+  {
+    return 0;
+  }
+  if (!tickless)
+  {
+    swtimer_wheel_init(NULL);
+    wheelTimer = TIMx;
+    timer_init(TIMx, tickUs, timer_wheel_tick);
+    return 1;
+  }
+
+  prescaler = ((uint64_t)tickUs * timer_get_clock()) / 1000000;
+  if (prescaler == 0 || prescaler > 65536)
+  {
+    return 0;
+  }
+
+  /* Same clock and interrupt setup as a periodic timer, then counter in ticks */
+  timer_init(TIMx, tickUs, timer_wheel_wakeup);
+  TIM_Enable(TIMx, DISABLE);
+  timer_config.Prescaler = (uint16_t)(prescaler - 1);
+  timer_config.Period = 0xFFFF;
+  timer_config.CounterMode = TIM_CNT_MODE_UP;
+  timer_config.ClkDiv = TIM_CLK_DIV1;
+  timer_config.RepetCnt = 0;
+  TIM_InitTimeBase(TIMx, &timer_config);
+  TIM_ConfigPrescaler(TIMx, timer_config.Prescaler, TIM_PSC_RELOAD_MODE_IMMEDIATE);
+  TIM_ConfigArPreload(TIMx, DISABLE);   /* Reload rewrites must act immediately */
+  TIM_SetCnt(TIMx, 0);
+  TIM_ClrIntPendingBit(TIMx, TIM_INT_UPDATE);
+
+  wheelTimer = TIMx;
+  wheelReload = 0xFFFF;
+  swtimer_wheel_init(&wheelHw);
+  timer_wheel_schedule(swtimer_next());
+  return 1;
+}
+
+/**
+ * @brief Read the capture register of a channel
+ */
+static uint16_t timer_read_ccr(TIM_Module* TIMx, uint8_t channel)
+{
+  switch (channel)
+  {
+    case 1: return (uint16_t)TIM_GetCap1(TIMx);
+    case 2: return (uint16_t)TIM_GetCap2(TIMx);
+    case 3: return (uint16_t)TIM_GetCap3(TIMx);
+    default: return (uint16_t)TIM_GetCap4(TIMx);
+  }
+}
+
+/**
+ * @brief Address of the capture register of a channel, DMA source
+ */
+static volatile uint32_t* timer_ccr_address(TIM_Module* TIMx, uint8_t channel)
+{
+  switch (channel)
+  {
+    case 1: return &TIMx->CCDAT1;
+    case 2: return &TIMx->CCDAT2;
+    case 3: return &TIMx->CCDAT3;
+    default: return &TIMx->CCDAT4;
+  }
+}
+
+/**
+ * @brief AHB clock enable bit of the DMA controller that owns a channel
+ * @return RCC_AHB_PERIPHEN_DMA1/DMA2, or 0 if the channel belongs to neither
+ */
+static uint32_t timer_dma_clock(const DMA_ChannelType* dmaChannel)
+{
+  /* Channel register blocks are contiguous within each controller */
+  if (dmaChannel >= DMA1_CH1 && dmaChannel <= DMA1_CH8)
+  {
+    return RCC_AHB_PERIPHEN_DMA1;
+  }
+  if (dmaChannel >= DMA2_CH1 && dmaChannel <= DMA2_CH8)
+  {
+    return RCC_AHB_PERIPHEN_DMA2;
+  }
+  return 0;
+}
+
+/**
+ * @brief Program a free-running 16-bit counter at a tick rate for capture
+ * @return 1 on success, 0 if the prescaler is out of range
+ */
+static int timer_capture_base(TIM_Module* TIMx, uint32_t tickHz, timer_capture_t* cap)
+{
+  TIM_TimeBaseInitType timer_config;
+  NVIC_InitType NVIC_InitStructure;
+  uint32_t timerClock = timer_get_clock();
+  uint32_t prescaler;
+
+  if (tickHz == 0 || tickHz > timerClock)
+  {
+    return 0;
+  }
+  prescaler = (timerClock + tickHz / 2) / tickHz;
+  if (prescaler == 0 || prescaler > 65536)
+  {
+    return 0;
+  }
+
+  timer_enable_clock(TIMx);
+  TIM_Enable(TIMx, DISABLE);
+
+  timer_config.Prescaler = prescaler - 1;
+  timer_config.Period = 0xFFFF;
+  timer_config.CounterMode = TIM_CNT_MODE_UP;
+  timer_config.ClkDiv = TIM_CLK_DIV1;
+  timer_config.RepetCnt = 0;
+  TIM_InitTimeBase(TIMx, &timer_config);
+  TIM_ConfigPrescaler(TIMx, timer_config.Prescaler, TIM_PSC_RELOAD_MODE_IMMEDIATE);
+  TIM_ConfigArPreload(TIMx, DISABLE);
+  TIM_SelectOnePulseMode(TIMx, TIM_OPMODE_REPET);
+  TIM_ClrIntPendingBit(TIMx, TIM_INT_UPDATE);
+
+  cap->active = true;
+  cap->pwmMode = false;
+  cap->overflows = 0;
+  cap->pwmOverflowed = true;
+  cap->tickHz = timerClock / prescaler;
+
+  /* Update interrupt counts overflows for the upper 16 bits */
+  TIM_ConfigInt(TIMx, TIM_INT_UPDATE, ENABLE);
+  NVIC_InitStructure.NVIC_IRQChannel = get_timer_irq(TIMx);
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+  return 1;
+}
+
+/**
+ * @brief Configure a GTIM as a free-running 32-bit capture timebase
+ *
+ * The 16-bit counter is extended to 32 bits by counting overflows in the
+ * update interrupt. The timer is dedicated to capture afterwards; input pins
+ * must be configured by the caller.
+ *
+ * @param TIMx: Timer peripheral (GTIM1-GTIM7)
+ * @param tickHz: Counter rate, rounded to a prescaler of the timer clock
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_capture_init(TIM_Module* TIMx, uint32_t tickHz)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_t* cap;
+  uint8_t i;
+
+  if (index < 0)
+  {
+    return 0;
+  }
+  cap = &timer_captures[index];
+  for (i = 0; i < 4; i++)
+  {
+    cap->ch[i].callBack = NULL;
+    cap->ch[i].dmaChannel = NULL;
+  }
+  if (!timer_capture_base(TIMx, tickHz, cap))
+  {
+    cap->active = false;
+    return 0;
+  }
+  TIM_Enable(TIMx, ENABLE);
+  return 1;
+}
+
+/**
+ * @brief Configure an input channel, shared by the interrupt and DMA paths
+ * @return hardware prescaler applied, 0 on invalid channel
+ */
+static uint16_t timer_capture_config_channel(TIM_Module* TIMx, uint8_t channel, timer_edge_t edge, uint16_t decimation)
+{
+  TIM_ICInitType ic;
+  uint16_t hwDiv;
+
+  if (channel < 1 || channel > 4)
+  {
+    return 0;
+  }
+
+  /* Largest input prescaler that divides the decimation, the rest in software */
+  if ((decimation % 8) == 0)      { hwDiv = 8; ic.IcPrescaler = TIM_IC_PSC_DIV8; }
+  else if ((decimation % 4) == 0) { hwDiv = 4; ic.IcPrescaler = TIM_IC_PSC_DIV4; }
+  else if ((decimation % 2) == 0) { hwDiv = 2; ic.IcPrescaler = TIM_IC_PSC_DIV2; }
+  else                            { hwDiv = 1; ic.IcPrescaler = TIM_IC_PSC_DIV1; }
+
+  ic.Channel = timerChannels[channel - 1];
+  ic.IcPolarity = (edge == TIMER_EDGE_FALLING) ? TIM_IC_POLARITY_FALLING :
+                  (edge == TIMER_EDGE_BOTH) ? TIM_IC_POLARITY_BOTHEDGE : TIM_IC_POLARITY_RISING;
+  ic.IcSelection = TIM_IC_SELECTION_DIRECTTI;
+  ic.IcFilter = 0x3;   /* Reject glitches shorter than 8 timer clocks */
+  TIM_ICInit(TIMx, &ic);
+  return hwDiv;
+}
+
+/**
+ * @brief Capture edges on a channel with an interrupt callBack
+ *
+ * Only every decimation-th edge is reported: factors of 2, 4 and 8 use the
+ * channel input prescaler so the skipped edges cost no interrupt at all, the
+ * remaining factor is counted down in the interrupt.
+ *
+ * @param TIMx: Timer peripheral set up with timer_capture_init
+ * @param channel: Input channel 1-4
+ * @param edge: Active edge
+ * @param decimation: Report every n-th edge (0 or 1 = every edge)
+ * @param callBack: Called from the interrupt with the 32-bit timestamp and the ticks since the previous report
+ * @param ctx: Passed to callBack
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_capture_channel(TIM_Module* TIMx, uint8_t channel, timer_edge_t edge, uint16_t decimation,
+                          timer_capture_callback_t callBack, void* ctx)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_channel_t* ch;
+  uint16_t hwDiv;
+
+  if (index < 0 || !timer_captures[index].active || timer_captures[index].pwmMode || callBack == NULL)
+  {
+    return 0;
+  }
+  if (decimation == 0)
+  {
+    decimation = 1;
+  }
+  hwDiv = timer_capture_config_channel(TIMx, channel, edge, decimation);
+  if (hwDiv == 0)
+  {
+    return 0;
+  }
+
+  ch = &timer_captures[index].ch[channel - 1];
+  TIM_ConfigInt(TIMx, timerCcInts[channel - 1], DISABLE);
+  ch->callBack = callBack;
+  ch->ctx = ctx;
+  ch->decimation = decimation / hwDiv;
+  ch->countdown = ch->decimation;
+  ch->haveLast = false;
+  TIM_ClrIntPendingBit(TIMx, timerCcInts[channel - 1]);
+  TIM_ConfigInt(TIMx, timerCcInts[channel - 1], ENABLE);
+  return 1;
+}
+
+/**
+ * @brief Capture edges on a channel into a circular DMA buffer of raw counter values
+ *
+ * No interrupt per edge. timer_capture_dma_read unwraps the 16-bit values to
+ * 32-bit timestamps, which requires consecutive edges less than 65536 ticks
+ * apart and a reader that keeps up with the buffer.
+ *
+ * @param TIMx: Timer peripheral set up with timer_capture_init
+ * @param channel: Input channel 1-4
+ * @param edge: Active edge
+ * @param dmaChannel: DMA1 or DMA2 channel, remapped to the CCx request; the
+ *                    clock of its controller is enabled here
+ * @param dmaRemap: DMA_REMAP_ value of the GTIM CCx request
+ * @param buffer: Raw capture buffer
+ * @param count: Buffer length in samples
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_capture_dma_start(TIM_Module* TIMx, uint8_t channel, timer_edge_t edge,
+                            DMA_ChannelType* dmaChannel, uint32_t dmaRemap,
+                            uint16_t* buffer, uint16_t count)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_channel_t* ch;
+  DMA_InitType DMA_InitStructure;
+  uint32_t dmaClock = timer_dma_clock(dmaChannel);
+
+  if (index < 0 || !timer_captures[index].active || timer_captures[index].pwmMode ||
+      dmaClock == 0 || buffer == NULL || count == 0 ||
+      timer_capture_config_channel(TIMx, channel, edge, 1) == 0)
+  {
+    return 0;
+  }
+  ch = &timer_captures[index].ch[channel - 1];
+
+  RCC_EnableAHBPeriphClk(dmaClock, ENABLE);
+  DMA_DeInit(dmaChannel);
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.PeriphAddr     = (uint32_t)timer_ccr_address(TIMx, channel);
+  DMA_InitStructure.MemAddr        = (uint32_t)buffer;
+  DMA_InitStructure.Direction      = DMA_DIR_PERIPH_SRC;
+  DMA_InitStructure.BufSize        = count;
+  DMA_InitStructure.PeriphInc      = DMA_PERIPH_INC_DISABLE;
+  DMA_InitStructure.MemoryInc      = DMA_MEM_INC_ENABLE;
+  DMA_InitStructure.PeriphDataSize = DMA_PERIPH_DATA_WIDTH_HALFWORD;
+  DMA_InitStructure.MemDataSize    = DMA_MEM_DATA_WIDTH_HALFWORD;
+  DMA_InitStructure.CircularMode   = DMA_MODE_CIRCULAR;
+  DMA_InitStructure.Priority       = DMA_PRIORITY_HIGH;
+  DMA_InitStructure.Mem2Mem        = DMA_M2M_DISABLE;
+  DMA_Init(dmaChannel, &DMA_InitStructure);
+  DMA_RequestRemap(dmaRemap, dmaChannel, ENABLE);
+
+  ch->callBack = NULL;
+  ch->dmaChannel = dmaChannel;
+  ch->buffer = buffer;
+  ch->count = count;
+  ch->readPos = 0;
+  /* Seed the unwrapping with the current extended counter */
+  ch->last = timer_capture_now(TIMx);
+  ch->lastRaw = (uint16_t)ch->last;
+
+  DMA_EnableChannel(dmaChannel, ENABLE);
+  TIM_EnableDma(TIMx, timerCcDmas[channel - 1], ENABLE);
+  return 1;
+}
+
+/**
+ * @brief Read new DMA captured edges as 32-bit timestamps
+ * @param TIMx: Timer peripheral
+ * @param channel: Input channel 1-4 started with timer_capture_dma_start
+ * @param timestamps: Output
+ * @param max: Capacity of timestamps
+ * @return number of timestamps written
+ */
+uint16_t timer_capture_dma_read(TIM_Module* TIMx, uint8_t channel, uint32_t* timestamps, uint16_t max)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_channel_t* ch;
+  uint16_t writePos;
+  uint16_t n = 0;
+
+  if (index < 0 || channel < 1 || channel > 4 || timestamps == NULL)
+  {
+    return 0;
+  }
+  ch = &timer_captures[index].ch[channel - 1];
+  if (ch->dmaChannel == NULL)
+  {
+    return 0;
+  }
+
+  writePos = ch->count - (uint16_t)DMA_GetCurrDataCounter(ch->dmaChannel);
+  if (writePos >= ch->count)
+  {
+    writePos = 0;
+  }
+  while (ch->readPos != writePos && n < max)
+  {
+    uint16_t raw = ch->buffer[ch->readPos];
+
+    ch->last += (uint16_t)(raw - ch->lastRaw);
+    ch->lastRaw = raw;
+    timestamps[n++] = ch->last;
+    if (++ch->readPos >= ch->count)
+    {
+      ch->readPos = 0;
+    }
+  }
+  return n;
+}
+
+/**
+ * @brief Current 32-bit extended counter value
+ * @param TIMx: Timer peripheral set up with timer_capture_init
+ */
+uint32_t timer_capture_now(TIM_Module* TIMx)
+{
+  int index = get_timer_index(TIMx);
+  uint32_t primask;
+  uint32_t high;
+  uint16_t count;
+
+  if (index < 0)
+  {
+    return 0;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  high = timer_captures[index].overflows;
+  count = TIM_GetCnt(TIMx);
+  if (TIM_GetFlagStatus(TIMx, TIM_FLAG_UPDATE) != RESET && count < 0x8000)
+  {
+    /* Wrapped, the interrupt has not counted it yet */
+    high++;
+  }
+  __set_PRIMASK(primask);
+  return (high << 16) | count;
+}
+
+/**
+ * @brief Counter rate of a capture timer after prescaler rounding
+ */
+uint32_t timer_capture_tick_hz(TIM_Module* TIMx)
+{
+  int index = get_timer_index(TIMx);
+
+  return (index < 0 || !timer_captures[index].active) ? 0 : timer_captures[index].tickHz;
+}
+
+/**
+ * @brief Measure period and duty of a PWM signal on channel 1
+ *
+ * Channel 1 captures the rising edge and resets the counter (slave reset
+ * mode), channel 2 captures the falling edge of the same input. The results
+ * stay in the capture registers, so reading costs no interrupt per period.
+ * The slowest measurable period is 65536 ticks.
+ *
+ * @param TIMx: Timer peripheral (GTIM1-GTIM7)
+ * @param tickHz: Counter rate
+ * @return 1 on success, 0 on invalid parameters
+ */
+int timer_pwm_input_init(TIM_Module* TIMx, uint32_t tickHz)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_t* cap;
+  TIM_ICInitType ic;
+
+  if (index < 0)
+  {
+    return 0;
+  }
+  cap = &timer_captures[index];
+  if (!timer_capture_base(TIMx, tickHz, cap))
+  {
+    cap->active = false;
+    return 0;
+  }
+  cap->pwmMode = true;
+
+  ic.Channel = TIM_CH_1;
+  ic.IcPolarity = TIM_IC_POLARITY_RISING;
+  ic.IcSelection = TIM_IC_SELECTION_DIRECTTI;
+  ic.IcPrescaler = TIM_IC_PSC_DIV1;
+  ic.IcFilter = 0x3;
+  TIM_ConfigPwmIc(TIMx, &ic);   /* Also sets channel 2 to the falling edge of TI1 */
+
+  TIM_SelectInputTrig(TIMx, TIM_TRIG_SEL_TI1FP1);
+  TIM_SelectSlaveMode(TIMx, TIM_SLAVE_MODE_RESET);
+  TIM_EnableMasterSlaveMode(TIMx, TIM_MASTER_SLAVE_MODE_ENABLE);
+  /* Only a real overflow (signal lost) raises the update interrupt, not the reset */
+  TIM_ConfigUpdateRequestIntSrc(TIMx, TIM_UPDATE_SRC_REGULAR);
+
+  TIM_Enable(TIMx, ENABLE);
+  return 1;
+}
+
+/**
+ * @brief Read the last measured PWM period and high time
+ * @param TIMx: Timer peripheral set up with timer_pwm_input_init
+ * @param periodTicks: Period in ticks
+ * @param pulseTicks: High time in ticks
+ * @return true if a full period was measured since the signal was last lost
+ */
+bool timer_pwm_input_read(TIM_Module* TIMx, uint32_t* periodTicks, uint32_t* pulseTicks)
+{
+  int index = get_timer_index(TIMx);
+  timer_capture_t* cap;
+
+  if (index < 0 || !timer_captures[index].pwmMode || periodTicks == NULL || pulseTicks == NULL)
+  {
+    return false;
+  }
+  cap = &timer_captures[index];
+
+  if (TIM_GetFlagStatus(TIMx, TIM_FLAG_CC1) != RESET)
+  {
+    /* New period edge: the signal is back */
+    TIM_ClearFlag(TIMx, TIM_FLAG_CC1);
+    cap->pwmOverflowed = false;
+  }
+  if (cap->pwmOverflowed)
+  {
+    *periodTicks = 0;
+    *pulseTicks = 0;
+    return false;
+  }
+  *periodTicks = (uint32_t)TIM_GetCap1(TIMx) + 1;
+  *pulseTicks = (uint32_t)TIM_GetCap2(TIMx) + 1;
+  return true;
+}
+
+/**
+ * @brief Capture interrupt service, called first by the GTIM handlers
+ * @param TIMx: Timer peripheral
+ * @param index: Timer index
+ * @return true if the timer is used for capture and the interrupt was handled
+ */
+static bool timer_capture_irq(TIM_Module* TIMx, int index)
+{
+  timer_capture_t* cap = &timer_captures[index];
+  bool overflow;
+  uint8_t i;
+
+  if (!cap->active)
+  {
+    return false;
+  }
+
+  overflow = TIM_GetIntStatus(TIMx, TIM_INT_UPDATE) != RESET;
+
+  for (i = 0; i < 4; i++)
+  {
+    timer_capture_channel_t* ch = &cap->ch[i];
+    uint32_t high;
+    uint32_t timestamp;
+    uint16_t raw;
+
+    if (ch->callBack == NULL || TIM_GetIntStatus(TIMx, timerCcInts[i]) == RESET)
+    {
+      continue;
+    }
+    raw = timer_read_ccr(TIMx, i + 1);   /* Reading the capture clears the flag */
+    TIM_ClrIntPendingBit(TIMx, timerCcInts[i]);
+
+    if (--ch->countdown != 0)
+    {
+      continue;
+    }
+    ch->countdown = ch->decimation;
+
+    /* Capture and overflow both pending: a small value was taken after the wrap */
+    high = cap->overflows;
+    if (overflow && raw < 0x8000)
+    {
+      high++;
+    }
+    timestamp = (high << 16) | raw;
+    ch->callBack(ch->ctx, timestamp, ch->haveLast ? timestamp - ch->last : 0);
+    ch->last = timestamp;
+    ch->haveLast = true;
+  }
+
+  if (overflow)
+  {
+    TIM_ClrIntPendingBit(TIMx, TIM_INT_UPDATE);
+    cap->overflows++;
+    if (cap->pwmMode)
+    {
+      /* No edge for a full counter period: drop the stale measurement */
+      TIM_ClearFlag(TIMx, TIM_FLAG_CC1);
+      cap->pwmOverflowed = true;
+    }
+  }
+  return true;
+}
+
 /* Timer interrupt handlers */
 
 /**
@@ -134,8 +904,12 @@ void timer_set_callback(TIM_Module* TIMx, timer_callback_t callBack)
  */
 void GTIM1_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM1, 0)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM1, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM1, TIM_INT_UPDATE);  // Clear interrupt flag
+    sched_signal(SCHED_SRC_GTIM1);
     if (timer_callbacks[0] != NULL) {
       timer_callbacks[0]();  // Call user callBack function
     }
@@ -147,8 +921,12 @@ void GTIM1_IRQHandler(void)
  */
 void GTIM2_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM2, 1)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM2, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM2, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM2);
     if (timer_callbacks[1] != NULL) {
       timer_callbacks[1]();  // Call user callBack function
         }
@@ -160,8 +938,12 @@ void GTIM2_IRQHandler(void)
  */
 void GTIM3_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM3, 2)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM3, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM3, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM3);
     if (timer_callbacks[2] != NULL) {
       timer_callbacks[2]();  // Call user callBack function
         }
@@ -173,8 +955,12 @@ void GTIM3_IRQHandler(void)
  */
 void GTIM4_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM4, 3)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM4, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM4, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM4);
     if (timer_callbacks[3] != NULL) {
       timer_callbacks[3]();  // Call user callBack function
         }
@@ -186,8 +972,12 @@ void GTIM4_IRQHandler(void)
  */
 void GTIM5_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM5, 4)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM5, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM5, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM5);
     if (timer_callbacks[4] != NULL) {
       timer_callbacks[4]();  // Call user callBack function
         }
@@ -199,8 +989,12 @@ void GTIM5_IRQHandler(void)
  */
 void GTIM6_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM6, 5)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM6, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM6, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM6);
     if (timer_callbacks[5] != NULL) {
       timer_callbacks[5]();  // Call user callBack function
         }
@@ -212,8 +1006,12 @@ void GTIM6_IRQHandler(void)
  */
 void GTIM7_IRQHandler(void)
 {
+  if (timer_capture_irq(GTIM7, 6)) {
+    return;  // Owned by input capture
+  }
   if (TIM_GetIntStatus(GTIM7, TIM_INT_UPDATE) != RESET) {
     TIM_ClrIntPendingBit(GTIM7, TIM_INT_UPDATE);
+    sched_signal(SCHED_SRC_GTIM7);
     if (timer_callbacks[6] != NULL) {
       timer_callbacks[6]();  // Call user callBack function
         }
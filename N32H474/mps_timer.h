@@ -4,16 +4,68 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#if defined(__ARM_ARCH) || defined(__CC_ARM)
 #include "n32h47x_48x_tim.h"
+#include "n32h47x_48x_dma.h"
+#include "mps_it.h"
+#else
+/* Host builds (Tools/) only use timer_solve_period */
+typedef struct TIM_Module TIM_Module;
+typedef struct DMA_ChannelType DMA_ChannelType;
+typedef void (*timer_callback_t)(void);
+#endif
 #include <stdbool.h>
 #include <stddef.h>
-#include "mps_it.h"
+#include "mps_swtimer.h"
+
+/**
+ * @brief Solved timer period
+ */
+typedef struct {
+  uint32_t prescaler;     /* Clock divider 1..65536 (register value + 1) */
+  uint32_t reload;        /* Counts per period 1..65536 (register value + 1) */
+  uint32_t timerClock;    /* Counter clock used in Hz */
+  int32_t errorPpm;       /* Achieved minus wanted period, in ppm */
+} timer_period_t;
+
+/**
+ * @brief Input capture edge
+ */
+typedef enum {
+  TIMER_EDGE_RISING = 0,
+  TIMER_EDGE_FALLING,
+  TIMER_EDGE_BOTH
+} timer_edge_t;
+
+/**
+ * @brief Input capture callBack (interrupt context)
+ * @param timestamp: 32-bit extended counter value at the edge
+ * @param delta: Ticks since the previously reported edge, 0 for the first one
+ */
+typedef void (*timer_capture_callback_t)(void* ctx, uint32_t timestamp, uint32_t delta);
 
 void timer_init(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack);
+int timer_init_oneshot(TIM_Module* TIMx, uint32_t periodUs, timer_callback_t callBack);
+int timer_set_period(TIM_Module* TIMx, uint32_t periodUs);
+uint32_t timer_get_clock(void);
+bool timer_solve_period(uint32_t timerClock, uint32_t periodUs, timer_period_t* result);
 void timer_enable_interrupt(TIM_Module* TIMx, uint8_t priority);
 void timer_start(TIM_Module* TIMx);
 void timer_stop(TIM_Module* TIMx);
 void timer_set_callback(TIM_Module* TIMx, timer_callback_t callBack);
+int timer_wheel_init(TIM_Module* TIMx, uint32_t tickUs, bool tickless);
+
+int timer_capture_init(TIM_Module* TIMx, uint32_t tickHz);
+int timer_capture_channel(TIM_Module* TIMx, uint8_t channel, timer_edge_t edge, uint16_t decimation,
+                          timer_capture_callback_t callBack, void* ctx);
+int timer_capture_dma_start(TIM_Module* TIMx, uint8_t channel, timer_edge_t edge,
+                            DMA_ChannelType* dmaChannel, uint32_t dmaRemap,
+                            uint16_t* buffer, uint16_t count);
+uint16_t timer_capture_dma_read(TIM_Module* TIMx, uint8_t channel, uint32_t* timestamps, uint16_t max);
+uint32_t timer_capture_now(TIM_Module* TIMx);
+uint32_t timer_capture_tick_hz(TIM_Module* TIMx);
+int timer_pwm_input_init(TIM_Module* TIMx, uint32_t tickHz);
+bool timer_pwm_input_read(TIM_Module* TIMx, uint32_t* periodTicks, uint32_t* pulseTicks);
 
 #ifdef __cplusplus
 }
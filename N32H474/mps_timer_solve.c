@@ -0,0 +1,66 @@
+#include "mps_timer.h"
+
+/**
+ * @brief Find the prescaler and reload with the lowest period error
+ *
+ * The period is prescaler * reload timer clocks, both 1..65536. A pair and
+ * its swap give the same period, so only the smaller factor is searched: from
+ * the smallest value that keeps the other one within 65536 up to one past
+ * the square root of the period, each with the nearest other factor. Pairs
+ * with both factors above that are always further off, so the result is the
+ * lowest error over the whole 16-bit prescaler range. The smaller factor
+ * becomes the prescaler, keeping the reload resolution of timer_set_period.
+ *
+ * @param timerClock: Counter clock in Hz (timer_get_clock)
+ * @param periodUs: Wanted period in microseconds
+ * @param result: Best prescaler and reload, achieved error in ppm
+ * @return true if the period is in range
+ */
+bool timer_solve_period(uint32_t timerClock, uint32_t periodUs, timer_period_t* result)
+{
+  /* Wanted period in units of 1/1000000 timer clock */
+  uint64_t target = (uint64_t)periodUs * timerClock;
+  uint64_t bestError = UINT64_MAX;
+  uint32_t factor;
+
+  if (result == NULL || timerClock == 0 || periodUs == 0 ||
+      target < 1000000ULL || target > 65536ULL * 65536ULL * 1000000ULL)
+  {
+    return false;
+  }
+
+  factor = (uint32_t)((target + 65536ULL * 1000000ULL - 1) / (65536ULL * 1000000ULL));
+  if (factor == 0)
+  {
+    factor = 1;
+  }
+
+  /* (factor - 1)^2 <= period: stops one past the square root */
+  for (; factor <= 65536 && (uint64_t)(factor - 1) * (factor - 1) * 1000000ULL <= target; factor++)
+  {
+    uint64_t step = (uint64_t)factor * 1000000ULL;
+    uint64_t other = (target + step / 2) / step;
+    uint64_t error;
+
+    if (other > 65536)
+    {
+      other = 65536;
+    }
+    error = (other * step > target) ? other * step - target : target - other * step;
+    if (error < bestError)
+    {
+      bestError = error;
+      result->prescaler = factor;
+      result->reload = (uint32_t)other;
+      if (error == 0)
+      {
+        break;
+      }
+    }
+  }
+
+  result->timerClock = timerClock;
+  result->errorPpm = (int32_t)((((int64_t)result->prescaler * result->reload * 1000000LL) - (int64_t)target) *
+                               1000000LL / (int64_t)target);
+  return true;
+}
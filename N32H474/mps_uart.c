@@ -4,87 +4,290 @@
 #include "n32h47x_48x_rcc.h"
 #include "n32h47x_48x_dma.h"
 #include "misc.h"
+#include "mps_sched.h"
+#include "mps_time.h"
 #include <stddef.h>    /* For NULL definition */
+#include <stdbool.h>
+#include <stdlib.h>    /* For labs */
 
-/* Buffer size definition (should match the one in main.c) */
-#define UART_BUFFER_SIZE 256
+/* Per-port driver context */
+typedef struct {
+  DMA_ChannelType* rxDmaChannel;  /* RX DMA channel (circular) */
+  DMA_ChannelType* txDmaChannel;  /* TX DMA channel */
+  mps_ring_t rx;                  /* Producer: RX DMA + ISR, consumer: application */
+  mps_ring_t tx;                  /* Producer: application, consumer: TX DMA */
+  uint8_t rxStorage[UART_RX_RING_SIZE];
+  uint8_t txStorage[UART_TX_RING_SIZE];
+  uint16_t rxLastPos;             /* DMA write position at last publish */
+  bool rxActive;                  /* Circular reception running */
+  uint32_t rxOverruns;            /* Times the reader fell a full ring behind */
+  uart_rx_callback_t rxCallBack;  /* Optional new-data notification */
+  uart_tx_desc_t txQueue[UART_TX_QUEUE_DEPTH];  /* Pending transfers, txQueue[txTail] is on the DMA */
+  volatile uint8_t txHead;        /* Next free descriptor (free-running) */
+  volatile uint8_t txTail;        /* Descriptor being sent (free-running) */
+  volatile bool txBusy;           /* TX DMA channel armed */
+  uint32_t txSubmitted;           /* TX ring position already described in txQueue */
+  uart_oversampling_t oversampling;  /* Oversampling requested at init */
+  uart_baud_t baud;               /* Current divider and achieved rate */
+} uart_port_t;
 
-/* External buffer and variables from main.c */
-extern uint8_t rxBuffer[];
-extern volatile uint16_t rxCount;
+static uart_port_t uartPorts[UART_PORT_COUNT];
+
+/**
+ * @brief Get the driver context of a USART, NULL if unsupported
+ */
+static uart_port_t* uart_get_port(USART_Module* USARTx)
+{
+  if (USARTx == USART1) return &uartPorts[0];
+  else if (USARTx == USART2) return &uartPorts[1];
+  else if (USARTx == USART3) return &uartPorts[2];
+  else return NULL;
+}
 
 /**
  * Send data using UART with DMA
  * @param USARTx - UART peripheral to use
- * @param txDmaChannel - DMA channel for TX
- * @param data - Data buffer to send
+ * @param txDmaChannel - DMA channel for TX (kept for compatibility, the port's channel is used)
+ * @param data - Data buffer to send, must stay valid until the transfer completes
  * @param size - Size of data to send
- * @return 1 if successful, 0 if failed
+ * @return 1 if queued, 0 if failed (invalid parameters or TX queue full)
+ * @note Does not block, see uart_write_async for a completion callBack
  */
 int uart_dma_send_data(USART_Module* USARTx, DMA_ChannelType* txDmaChannel, uint8_t* data, uint16_t size)
 {
-  /* Check parameters */
-  if (data == NULL || size == 0)
+  (void)txDmaChannel;
+  return uart_write_async(USARTx, data, size, NULL, NULL);
+}
+
+/**
+ * Receive data with DMA (compatibility wrapper)
+ *
+ * Reception runs on the port's circular DMA ring (uart_rx_dma_start); this
+ * starts it if needed and copies out what has arrived, without touching the
+ * ring channel. Never blocks.
+ *
+ * @param USARTx - UART peripheral to use
+ * @param rxDmaChannel - unused, the port owns its RX channel
+ * @param data - Data buffer for received data
+ * @param size - Size of data buffer
+ * @return number of bytes copied, 0 if none arrived or reception could not start
+ */
+int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, uint8_t* data, uint16_t size)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  (void)rxDmaChannel;
+  if (port == NULL || data == NULL || size == 0)
   {
-  return 0;
+    return 0;
+  }
+  if (!port->rxActive && !uart_rx_dma_start(USARTx, NULL))
+  {
+    return 0;
   }
-  
-  /* Wait until DMA channel is free */
-  while (DMA_GetCurrDataCounter(txDmaChannel) != 0)
+  return uart_rx_read(USARTx, data, size);
+}
+
+
+
+/**
+ * @brief Fill a configuration with the default 115200 8N1 settings, no flow control
+ */
+void uart_config_default(uart_config_t* config)
+{
+  config->baudRate     = UART_DEFAULT_BAUDRATE;
+  config->wordLength   = USART_WL_8B;
+  config->stopBits     = USART_STPB_1;
+  config->parity       = USART_PE_NO;
+  config->flowControl  = USART_HFCTRL_NONE;
+  config->oversampling = UART_OVERSAMPLING_16;
+}
+
+/**
+ * @brief Get the kernel clock of a USART (USART1 on APB2, USART2/3 on APB1)
+ * @param USARTx - UART peripheral
+ * @return clock in Hz, 0 for an unsupported peripheral
+ */
+uint32_t uart_get_pclk(USART_Module* USARTx)
+{
+  RCC_ClocksType RCC_Clocks;
+
+  RCC_GetClocksFreqValue(&RCC_Clocks);
+  if (USARTx == USART1) return RCC_Clocks.Pclk2Freq;
+  else if (USARTx == USART2 || USARTx == USART3) return RCC_Clocks.Pclk1Freq;
+  else return 0;
+}
+
+/**
+ * @brief Solve the divider for one oversampling mode
+ *
+ * BRCF holds USARTDIV = pclk / (oversampling * baud) as 12.4 fixed point. With
+ * oversampling by 8 the fraction has 3 bits and is stored right-aligned.
+ * Rounding the 1/16 (or 1/8) step to nearest gives the lowest error.
+ */
+static int uart_solve_mode(uint32_t pclk, uint32_t baudRate, uart_oversampling_t mode, uart_baud_t* result)
+{
+  uint32_t samples = (mode == UART_OVERSAMPLING_8) ? 8 : 16;
+  uint32_t fracSteps = samples;  /* Fraction steps per integer divider */
+  uint64_t div;
+  uint32_t mantissa;
+  uint32_t fraction;
+
+  /* div = USARTDIV * fracSteps = pclk / baud rounded */
+  div = ((uint64_t)pclk + baudRate / 2) / baudRate;
+  if (div < samples || (div / fracSteps) > 0xFFF)
   {
-  /* Wait for the current transfer to complete */
+    return 0;  /* Baud rate out of range for this clock */
   }
-  
-  /* Configure DMA Channel buffer size and memory address */
-  txDmaChannel->TXNUM = size;
-  txDmaChannel->MADDR = (uint32_t)data;
-  
-  /* Enable DMA Channel */
-  DMA_EnableChannel(txDmaChannel, ENABLE);
-  
+
+  mantissa = (uint32_t)(div / fracSteps);
+  fraction = (uint32_t)(div % fracSteps);
+
+  result->brcf = (mantissa << 4) | fraction;
+  result->oversampling = mode;
+  result->actualBaud = (uint32_t)(((uint64_t)pclk + div / 2) / div);
+  result->errorPpm = (int32_t)((((int64_t)result->actualBaud - baudRate) * 1000000) / baudRate);
   return 1;
 }
 
 /**
- * Configure UART to receive data with DMA
- * @param USARTx - UART peripheral to use
- * @param rxDmaChannel - DMA channel for RX
- * @param data - Data buffer for received data
- * @param size - Size of data buffer
- * @return 1 if successful, 0 if failed
+ * @brief Find the baud divider with the lowest error
+ * @param pclk - USART kernel clock in Hz
+ * @param baudRate - requested baud rate
+ * @param oversampling - mode to use, UART_OVERSAMPLING_AUTO tries both
+ * @param result - chosen divider, oversampling and achieved rate
+ * @return 1 if a divider exists, 0 if the rate is out of range (or by 8 is
+ *         requested without UART_HAS_OVER8)
  */
-int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, uint8_t* data, uint16_t size)
+int uart_solve_baud(uint32_t pclk, uint32_t baudRate, uart_oversampling_t oversampling, uart_baud_t* result)
 {
-  /* Check parameters */
-  if (data == NULL || size == 0)
+  uart_baud_t by16;
+  uart_baud_t by8;
+  int ok16 = 0;
+  int ok8 = 0;
+
+  if (result == NULL || pclk == 0 || baudRate == 0)
   {
+    return 0;
+  }
+
+  if (oversampling != UART_OVERSAMPLING_8)
+  {
+    ok16 = uart_solve_mode(pclk, baudRate, UART_OVERSAMPLING_16, &by16);
+  }
+  if (UART_HAS_OVER8 && oversampling != UART_OVERSAMPLING_16)
+  {
+    ok8 = uart_solve_mode(pclk, baudRate, UART_OVERSAMPLING_8, &by8);
+  }
+
+  /* Prefer oversampling by 16 unless by 8 is strictly more accurate */
+  if (ok16 && (!ok8 || labs(by16.errorPpm) <= labs(by8.errorPpm)))
+  {
+    *result = by16;
+    return 1;
+  }
+  if (ok8)
+  {
+    *result = by8;
+    return 1;
+  }
   return 0;
+}
+
+/**
+ * @brief Write a solved divider and oversampling mode to the USART
+ * @note The USART must be disabled
+ */
+static void uart_apply_baud(USART_Module* USARTx, const uart_baud_t* baud)
+{
+#if UART_HAS_OVER8
+  if (baud->oversampling == UART_OVERSAMPLING_8)
+  {
+    USARTx->CTRL1 |= USART_CTRL1_OVER8;
+  }
+  else
+  {
+    USARTx->CTRL1 &= ~USART_CTRL1_OVER8;
+  }
+#endif
+  USARTx->BRCF = baud->brcf;
+}
+
+/**
+ * @brief Change the baud rate at runtime
+ *
+ * Waits for queued transmissions to drain, then briefly disables the USART to
+ * rewrite the divider. DMA channels, rings and interrupts stay configured.
+ *
+ * @param USARTx - UART peripheral (must be initialized)
+ * @param baudRate - new baud rate
+ * @param result - achieved rate and error, may be NULL
+ * @return 1 if successful, 0 if the rate cannot be generated or the
+ *         transmitter did not drain within UART_DRAIN_TIMEOUT_US (rate unchanged)
+ */
+int uart_set_baud(USART_Module* USARTx, uint32_t baudRate, uart_baud_t* result)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uart_baud_t baud;
+  time_deadline_t timeout;
+
+  if (port == NULL || !uart_solve_baud(uart_get_pclk(USARTx), baudRate, port->oversampling, &baud))
+  {
+    return 0;
+  }
+
+  /* Let the last frame leave the shift register */
+  timeout = time_deadline_us(UART_DRAIN_TIMEOUT_US);
+  while (uart_tx_busy(USARTx) || USART_GetFlagStatus(USARTx, USART_FLAG_TXC) == RESET)
+  {
+    if (time_expired(timeout))
+    {
+      return 0;
+    }
   }
-  
-  /* Wait until DMA channel is free */
-  while (DMA_GetCurrDataCounter(rxDmaChannel) != 0)
+
+  USART_Enable(USARTx, DISABLE);
+  uart_apply_baud(USARTx, &baud);
+  USART_Enable(USARTx, ENABLE);
+
+  port->baud = baud;
+  if (result != NULL)
   {
-  /* Wait for the current transfer to complete */
+    *result = baud;
   }
-  
-  /* Configure DMA Channel buffer size and memory address */
-  rxDmaChannel->TXNUM = size;
-  rxDmaChannel->MADDR = (uint32_t)data;
-  
-  /* Enable DMA Channel */
-  DMA_EnableChannel(rxDmaChannel, ENABLE);
-  
   return 1;
 }
 
+/**
+ * @brief Get the baud rate actually produced by the current divider
+ */
+uint32_t uart_get_baud(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
 
+  return (port == NULL) ? 0 : port->baud.actualBaud;
+}
 
 /**
- * UART DMA interrupt initialization function
+ * UART DMA interrupt initialization function (115200 8N1, no flow control)
  * @param USARTx - UART peripheral to use (USART1, USART2, USART3)
  * @return 1 if successful, 0 if failed
  */
- int uart_dma_interrupt_init(USART_Module* USARTx)
+int uart_dma_interrupt_init(USART_Module* USARTx)
+{
+  uart_config_t config;
+
+  uart_config_default(&config);
+  return uart_dma_interrupt_init_ex(USARTx, &config);
+}
+
+/**
+ * UART DMA interrupt initialization function with line configuration
+ * @param USARTx - UART peripheral to use (USART1, USART2, USART3)
+ * @param config - line settings, see uart_config_default
+ * @return 1 if successful, 0 if failed (invalid peripheral or baud out of range)
+ */
+ int uart_dma_interrupt_init_ex(USART_Module* USARTx, const uart_config_t* config)
  {
    USART_InitType USART_InitStructure;
    GPIO_InitType GPIO_InitStructure;
@@ -98,6 +301,13 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    uint16_t UART_RX_PIN;
    uint8_t UART_TX_AF;
    uint8_t UART_RX_AF;
+   GPIO_Module* UART_FC_GPIO;
+   uint32_t UART_FC_GPIO_CLK;
+   uint16_t UART_CTS_PIN;
+   uint16_t UART_RTS_PIN;
+   uint8_t UART_FC_AF;
+   bool UART_CLK_APB2;
+   uart_baud_t baud;
    DMA_ChannelType* UART_TX_DMA_Channel;
    DMA_ChannelType* UART_RX_DMA_Channel;
    uint32_t UART_TX_DMA_FLAG;
@@ -105,6 +315,7 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    uint32_t UART_TX_DMA_REMAP;
    uint32_t UART_RX_DMA_REMAP;
    uint8_t UART_IRQn;
+   uint8_t UART_TX_DMA_IRQn;
    uint32_t UART_DAT_Base;
    
    /* Select UART peripheral configuration based on the USARTx parameter */
@@ -117,6 +328,12 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_RX_PIN = USART1_RX_PIN;
    UART_TX_AF = USART1_TX_AF;
    UART_RX_AF = USART1_RX_AF;
+   UART_FC_GPIO = USART1_FC_GPIO;
+   UART_FC_GPIO_CLK = USART1_FC_GPIO_CLK;
+   UART_CTS_PIN = USART1_CTS_PIN;
+   UART_RTS_PIN = USART1_RTS_PIN;
+   UART_FC_AF = USART1_FC_AF;
+   UART_CLK_APB2 = true;
    UART_TX_DMA_Channel = USART1_TX_DMA_CH;
    UART_RX_DMA_Channel = USART1_RX_DMA_CH;
    UART_TX_DMA_FLAG = USART1_TX_DMA_FLAG;
@@ -124,6 +341,7 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_TX_DMA_REMAP = USART1_TX_DMA_REMAP;
    UART_RX_DMA_REMAP = USART1_RX_DMA_REMAP;
    UART_IRQn = USART1_IRQn;
+   UART_TX_DMA_IRQn = USART1_TX_DMA_IRQn;
    UART_DAT_Base = USART1_DAT_BASE;
    }
    else if (USARTx == USART2)
@@ -135,6 +353,12 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_RX_PIN = USART2_RX_PIN;
    UART_TX_AF = USART2_TX_AF;
    UART_RX_AF = USART2_RX_AF;
+   UART_FC_GPIO = USART2_FC_GPIO;
+   UART_FC_GPIO_CLK = USART2_FC_GPIO_CLK;
+   UART_CTS_PIN = USART2_CTS_PIN;
+   UART_RTS_PIN = USART2_RTS_PIN;
+   UART_FC_AF = USART2_FC_AF;
+   UART_CLK_APB2 = false;
    UART_TX_DMA_Channel = USART2_TX_DMA_CH;
    UART_RX_DMA_Channel = USART2_RX_DMA_CH;
    UART_TX_DMA_FLAG = USART2_TX_DMA_FLAG;
@@ -142,6 +366,7 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_TX_DMA_REMAP = USART2_TX_DMA_REMAP;
    UART_RX_DMA_REMAP = USART2_RX_DMA_REMAP;
    UART_IRQn = USART2_IRQn;
+   UART_TX_DMA_IRQn = USART2_TX_DMA_IRQn;
    UART_DAT_Base = USART2_DAT_BASE;
    }
    else if (USARTx == USART3)
@@ -153,6 +378,12 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_RX_PIN = USART3_RX_PIN;
    UART_TX_AF = USART3_TX_AF;
    UART_RX_AF = USART3_RX_AF;
+   UART_FC_GPIO = USART3_FC_GPIO;
+   UART_FC_GPIO_CLK = USART3_FC_GPIO_CLK;
+   UART_CTS_PIN = USART3_CTS_PIN;
+   UART_RTS_PIN = USART3_RTS_PIN;
+   UART_FC_AF = USART3_FC_AF;
+   UART_CLK_APB2 = false;
    UART_TX_DMA_Channel = USART3_TX_DMA_CH;
    UART_RX_DMA_Channel = USART3_RX_DMA_CH;
    UART_TX_DMA_FLAG = USART3_TX_DMA_FLAG;
@@ -160,6 +391,7 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    UART_TX_DMA_REMAP = USART3_TX_DMA_REMAP;
    UART_RX_DMA_REMAP = USART3_RX_DMA_REMAP;
    UART_IRQn = USART3_IRQn;
+   UART_TX_DMA_IRQn = USART3_TX_DMA_IRQn;
    UART_DAT_Base = USART3_DAT_BASE;
    }
    else
@@ -167,6 +399,23 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    return 0; /* Invalid UART peripheral */
    }
    
+   if (config == NULL)
+   {
+   return 0;
+   }
+   
+   /* Set up the port context and its rings */
+   uart_port_t* port = uart_get_port(USARTx);
+   port->rxDmaChannel = UART_RX_DMA_Channel;
+   port->txDmaChannel = UART_TX_DMA_Channel;
+   port->rxActive = false;
+   port->txHead = 0;
+   port->txTail = 0;
+   port->txBusy = false;
+   port->txSubmitted = 0;
+   ring_init(&port->rx, port->rxStorage, UART_RX_RING_SIZE);
+   ring_init(&port->tx, port->txStorage, UART_TX_RING_SIZE);
+   
    /* System Clocks Configuration */
    /* DMA clock enable */
    RCC_EnableAHBPeriphClk(RCC_AHB_PERIPHEN_DMA1, ENABLE);
@@ -175,10 +424,24 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    RCC_EnableAHB1PeriphClk(UART_GPIO_CLK, ENABLE);
    RCC_EnableAPB2PeriphClk(RCC_APB2_PERIPH_AFIO, ENABLE);
    
-   /* Enable UART Clock */
-  
+   /* Enable UART Clock on the bus the peripheral sits on */
+   if (UART_CLK_APB2)
+   {
    RCC_EnableAPB2PeriphClk(UART_CLK, ENABLE);
+   }
+   else
+   {
    RCC_EnableAPB1PeriphClk(UART_CLK, ENABLE);
+   }
+   
+   /* Timebase for the uart_set_baud drain timeout */
+   time_init();
+   
+   /* Solve the divider against the real peripheral clock */
+   if (!uart_solve_baud(uart_get_pclk(USARTx), config->baudRate, config->oversampling, &baud))
+   {
+   return 0; /* Baud rate out of range */
+   }
    
    
    /* Configure GPIO ports */
@@ -197,6 +460,15 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    GPIO_InitStructure.GPIO_Alternate = UART_RX_AF;
    GPIO_InitPeripheral(UART_GPIO, &GPIO_InitStructure);
    
+   /* Configure CTS/RTS if hardware flow control is used */
+   if (config->flowControl != USART_HFCTRL_NONE)
+   {
+   RCC_EnableAHB1PeriphClk(UART_FC_GPIO_CLK, ENABLE);
+   GPIO_InitStructure.Pin            = UART_CTS_PIN | UART_RTS_PIN;
+   GPIO_InitStructure.GPIO_Alternate = UART_FC_AF;
+   GPIO_InitPeripheral(UART_FC_GPIO, &GPIO_InitStructure);
+   }
+   
    /* NVIC Configuration */
    /* Configure the Priority Grouping */
    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
@@ -226,35 +498,524 @@ int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, u
    DMA_Init(UART_TX_DMA_Channel, &DMA_InitStructure);
    DMA_RequestRemap(UART_TX_DMA_REMAP, UART_TX_DMA_Channel, ENABLE);
    
+   /* Transfer complete chains the next queued TX descriptor */
+   DMA_ConfigInt(UART_TX_DMA_Channel, DMA_INT_TXC, ENABLE);
+   NVIC_InitStructure.NVIC_IRQChannel                   = UART_TX_DMA_IRQn;
+   NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+   NVIC_InitStructure.NVIC_IRQChannelSubPriority        = 1;
+   NVIC_InitStructure.NVIC_IRQChannelCmd                = ENABLE;
+   NVIC_Init(&NVIC_InitStructure);
+   
    /* DMA RX Channel Configuration */
    DMA_DeInit(UART_RX_DMA_Channel);
    DMA_InitStructure.PeriphAddr = UART_DAT_Base;
    DMA_InitStructure.MemAddr    = 0; /* Will be set when receiving data */
    DMA_InitStructure.Direction  = DMA_DIR_PERIPH_SRC;
    DMA_InitStructure.BufSize    = 0; /* Will be set when receiving data */
+   DMA_InitStructure.CircularMode = DMA_MODE_CIRCULAR; /* Continuous reception into a ring */
    DMA_Init(UART_RX_DMA_Channel, &DMA_InitStructure);
    DMA_RequestRemap(UART_RX_DMA_REMAP, UART_RX_DMA_Channel, ENABLE);
    
    /* UART configuration */
    USART_StructInit(&USART_InitStructure);
-   USART_InitStructure.BaudRate            = 115200;
-   USART_InitStructure.WordLength          = USART_WL_8B;
-   USART_InitStructure.StopBits            = USART_STPB_1;
-   USART_InitStructure.Parity              = USART_PE_NO;
-   USART_InitStructure.HardwareFlowControl = USART_HFCTRL_NONE;
+   USART_InitStructure.BaudRate            = config->baudRate;
+   USART_InitStructure.WordLength          = config->wordLength;
+   USART_InitStructure.StopBits            = config->stopBits;
+   USART_InitStructure.Parity              = config->parity;
+   USART_InitStructure.HardwareFlowControl = config->flowControl;
    USART_InitStructure.Mode                = USART_MODE_RX | USART_MODE_TX;
    USART_Init(USARTx, &USART_InitStructure);
    
+   /* Replace the library divider by the solved one (exact clock, optional oversampling by 8) */
+   uart_apply_baud(USARTx, &baud);
+   port->oversampling = config->oversampling;
+   port->baud = baud;
+   
    /* Enable UART DMA Tx and Rx request */
    USART_EnableDMA(USARTx, USART_DMAREQ_TX | USART_DMAREQ_RX, ENABLE);
    
-   /* Enable UART Receive Interrupt */
-   USART_ConfigInt(USARTx, USART_INT_RXDNE, ENABLE);
+   /* Reception is done by circular DMA, see uart_rx_dma_start */
    
    /* Enable UART */
    USART_Enable(USARTx, ENABLE);
    
    return 1; /* Initialization successful */
  }
- 
 
+
+/**
+ * @brief Start continuous reception by circular DMA
+ *
+ * The RX DMA channel writes into the port receive ring forever. New data is
+ * published on the USART IDLE-line interrupt and on the DMA half/full transfer
+ * interrupts, so the CPU takes a few interrupts per frame instead of one per byte.
+ *
+ * @param USARTx - UART peripheral (must be initialized by uart_dma_interrupt_init)
+ * @param callBack - optional notification of new data extents (ISR context), may be NULL
+ * @return 1 if successful, 0 if failed
+ */
+int uart_rx_dma_start(USART_Module* USARTx, uart_rx_callback_t callBack)
+{
+  NVIC_InitType NVIC_InitStructure;
+  uart_port_t* port = uart_get_port(USARTx);
+  IRQn_Type dmaIrq;
+
+  if (port == NULL || port->rxDmaChannel == NULL)
+  {
+    return 0;
+  }
+
+  if (USARTx == USART1) dmaIrq = USART1_RX_DMA_IRQn;
+  else if (USARTx == USART2) dmaIrq = USART2_RX_DMA_IRQn;
+  else dmaIrq = USART3_RX_DMA_IRQn;
+
+  DMA_EnableChannel(port->rxDmaChannel, DISABLE);
+
+  ring_reset(&port->rx);
+  port->rxLastPos = 0;
+  port->rxOverruns = 0;
+  port->rxCallBack = callBack;
+
+  /* Program ring address and length, then enable half/full transfer interrupts */
+  port->rxDmaChannel->TXNUM = UART_RX_RING_SIZE;
+  port->rxDmaChannel->MADDR = (uint32_t)port->rxStorage;
+  DMA_ConfigInt(port->rxDmaChannel, DMA_INT_HTX | DMA_INT_TXC, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel                   = dmaIrq;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority        = 1;
+  NVIC_InitStructure.NVIC_IRQChannelCmd                = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  /* Flush stale data and enable the IDLE-line interrupt */
+  (void)USARTx->STS;
+  (void)USARTx->DAT;
+  USART_ConfigInt(USARTx, USART_INT_IDLEF, ENABLE);
+
+  port->rxActive = true;
+  DMA_EnableChannel(port->rxDmaChannel, ENABLE);
+
+  return 1;
+}
+
+/**
+ * @brief Stop circular DMA reception
+ * @param USARTx - UART peripheral
+ */
+void uart_rx_dma_stop(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  if (port == NULL || !port->rxActive)
+  {
+    return;
+  }
+  USART_ConfigInt(USARTx, USART_INT_IDLEF, DISABLE);
+  DMA_ConfigInt(port->rxDmaChannel, DMA_INT_HTX | DMA_INT_TXC, DISABLE);
+  DMA_EnableChannel(port->rxDmaChannel, DISABLE);
+  port->rxActive = false;
+}
+
+/**
+ * @brief Publish data written by the DMA since the last call (producer side)
+ *
+ * Called from the USART IDLE interrupt and from the RX DMA half/full transfer
+ * interrupts. With half transfer interrupts enabled the DMA can never lap the
+ * last published position unnoticed.
+ *
+ * @param USARTx - UART peripheral
+ */
+void uart_rx_dma_irq(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint16_t pos;
+  uint16_t lastPos;
+  uint16_t length;
+
+  if (port == NULL || !port->rxActive)
+  {
+    return;
+  }
+
+  /* Current DMA write position inside the ring */
+  pos = UART_RX_RING_SIZE - (uint16_t)DMA_GetCurrDataCounter(port->rxDmaChannel);
+  if (pos >= UART_RX_RING_SIZE)
+  {
+    pos = 0;
+  }
+  lastPos = port->rxLastPos;
+  if (pos == lastPos)
+  {
+    return;
+  }
+
+  if (pos > lastPos)
+  {
+    length = pos - lastPos;
+    if (port->rxCallBack != NULL)
+    {
+      port->rxCallBack(USARTx, lastPos, length);
+    }
+  }
+  else
+  {
+    /* Extent wraps around the end of the ring: report it as two spans */
+    length = (UART_RX_RING_SIZE - lastPos) + pos;
+    if (port->rxCallBack != NULL)
+    {
+      port->rxCallBack(USARTx, lastPos, UART_RX_RING_SIZE - lastPos);
+      if (pos != 0)
+      {
+        port->rxCallBack(USARTx, 0, pos);
+      }
+    }
+  }
+
+  port->rxLastPos = pos;
+  ring_write_commit(&port->rx, length);
+  sched_signal((sched_source_t)(SCHED_SRC_UART1_RX + (port - uartPorts)));
+}
+
+/**
+ * @brief Drop data the DMA has already overwritten (consumer side)
+ */
+static void uart_rx_check_overrun(uart_port_t* port)
+{
+  uint32_t head = port->rx.head;
+
+  if ((head - port->rx.tail) > port->rx.size)
+  {
+    port->rx.tail = head - port->rx.size;
+    port->rxOverruns++;
+  }
+}
+
+/**
+ * @brief Number of received bytes not yet consumed
+ * @param USARTx - UART peripheral
+ */
+uint16_t uart_rx_available(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  if (port == NULL || !port->rxActive)
+  {
+    return 0;
+  }
+  uart_rx_check_overrun(port);
+  return (uint16_t)ring_count(&port->rx);
+}
+
+/**
+ * @brief Copy received bytes out of the receive ring
+ * @param USARTx - UART peripheral
+ * @param data - destination buffer
+ * @param size - destination buffer size
+ * @return number of bytes copied
+ */
+uint16_t uart_rx_read(USART_Module* USARTx, uint8_t* data, uint16_t size)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  if (port == NULL || !port->rxActive || data == NULL)
+  {
+    return 0;
+  }
+  uart_rx_check_overrun(port);
+  return (uint16_t)ring_read(&port->rx, data, size);
+}
+
+/**
+ * @brief Zero-copy access to received data
+ * @param USARTx - UART peripheral
+ * @param length - receives the length of the contiguous span, 0 if empty
+ * @return pointer into the receive ring, release with uart_rx_commit
+ */
+const uint8_t* uart_rx_peek(USART_Module* USARTx, uint16_t* length)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint32_t span = 0;
+  const uint8_t* data = NULL;
+
+  if (port != NULL && port->rxActive)
+  {
+    uart_rx_check_overrun(port);
+    data = ring_read_peek(&port->rx, &span);
+  }
+  *length = (uint16_t)span;
+  return data;
+}
+
+/**
+ * @brief Release bytes obtained with uart_rx_peek
+ * @param USARTx - UART peripheral
+ * @param length - number of bytes consumed
+ */
+void uart_rx_commit(USART_Module* USARTx, uint16_t length)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  if (port != NULL)
+  {
+    ring_read_commit(&port->rx, length);
+  }
+}
+
+/**
+ * @brief Number of receive ring overruns since uart_rx_dma_start
+ * @param USARTx - UART peripheral
+ */
+uint32_t uart_rx_overruns(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  return (port == NULL) ? 0 : port->rxOverruns;
+}
+
+/**
+ * @brief Load a descriptor into the TX DMA channel and start it
+ */
+static void uart_tx_arm(uart_port_t* port, const uart_tx_desc_t* desc)
+{
+  /* The channel must be disabled while reloading TXNUM/MADDR */
+  DMA_EnableChannel(port->txDmaChannel, DISABLE);
+  port->txDmaChannel->TXNUM = desc->length;
+  port->txDmaChannel->MADDR = (uint32_t)desc->data;
+  DMA_EnableChannel(port->txDmaChannel, ENABLE);
+}
+
+/**
+ * @brief Append a descriptor to the TX queue, start the DMA if idle
+ * @note Caller holds the port critical section
+ * @return true if queued, false if the queue is full
+ */
+static bool uart_tx_enqueue(uart_port_t* port, const uint8_t* data, uint16_t length,
+                            uart_tx_done_t done, void* ctx, bool fromRing)
+{
+  uart_tx_desc_t* desc;
+
+  if ((uint8_t)(port->txHead - port->txTail) >= UART_TX_QUEUE_DEPTH)
+  {
+    return false;
+  }
+  desc = &port->txQueue[port->txHead & (UART_TX_QUEUE_DEPTH - 1)];
+  desc->data = data;
+  desc->length = length;
+  desc->done = done;
+  desc->ctx = ctx;
+  desc->fromRing = fromRing;
+  port->txHead++;
+
+  if (!port->txBusy)
+  {
+    port->txBusy = true;
+    uart_tx_arm(port, desc);
+  }
+  return true;
+}
+
+/**
+ * @brief Describe TX ring bytes not yet queued (one descriptor per contiguous span)
+ * @note Caller holds the port critical section
+ * @return true if the whole ring content is queued
+ */
+static bool uart_tx_submit_ring(uart_port_t* port)
+{
+  uint32_t head = port->tx.head;
+
+  while (port->txSubmitted != head)
+  {
+    uint32_t index = port->txSubmitted & port->tx.mask;
+    uint32_t length = head - port->txSubmitted;
+
+    if (length > port->tx.size - index)
+    {
+      length = port->tx.size - index;
+    }
+    if (!uart_tx_enqueue(port, &port->tx.buffer[index], (uint16_t)length, NULL, NULL, true))
+    {
+      return false;
+    }
+    port->txSubmitted += length;
+  }
+  return true;
+}
+
+/**
+ * @brief TX DMA transfer complete handler, returns the finished buffer and arms the next one
+ *
+ * Called from the TX DMA channel interrupt. The next descriptor is started
+ * before the completion callBack runs so consecutive frames leave the DMA
+ * back to back.
+ *
+ * @param USARTx - UART peripheral
+ */
+void uart_tx_dma_irq(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uart_tx_desc_t done;
+
+  if (port == NULL || !port->txBusy)
+  {
+    return;
+  }
+
+  done = port->txQueue[port->txTail & (UART_TX_QUEUE_DEPTH - 1)];
+  port->txTail++;
+
+  if (port->txHead != port->txTail)
+  {
+    uart_tx_arm(port, &port->txQueue[port->txTail & (UART_TX_QUEUE_DEPTH - 1)]);
+  }
+  else
+  {
+    DMA_EnableChannel(port->txDmaChannel, DISABLE);
+    port->txBusy = false;
+  }
+
+  /* Return ownership of the sent buffer */
+  if (done.fromRing)
+  {
+    ring_read_commit(&port->tx, done.length);
+  }
+  else if (done.done != NULL)
+  {
+    done.done(done.ctx, done.data, done.length);
+  }
+
+  /* A descriptor slot is free: queue ring data left behind by a full queue */
+  uart_tx_submit_ring(port);
+  sched_signal((sched_source_t)(SCHED_SRC_UART1_TX + (port - uartPorts)));
+}
+
+/**
+ * @brief Queue a buffer for DMA transmission without copying it
+ * @param USARTx - UART peripheral
+ * @param data - buffer to send, owned by the driver until done is called
+ * @param size - number of bytes
+ * @param done - ownership-return callBack (interrupt context), may be NULL
+ * @param ctx - user context passed to done
+ * @return 1 if queued, 0 if failed (invalid parameters or TX queue full)
+ */
+int uart_write_async(USART_Module* USARTx, const uint8_t* data, uint16_t size,
+                     uart_tx_done_t done, void* ctx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint32_t primask;
+  bool queued = false;
+
+  if (port == NULL || port->txDmaChannel == NULL || data == NULL || size == 0)
+  {
+    return 0;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  /* Keep transmit order: ring data written earlier goes first */
+  if (uart_tx_submit_ring(port))
+  {
+    queued = uart_tx_enqueue(port, data, size, done, ctx, false);
+  }
+  __set_PRIMASK(primask);
+
+  return queued ? 1 : 0;
+}
+
+/**
+ * @brief Queue bytes written into the transmit ring that are not sent yet
+ * @param USARTx - UART peripheral
+ */
+void uart_tx_kick(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint32_t primask;
+
+  if (port == NULL || port->txDmaChannel == NULL)
+  {
+    return;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  uart_tx_submit_ring(port);
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Queue data for transmission through the transmit ring
+ * @param USARTx - UART peripheral
+ * @param data - data to send (copied into the ring)
+ * @param size - number of bytes
+ * @return number of bytes queued, less than size if the ring is full
+ */
+uint16_t uart_write(USART_Module* USARTx, const uint8_t* data, uint16_t size)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint16_t written;
+
+  if (port == NULL || data == NULL)
+  {
+    return 0;
+  }
+  written = (uint16_t)ring_write(&port->tx, data, size);
+  uart_tx_kick(USARTx);
+  return written;
+}
+
+/**
+ * @brief Zero-copy access to free transmit ring space
+ * @param USARTx - UART peripheral
+ * @param length - receives the length of the contiguous free span
+ * @return pointer into the transmit ring, fill it and call uart_tx_commit
+ */
+uint8_t* uart_tx_peek(USART_Module* USARTx, uint16_t* length)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+  uint32_t span = 0;
+  uint8_t* data = NULL;
+
+  if (port != NULL)
+  {
+    data = ring_write_peek(&port->tx, &span);
+  }
+  *length = (uint16_t)span;
+  return data;
+}
+
+/**
+ * @brief Queue bytes written into the span from uart_tx_peek and start sending
+ * @param USARTx - UART peripheral
+ * @param length - number of bytes written
+ */
+void uart_tx_commit(USART_Module* USARTx, uint16_t length)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  if (port != NULL)
+  {
+    ring_write_commit(&port->tx, length);
+    uart_tx_kick(USARTx);
+  }
+}
+
+/**
+ * @brief Number of bytes waiting in the transmit ring (including in-flight)
+ * @param USARTx - UART peripheral
+ */
+uint16_t uart_tx_pending(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  return (port == NULL) ? 0 : (uint16_t)ring_count(&port->tx);
+}
+
+/**
+ * @brief Check whether the TX DMA still has queued or in-flight transfers
+ * @param USARTx - UART peripheral
+ */
+bool uart_tx_busy(USART_Module* USARTx)
+{
+  uart_port_t* port = uart_get_port(USARTx);
+
+  return (port != NULL) && port->txBusy;
+}
@@ -25,6 +25,7 @@
 #include "n32h47x_48x_dma.h"
 #include "n32h47x_48x_usart.h"
 #include "mps_crc.h"
+#include "mps_ring.h"
 
 /** UART Error Codes **/
 typedef enum
@@ -47,6 +48,13 @@ typedef enum
 #ifndef DMA_REMAP_UART4_RX
 #define DMA_REMAP_UART4_RX       0x00000000U  // Please update with correct value from reference code
 #endif
+/* Oversampling by 8 only where the device header provides the USART CTRL1 bit */
+#ifdef USART_CTRL1_OVER8
+#define UART_HAS_OVER8           1
+#else
+#define UART_HAS_OVER8           0
+#endif
+
 /* Module aliases to match the peripheral naming in the device header */
 #define USART1_MODULE             USART1
 #define USART2_MODULE             USART2
@@ -68,6 +76,14 @@ typedef enum
 #define USART1_RX_DMA_FLAG       DMA_FLAG_TC5
 #define USART1_TX_DMA_REMAP      DMA_REMAP_USART1_TX
 #define USART1_RX_DMA_REMAP      DMA_REMAP_USART1_RX
+#define USART1_RX_DMA_HT_FLAG    DMA_FLAG_HT5
+#define USART1_CTS_PIN           GPIO_PIN_11
+#define USART1_RTS_PIN           GPIO_PIN_12
+#define USART1_FC_GPIO           GPIOA
+#define USART1_FC_GPIO_CLK       RCC_AHB_PERIPHEN_GPIOA
+#define USART1_FC_AF             GPIO_AF5
+#define USART1_TX_DMA_IRQn       DMA1_Channel4_IRQn
+#define USART1_RX_DMA_IRQn       DMA1_Channel5_IRQn
 /* USART1_IRQn is already defined in system headers */
 
 /* USART2 Configuration */
@@ -85,6 +101,14 @@ typedef enum
 #define USART2_RX_DMA_FLAG       DMA_FLAG_TC6
 #define USART2_TX_DMA_REMAP      DMA_REMAP_USART2_TX
 #define USART2_RX_DMA_REMAP      DMA_REMAP_USART2_RX
+#define USART2_RX_DMA_HT_FLAG    DMA_FLAG_HT6
+#define USART2_CTS_PIN           GPIO_PIN_0
+#define USART2_RTS_PIN           GPIO_PIN_1
+#define USART2_FC_GPIO           GPIOA
+#define USART2_FC_GPIO_CLK       RCC_AHB_PERIPHEN_GPIOA
+#define USART2_FC_AF             GPIO_AF1
+#define USART2_TX_DMA_IRQn       DMA1_Channel7_IRQn
+#define USART2_RX_DMA_IRQn       DMA1_Channel6_IRQn
 /* USART2_IRQn is already defined in system headers */
 
 /* USART3 Configuration */
@@ -102,11 +126,135 @@ typedef enum
 #define USART3_RX_DMA_FLAG       DMA_FLAG_TC3
 #define USART3_TX_DMA_REMAP      DMA_REMAP_USART3_TX
 #define USART3_RX_DMA_REMAP      DMA_REMAP_USART3_RX
+#define USART3_RX_DMA_HT_FLAG    DMA_FLAG_HT3
+#define USART3_CTS_PIN           GPIO_PIN_13
+#define USART3_RTS_PIN           GPIO_PIN_14
+#define USART3_FC_GPIO           GPIOB
+#define USART3_FC_GPIO_CLK       RCC_AHB_PERIPHEN_GPIOB
+#define USART3_FC_AF             GPIO_AF18
+#define USART3_TX_DMA_IRQn       DMA1_Channel2_IRQn
+#define USART3_RX_DMA_IRQn       DMA1_Channel3_IRQn
 /* USART3_IRQn is already defined in system headers */
+
+/* Number of USART ports handled by this driver (USART1-USART3) */
+#define UART_PORT_COUNT          3
+
+/* Per-port ring sizes, must be powers of two */
+#define UART_BUFFER_SIZE         256
+#define UART_RX_RING_SIZE        UART_BUFFER_SIZE
+#define UART_TX_RING_SIZE        UART_BUFFER_SIZE
+
+/* TX descriptor queue depth per port, must be a power of two */
+#define UART_TX_QUEUE_DEPTH      8
+
+#if ((UART_TX_QUEUE_DEPTH & (UART_TX_QUEUE_DEPTH - 1)) != 0)
+#error "UART_TX_QUEUE_DEPTH must be a power of two"
+#endif
+
+#if ((UART_RX_RING_SIZE & (UART_RX_RING_SIZE - 1)) != 0) || ((UART_TX_RING_SIZE & (UART_TX_RING_SIZE - 1)) != 0)
+#error "UART ring sizes must be powers of two"
+#endif
+
+/* Default line settings used by uart_dma_interrupt_init */
+#define UART_DEFAULT_BAUDRATE    115200
+#define UART_DRAIN_TIMEOUT_US    500000   /* Longest wait for the transmitter in uart_set_baud */
+
+/**
+ * @brief Receiver oversampling selection
+ */
+typedef enum {
+  UART_OVERSAMPLING_16 = 0,   /* Best noise tolerance, baud up to PCLK/16 */
+  UART_OVERSAMPLING_8,        /* Baud up to PCLK/8, needs UART_HAS_OVER8 */
+  UART_OVERSAMPLING_AUTO      /* Pick the mode with the lowest baud error */
+} uart_oversampling_t;
+
+/**
+ * @brief USART line configuration
+ */
+typedef struct {
+  uint32_t baudRate;                  /* Requested baud rate, up to PCLK/8 */
+  uint16_t wordLength;                /* USART_WL_8B / USART_WL_9B */
+  uint16_t stopBits;                  /* USART_STPB_1 / _0_5 / _2 / _1_5 */
+  uint16_t parity;                    /* USART_PE_NO / USART_PE_EVEN / USART_PE_ODD */
+  uint16_t flowControl;               /* USART_HFCTRL_NONE / _RTS / _CTS / _RTS_CTS */
+  uart_oversampling_t oversampling;   /* Receiver oversampling */
+} uart_config_t;
+
+/**
+ * @brief Result of the baud divider solver
+ */
+typedef struct {
+  uint32_t brcf;                      /* Value for the BRCF register */
+  uart_oversampling_t oversampling;   /* UART_OVERSAMPLING_16 or UART_OVERSAMPLING_8 */
+  uint32_t actualBaud;                /* Baud rate produced by brcf */
+  int32_t errorPpm;                   /* (actual - requested) / requested in ppm */
+} uart_baud_t;
+
+/**
+ * @brief Receive notification callBack
+ * @param USARTx - port that received data
+ * @param offset - offset of the new data in the receive ring
+ * @param length - number of new bytes (the extent never wraps, a wrapped
+ *                 extent is reported as two calls)
+ * @note Called from interrupt context (USART IDLE or DMA half/full transfer)
+ */
+typedef void (*uart_rx_callback_t)(USART_Module* USARTx, uint16_t offset, uint16_t length);
+
+/**
+ * @brief Transmit completion callBack, returns ownership of a buffer given to uart_write_async
+ * @param ctx - user context given to uart_write_async
+ * @param data - the buffer that was sent
+ * @param length - number of bytes sent
+ * @note Called from the TX DMA interrupt
+ */
+typedef void (*uart_tx_done_t)(void* ctx, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief One queued DMA transfer
+ */
+typedef struct {
+  const uint8_t* data;    /* Buffer start */
+  uint16_t length;        /* Number of bytes */
+  bool fromRing;          /* Span of the port transmit ring */
+  uart_tx_done_t done;    /* Ownership-return callBack, may be NULL */
+  void* ctx;              /* User context for done */
+} uart_tx_desc_t;
+
 /** DMA with Interrupt Function Declarations **/
 int uart_dma_send_data(USART_Module* USARTx, DMA_ChannelType* txDmaChannel, uint8_t* data, uint16_t size);
 int uart_dma_receive_data(USART_Module* USARTx, DMA_ChannelType* rxDmaChannel, uint8_t* data, uint16_t size);
 int uart_dma_interrupt_init(USART_Module* USARTx);
+int uart_dma_interrupt_init_ex(USART_Module* USARTx, const uart_config_t* config);
+
+/** Line Configuration Function Declarations **/
+void uart_config_default(uart_config_t* config);
+uint32_t uart_get_pclk(USART_Module* USARTx);
+int uart_solve_baud(uint32_t pclk, uint32_t baudRate, uart_oversampling_t oversampling, uart_baud_t* result);
+int uart_set_baud(USART_Module* USARTx, uint32_t baudRate, uart_baud_t* result);
+uint32_t uart_get_baud(USART_Module* USARTx);
+
+/** Circular DMA Receive Function Declarations **/
+int uart_rx_dma_start(USART_Module* USARTx, uart_rx_callback_t callBack);
+void uart_rx_dma_stop(USART_Module* USARTx);
+uint16_t uart_rx_available(USART_Module* USARTx);
+uint16_t uart_rx_read(USART_Module* USARTx, uint8_t* data, uint16_t size);
+const uint8_t* uart_rx_peek(USART_Module* USARTx, uint16_t* length);
+void uart_rx_commit(USART_Module* USARTx, uint16_t length);
+uint32_t uart_rx_overruns(USART_Module* USARTx);
+void uart_rx_dma_irq(USART_Module* USARTx);
+
+/** Transmit Ring Function Declarations **/
+uint16_t uart_write(USART_Module* USARTx, const uint8_t* data, uint16_t size);
+uint8_t* uart_tx_peek(USART_Module* USARTx, uint16_t* length);
+void uart_tx_commit(USART_Module* USARTx, uint16_t length);
+void uart_tx_kick(USART_Module* USARTx);
+uint16_t uart_tx_pending(USART_Module* USARTx);
+
+/** Queued DMA Transmit Function Declarations **/
+int uart_write_async(USART_Module* USARTx, const uint8_t* data, uint16_t size,
+                     uart_tx_done_t done, void* ctx);
+bool uart_tx_busy(USART_Module* USARTx);
+void uart_tx_dma_irq(USART_Module* USARTx);
 
 
 
@@ -0,0 +1,174 @@
+/**
+*\*\file delay_model.c
+*\*\brief Host accuracy model of the cycle counter delays (N32H474/mps_delay.c)
+*
+* Runs the real delay code against a simulated DWT counter in which every
+* counter read costs a few cycles with some jitter, like the polling loop on
+* the target. delay_init calibrates the call overhead the same way, then
+* ns, us and ms delays are measured read to read, as a caller would, for a
+* few core clocks including fractional MHz ones. Every delay must land within
+* one poll period plus the Q16 rate rounding of the ideal length, or at the
+* calibrated minimum for delays shorter than the call itself. Start points
+* near the 32-bit wrap and waits longer than one chunk are covered.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -I../N32H474 delay_model.c ../N32H474/mps_delay.c -o delay_model -lm
+*
+* Usage:
+*   delay_model [delaysPerCase]                  default 4000
+**/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mps_delay.h"
+#include "mps_time.h"
+
+static const uint32_t clocks[] = {240000000u, 250000000u, 170666666u, 133333333u, 64000000u, 8000000u};
+
+/* Simulated core */
+static uint32_t hclk;
+static uint32_t counter;
+static uint32_t pollCycles;               /* Cost of one counter read and loop pass */
+static uint32_t pollJitter;               /* Extra 0..pollJitter cycles per read */
+static uint32_t rng = 1;
+
+static unsigned long failures = 0;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+/* mps_time stand-ins */
+void time_init(void)
+{
+}
+
+uint32_t time_cycles_per_us_q16(void)
+{
+  return (uint32_t)(((uint64_t)hclk << 16) / 1000000);
+}
+
+uint32_t time_cycles32(void)
+{
+  uint32_t now = counter;
+
+  counter += pollCycles + (pollJitter ? next_random() % (pollJitter + 1) : 0);
+  return now;
+}
+
+/* Balance globals declared by mps_delay.h */
+uint16_t balance_Current_GUI;
+uint16_t balance_Current_half;
+
+typedef enum { UNIT_NS, UNIT_US, UNIT_MS } unit_t;
+
+static const char* const unitNames[] = {"ns", "us", "ms"};
+
+/**
+ * @brief Time one delay and check it, return the error in ns
+ */
+static double run_one(unit_t unit, uint32_t amount, uint32_t overhead)
+{
+  double ideal;
+  double us;
+  double slack;
+  uint32_t start;
+  uint32_t elapsed;
+  double error;
+
+  /* Half the runs start just below the counter wrap */
+  counter = (next_random() & 1) ? 0xFFFFFFFFu - next_random() % 1000 : next_random();
+
+  start = time_cycles32();
+  switch (unit) {
+    case UNIT_NS: delay_ns(amount); us = amount / 1e3; break;
+    case UNIT_US: delay_us(amount); us = amount; break;
+    default:      delay_ms(amount); us = amount * 1e3; break;
+  }
+  elapsed = time_cycles32() - start;
+  ideal = us * hclk / 1e6;
+
+  /* One poll pass either way (the calibration includes one exit check) with
+     its jitter in the run and in the calibration, rounding to a whole cycle
+     and the Q16 rate truncated by up to 2^-16 cycles per us */
+  slack = pollCycles + 2 * pollJitter + 1 + us / 65536;
+
+  /* The elapsed count is taken modulo 2^32, long waits are compared the same way */
+  if (ideal >= 4294967296.0) {
+    ideal = fmod(ideal, 4294967296.0);
+  }
+  error = elapsed - ideal;
+  if (ideal < overhead) {
+    /* Shorter than the call itself: lasts the calibrated minimum */
+    error = (elapsed > overhead + slack) ? elapsed - overhead : 0;
+  }
+  if (error < -slack || error > slack) {
+    if (failures < 10) {
+      printf("FAIL %lu Hz, %lu %s: %lu cycles, ideal %.1f\n", (unsigned long)hclk, (unsigned long)amount,
+             unitNames[unit], (unsigned long)elapsed, ideal);
+    }
+    failures++;
+  }
+  return error * 1e9 / hclk;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long delays = 4000;
+  size_t c;
+
+  if (argc > 1) {
+    delays = strtoul(argv[1], NULL, 0);
+  }
+
+  printf("%10s %4s %6s %12s %12s\n", "clock Hz", "unit", "poll", "mean err ns", "worst err ns");
+  for (c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+    unit_t unit;
+
+    hclk = clocks[c];
+    for (unit = UNIT_NS; unit <= UNIT_MS; unit++) {
+      double sum = 0;
+      double worst = 0;
+      unsigned long count = (unit == UNIT_MS) ? 20 : delays;
+      unsigned long i;
+      uint32_t overhead;
+      uint32_t start;
+
+      /* Tight loop for short delays, long waits as if interrupts preempt the loop */
+      pollCycles = (unit == UNIT_MS) ? 256 : 6;
+      pollJitter = (unit == UNIT_MS) ? 64 : 2;
+
+      delay_init();
+      start = time_cycles32();
+      delay_cycles(0);
+      overhead = time_cycles32() - start;
+
+      for (i = 0; i < count; i++) {
+        uint32_t amount;
+        double error;
+
+        switch (unit) {
+          case UNIT_NS: amount = (i & 1) ? next_random() % 200 : next_random() % 100000; break;
+          case UNIT_US: amount = (i & 1) ? next_random() % 20 : next_random() % 5000; break;
+          default:      amount = (i < 2) ? 30000 : next_random() % 2000; break;
+        }
+        error = run_one(unit, amount, overhead);
+        sum += fabs(error);
+        if (fabs(error) > fabs(worst)) {
+          worst = error;
+        }
+      }
+      printf("%10lu %4s %6lu %12.2f %12.2f\n", (unsigned long)hclk, unitNames[unit],
+             (unsigned long)pollCycles, sum / count, worst);
+    }
+  }
+
+  printf("%s\n", failures == 0 ? "pass" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
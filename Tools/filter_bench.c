@@ -0,0 +1,255 @@
+/**
+*\*\file filter_bench.c
+*\*\brief Host check and benchmark of the streaming ADC filters (N32H474/mps_filter.c)
+*
+* Checks first, then times:
+* - boxcar against the exact average for every ratio up to 4096 and a spread
+*   up to 65535,
+*   with 12-bit and full 16-bit inputs and random block splits; the output
+*   must be within 1/2 LSB and full scale must map to full scale
+* - CIC DC gain for every order and ratio allowed, up to one 65535 block
+* - IIR settling to a full-scale step
+* - median rejection of single-sample spikes
+* Then every filter runs over blocks of 16 to 1024 samples and the time per
+* sample is printed, in ns and in cycles at the given host clock. Host figures
+* only rank the filters and block sizes; the M4 cost differs.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -I../N32H474 filter_bench.c ../N32H474/mps_filter.c -o filter_bench
+*
+* Usage:
+*   filter_bench [hostMHz]                       default 3000
+**/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mps_filter.h"
+
+#define BENCH_SAMPLES   (1u << 22)   /* Samples per timed run */
+
+static uint16_t block[65536];
+static uint16_t source[65536];
+static unsigned long failures = 0;
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void fail(const char* what, unsigned long a, unsigned long b, unsigned long c)
+{
+  if (failures < 10) {
+    printf("FAIL %s: %lu %lu %lu\n", what, a, b, c);
+  }
+  failures++;
+}
+
+/* Boxcar against the exact mean, 'ratio' inputs fed in random block sizes */
+static void check_boxcar(uint16_t ratio, uint16_t mask, uint16_t offset)
+{
+  filter_boxcar_t filter;
+  uint64_t sum = 0;
+  uint32_t fed = 0;
+  uint16_t outputs = 0;
+  uint32_t i;
+
+  filter_boxcar_init(&filter, ratio);
+  for (i = 0; i < ratio; i++) {
+    source[i] = (uint16_t)(offset + (next_random() & mask));
+    sum += source[i];
+  }
+  while (fed < ratio) {
+    uint32_t chunk = 1 + next_random() % 300;
+
+    if (chunk > ratio - fed) {
+      chunk = ratio - fed;
+    }
+    memcpy(block, &source[fed], chunk * sizeof(block[0]));
+    outputs += filter_boxcar_process(&filter, block, (uint16_t)chunk, 1);
+    fed += chunk;
+  }
+  /* The last block wrote the output to its start, |out - sum / ratio| <= 1/2 */
+  if (outputs != 1 || (uint64_t)llabs((int64_t)block[0] * 2 * ratio - (int64_t)(2 * sum)) > ratio) {
+    fail("boxcar ratio, output, sum", ratio, block[0], (unsigned long)sum);
+  }
+}
+
+static void check_filters(void)
+{
+  uint32_t ratio;
+  uint8_t order;
+  uint16_t i;
+
+  /* Every ratio up to 4096, then a spread up to the largest */
+  for (ratio = 1; ratio <= 65535; ratio += (ratio < 4096) ? 1 : (ratio > 65535 - 61) ? 65535 - ratio : 61) {
+    filter_boxcar_t filter;
+
+    check_boxcar((uint16_t)ratio, 0x0FFF, 0);
+    check_boxcar((uint16_t)ratio, 0x00FF, 0xFF00);
+
+    /* Full scale in, full scale out */
+    filter_boxcar_init(&filter, (uint16_t)ratio);
+    for (i = 0; i < ratio; i++) {
+      block[i] = 4095;
+    }
+    filter_boxcar_process(&filter, block, (uint16_t)ratio, 1);
+    if (block[0] != 4095) {
+      fail("boxcar full scale ratio, output", ratio, block[0], 0);
+    }
+    if (ratio == 65535) {
+      break;
+    }
+  }
+
+  for (order = 1; order <= FILTER_CIC_MAX_ORDER; order++) {
+    for (ratio = 2; ratio <= 32768; ratio <<= 1) {
+      filter_cic_t cic;
+      uint16_t outputs;
+
+      if (!filter_cic_init(&cic, order, (uint16_t)ratio) || (order + 1) * ratio > 65535) {
+        continue;
+      }
+      /* Settles after 'order' outputs, then DC passes unchanged */
+      for (i = 0; i < (order + 1) * ratio; i++) {
+        block[i] = 3000;
+      }
+      outputs = filter_cic_process(&cic, block, (uint16_t)((order + 1) * ratio), 1);
+      if (outputs != order + 1 || block[order] != 3000) {
+        fail("cic order, ratio, output", order, ratio, block[order]);
+      }
+    }
+  }
+
+  {
+    filter_iir_t iir;
+
+    filter_iir_init(&iir, 1024);
+    block[0] = 0;
+    filter_iir_process(&iir, block, 1, 1);
+    for (i = 0; i < 4096; i++) {
+      block[i] = 4095;
+    }
+    filter_iir_process(&iir, block, 4096, 1);
+    if (block[4095] != 4095 || block[0] == 4095) {
+      fail("iir step first, last", block[0], block[4095], 0);
+    }
+  }
+
+  {
+    filter_median_t median;
+
+    filter_median_init(&median, 5);
+    for (i = 0; i < 1000; i++) {
+      block[i] = (i % 7 == 3) ? 4095 : 2000;
+    }
+    filter_median_process(&median, block, 1000, 1);
+    for (i = 5; i < 1000; i++) {
+      if (block[i] != 2000) {
+        fail("median index, output", i, block[i], 0);
+        break;
+      }
+    }
+  }
+}
+
+/* ADC-like input, re-copied before each block so decimators see fresh data */
+static void load(uint16_t count)
+{
+  memcpy(block, source, count * sizeof(block[0]));
+}
+
+typedef enum { BENCH_BOXCAR_POW2, BENCH_BOXCAR, BENCH_CIC, BENCH_IIR, BENCH_MEDIAN, BENCH_COUNT } bench_t;
+
+static const char* const benchNames[BENCH_COUNT] = {
+  "boxcar /16", "boxcar /10", "cic 4 /16", "iir", "median 9"
+};
+
+static double bench(bench_t which, uint16_t blockSize)
+{
+  filter_boxcar_t boxcar;
+  filter_cic_t cic;
+  filter_iir_t iir;
+  filter_median_t median;
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t done;
+  double copyNs = 0;
+  double ns;
+  int pass;
+
+  filter_boxcar_init(&boxcar, (which == BENCH_BOXCAR) ? 10 : 16);
+  filter_cic_init(&cic, 4, 16);
+  filter_iir_init(&iir, 2048);
+  filter_median_init(&median, 9);
+
+  /* Pass 0 times the block copy alone, pass 1 copy and filter */
+  for (pass = 0; pass < 2; pass++) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (done = 0; done < BENCH_SAMPLES; done += blockSize) {
+      load(blockSize);
+      if (pass == 0) {
+        __asm__ volatile("" ::: "memory");
+        continue;
+      }
+      switch (which) {
+        case BENCH_BOXCAR_POW2:
+        case BENCH_BOXCAR: filter_boxcar_process(&boxcar, block, blockSize, 1); break;
+        case BENCH_CIC:    filter_cic_process(&cic, block, blockSize, 1); break;
+        case BENCH_IIR:    filter_iir_process(&iir, block, blockSize, 1); break;
+        default:           filter_median_process(&median, block, blockSize, 1); break;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    if (pass == 0) {
+      copyNs = ns;
+    }
+  }
+  ns -= copyNs;
+  return (ns > 0 ? ns : 0) / BENCH_SAMPLES;
+}
+
+int main(int argc, char** argv)
+{
+  static const uint16_t sizes[] = {16, 64, 256, 1024};
+  double hostMhz = 3000;
+  uint32_t i;
+  int which;
+  size_t s;
+
+  if (argc > 1) {
+    hostMhz = strtod(argv[1], NULL);
+  }
+
+  check_filters();
+  printf("checks: %s\n", failures == 0 ? "pass" : "FAIL");
+
+  for (i = 0; i < 1024; i++) {
+    source[i] = (uint16_t)(2048 + (next_random() % 512) - 256);
+  }
+  printf("%-12s", "ns/cycles");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    printf(" %9u", sizes[s]);
+  }
+  printf("   (per sample, block size; cycles at %.0f MHz)\n", hostMhz);
+  for (which = 0; which < BENCH_COUNT; which++) {
+    printf("%-12s", benchNames[which]);
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      double ns = bench((bench_t)which, sizes[s]);
+
+      printf(" %4.1f/%4.1f", ns, ns * hostMhz / 1000);
+    }
+    printf("\n");
+  }
+
+  printf("%s\n", failures == 0 ? "pass" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+/**
+*\*\file log_expand.c
+*\*\brief Re-expand deferred binary log records from the telemetry stream
+*
+* The firmware logs with MPS_LOG (N32H474/mps_log.h): only the offset of the
+* format string in the mps_log_fmt section, a DWT cycle timestamp and the raw
+* arguments are sent, inside TELEM_TYPE_LOG telemetry frames. This tool takes
+* the format strings from the firmware ELF (or from a raw dump of the section)
+* and prints the formatted messages.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -DMPS_CRC_HOST -I. -I../N32H474 log_expand.c mps_crc.c -o log_expand
+*
+* Usage:
+*   log_expand -e firmware.elf [-m cpuMHz] [capture.bin]     read a capture or stdin
+*   log_expand -t log_fmt.bin ...                           section dump made at build time with
+*                                                           objcopy -O binary -j mps_log_fmt firmware.elf log_fmt.bin
+*   telem_decode -d /dev/ttyUSB0 -b 921600 -w /dev/stdout -i 0 | log_expand -e firmware.elf
+**/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mps_crc.h"
+#include "mps_telemetry_proto.h"
+
+#define LOG_SECTION_NAME    "mps_log_fmt"
+
+static uint8_t* fmtTable = NULL;
+static uint32_t fmtTableSize = 0;
+
+static uint16_t rd_u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd_u32(const uint8_t* p) { return (uint32_t)rd_u16(p) | ((uint32_t)rd_u16(p + 2) << 16); }
+
+static uint8_t* read_file(const char* path, uint32_t* size)
+{
+  FILE* f = fopen(path, "rb");
+  uint8_t* data;
+  long length;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  length = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = (uint8_t*)malloc(length > 0 ? (size_t)length : 1);
+  if (data == NULL || fread(data, 1, (size_t)length, f) != (size_t)length)
+  {
+    fprintf(stderr, "%s: read failed\n", path);
+    fclose(f);
+    free(data);
+    return NULL;
+  }
+  fclose(f);
+  *size = (uint32_t)length;
+  return data;
+}
+
+/**
+ * @brief Load the format section from a 32-bit little-endian ELF file
+ */
+static int load_elf(const char* path)
+{
+  uint32_t size;
+  uint8_t* elf = read_file(path, &size);
+  uint32_t shoff;
+  uint16_t shentsize;
+  uint16_t shnum;
+  uint16_t shstrndx;
+  const uint8_t* strtab;
+  uint16_t i;
+
+  if (elf == NULL)
+  {
+    return 0;
+  }
+  if (size < 52 || memcmp(elf, "\177ELF", 4) != 0 || elf[4] != 1 || elf[5] != 1)
+  {
+    fprintf(stderr, "%s: not a 32-bit little-endian ELF file\n", path);
+    free(elf);
+    return 0;
+  }
+  shoff = rd_u32(elf + 32);
+  shentsize = rd_u16(elf + 46);
+  shnum = rd_u16(elf + 48);
+  shstrndx = rd_u16(elf + 50);
+  if (shoff + (uint32_t)shnum * shentsize > size || shstrndx >= shnum)
+  {
+    fprintf(stderr, "%s: bad section table\n", path);
+    free(elf);
+    return 0;
+  }
+  strtab = elf + rd_u32(elf + shoff + shstrndx * shentsize + 16);
+
+  for (i = 0; i < shnum; i++)
+  {
+    const uint8_t* sh = elf + shoff + i * shentsize;
+    if (strcmp((const char*)strtab + rd_u32(sh), LOG_SECTION_NAME) == 0)
+    {
+      uint32_t offset = rd_u32(sh + 16);
+      fmtTableSize = rd_u32(sh + 20);
+      if (offset + fmtTableSize > size)
+      {
+        break;
+      }
+      fmtTable = (uint8_t*)malloc(fmtTableSize + 1);
+      memcpy(fmtTable, elf + offset, fmtTableSize);
+      fmtTable[fmtTableSize] = 0;
+      free(elf);
+      return 1;
+    }
+  }
+  fprintf(stderr, "%s: no valid %s section\n", path, LOG_SECTION_NAME);
+  free(elf);
+  return 0;
+}
+
+/**
+ * @brief Print one record, consuming one argument per conversion
+ */
+static void expand(uint16_t id, const uint32_t* args, uint8_t count)
+{
+  const char* p;
+  uint8_t used = 0;
+
+  if (fmtTable == NULL || id >= fmtTableSize)
+  {
+    printf("<unknown format id %u>", id);
+    for (used = 0; used < count; used++)
+    {
+      printf(" 0x%08x", args[used]);
+    }
+    return;
+  }
+
+  for (p = (const char*)fmtTable + id; *p != 0; p++)
+  {
+    char spec[32];
+    size_t n = 0;
+    uint32_t arg;
+
+    if (*p != '%')
+    {
+      putchar(*p);
+      continue;
+    }
+    if (p[1] == '%')
+    {
+      putchar('%');
+      p++;
+      continue;
+    }
+
+    /* Copy flags, width and precision, drop length modifiers (all arguments are 32-bit) */
+    spec[n++] = *p++;
+    while (*p != 0 && strchr("-+ #0123456789.", *p) != NULL && n < sizeof(spec) - 3)
+    {
+      spec[n++] = *p++;
+    }
+    while (*p != 0 && strchr("hlLqjzt", *p) != NULL)
+    {
+      p++;
+    }
+    if (*p == 0)
+    {
+      break;
+    }
+    arg = (used < count) ? args[used] : 0;
+    used++;
+
+    switch (*p)
+    {
+      case 'd': case 'i':
+        spec[n++] = 'd'; spec[n] = 0;
+        printf(spec, (int32_t)arg);
+        break;
+      case 'u': case 'x': case 'X': case 'o': case 'c':
+        spec[n++] = *p; spec[n] = 0;
+        printf(spec, arg);
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      {
+        union { uint32_t u; float f; } bits;
+        bits.u = arg;
+        spec[n++] = *p; spec[n] = 0;
+        printf(spec, (double)bits.f);
+        break;
+      }
+      case 'p':
+        printf("0x%08x", arg);
+        break;
+      case 's':
+        printf("<str@0x%08x>", arg);
+        break;
+      default:
+        printf("<bad %%%c>", *p);
+        break;
+    }
+  }
+}
+
+/**
+ * @brief Decode one COBS block and print its log records
+ */
+static void handle_block(const uint8_t* block, uint32_t length, double cyclesPerUs,
+                         uint64_t* cycleBase, uint32_t* lastCycles, uint64_t* crcErrors)
+{
+  uint8_t frame[TELEM_MAX_FRAME];
+  uint32_t args[256];
+  uint16_t crc;
+  int n;
+  int pos;
+
+  if (length == 0 || length > TELEM_MAX_FRAME || (n = telem_cobs_decode(block, length, frame)) < TELEM_HEADER_SIZE + TELEM_CRC_SIZE)
+  {
+    return;
+  }
+  crc = Calculate_CRC16(((uint16_t)frame[1] << 8) | frame[0], (uint8_t)(n - 2 - TELEM_CRC_SIZE), &frame[2]);
+  if (crc != rd_u16(&frame[n - TELEM_CRC_SIZE]))
+  {
+    (*crcErrors)++;
+    return;
+  }
+  if (frame[0] != TELEM_TYPE_LOG)
+  {
+    return;
+  }
+
+  for (pos = TELEM_HEADER_SIZE; pos + 8 <= n - TELEM_CRC_SIZE; )
+  {
+    uint16_t id = rd_u16(&frame[pos]);
+    uint8_t count = frame[pos + 2];
+    uint32_t cycles = rd_u32(&frame[pos + 4]);
+    uint8_t i;
+
+    pos += 8;
+    if (pos + 4 * count > n - TELEM_CRC_SIZE)
+    {
+      break;
+    }
+    for (i = 0; i < count; i++, pos += 4)
+    {
+      args[i] = rd_u32(&frame[pos]);
+    }
+
+    /* Extend the 32-bit cycle counter, records arrive in order */
+    if (cycles < *lastCycles)
+    {
+      *cycleBase += 1ULL << 32;
+    }
+    *lastCycles = cycles;
+
+    printf("[%14.6f] ", (double)(*cycleBase + cycles) / cyclesPerUs / 1e6);
+    expand(id, args, count);
+    putchar('\n');
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* input = NULL;
+  double cpuMHz = 240.0;
+  FILE* in = stdin;
+  uint8_t block[TELEM_MAX_FRAME + 1];
+  uint32_t blockLength = 0;
+  uint64_t cycleBase = 0;
+  uint32_t lastCycles = 0;
+  uint64_t crcErrors = 0;
+  int c;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+    {
+      if (!load_elf(argv[++i])) return 1;
+    }
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+    {
+      if ((fmtTable = read_file(argv[++i], &fmtTableSize)) == NULL) return 1;
+    }
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+    {
+      cpuMHz = atof(argv[++i]);
+    }
+    else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)
+    {
+      input = argv[i];
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s (-e firmware.elf | -t log_fmt.bin) [-m cpuMHz] [capture.bin | -]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (fmtTable == NULL)
+  {
+    fprintf(stderr, "no format table, use -e or -t\n");
+    return 2;
+  }
+  if (input != NULL && strcmp(input, "-") != 0 && (in = fopen(input, "rb")) == NULL)
+  {
+    perror(input);
+    return 1;
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  while ((c = fgetc(in)) != EOF)
+  {
+    if (c == TELEM_DELIMITER)
+    {
+      if (blockLength <= TELEM_MAX_FRAME)
+      {
+        handle_block(block, blockLength, cpuMHz, &cycleBase, &lastCycles, &crcErrors);
+      }
+      blockLength = 0;
+    }
+    else if (blockLength < sizeof(block))
+    {
+      block[blockLength++] = (uint8_t)c;
+    }
+  }
+
+  if (crcErrors != 0)
+  {
+    fprintf(stderr, "%llu frames with CRC errors skipped\n", (unsigned long long)crcErrors);
+  }
+  return 0;
+}
@@ -0,0 +1,275 @@
+/**
+*\*\file mpf4279x_decode_test.c
+*\*\brief Host test of the zero-copy MPF4279x frame decoders
+*
+* Decodes reference Meas_REG and def_fg_out frames (16 series cells) with the
+* accessors in N32H474/mpf4279x_decode.h, from an aligned and from an odd
+* address, and checks every field against the known values and against the
+* packed structures. Build and run once per register layout.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -DSETMAX_NCELLS_SER=16 -I../N32H474 mpf4279x_decode_test.c -o mpf4279x_decode_test
+*   gcc -O2 -Wall -DSETMAX_NCELLS_SER=16 -DFG_NewGen -I../N32H474 mpf4279x_decode_test.c -o mpf4279x_decode_test_ng
+*
+* Usage:
+*   mpf4279x_decode_test                         exit status 0 when every check passes
+**/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "mpf4279x_decode.h"
+
+#if SETMAX_NCELLS_SER != 16
+#error "The reference frames are for a 16 cell pack"
+#endif
+
+#ifdef FG_NewGen
+/* Meas_REG of a discharging pack, new generation layout */
+static const uint8_t measFrame[MEAS_REG_SIZE] = {
+  0xE5, 0x0C, 0xEC, 0x0C, 0xF3, 0x0C, 0xFA, 0x0C, 0x01, 0x0D, 0x08, 0x0D, 0x0F, 0x0D, 0x16, 0x0D,
+  0x1D, 0x0D, 0x24, 0x0D, 0x2B, 0x0D, 0x32, 0x0D, 0x39, 0x0D, 0x40, 0x0D, 0x47, 0x0D, 0x4E, 0x0D,
+  0x98, 0xD1, 0x10, 0xFA, 0xFF, 0xFF, 0x11, 0xFA, 0xFF, 0xFF, 0x12, 0xFA, 0xFF, 0xFF, 0x13, 0xFA,
+  0xFF, 0xFF, 0x14, 0xFA, 0xFF, 0xFF, 0x15, 0xFA, 0xFF, 0xFF, 0x16, 0xFA, 0xFF, 0xFF, 0x17, 0xFA,
+  0xFF, 0xFF, 0x18, 0xFA, 0xFF, 0xFF, 0x19, 0xFA, 0xFF, 0xFF, 0x1A, 0xFA, 0xFF, 0xFF, 0x1B, 0xFA,
+  0xFF, 0xFF, 0x1C, 0xFA, 0xFF, 0xFF, 0x1D, 0xFA, 0xFF, 0xFF, 0x1E, 0xFA, 0xFF, 0xFF, 0x1F, 0xFA,
+  0xFF, 0xFF, 0x10, 0xFA, 0xFF, 0xFF, 0x26, 0xFA, 0xFF, 0xFF, 0xFB, 0x00, 0xFD, 0x00, 0xF9, 0x00,
+  0xD3, 0xFF, 0x2C, 0x01, 0x9C, 0x01, 0x05, 0x01, 0x01, 0x00, 0x02, 0x02,
+};
+#define EXPECT_RST  0x020001u
+#define EXPECT_SHW  0x02u
+
+/* def_fg_out of the same pack, new generation layout */
+static const uint8_t fgFrame[FG_OUT_SIZE] = {
+  0xC5, 0xA0, 0x02, 0x01, 0x3C, 0x3D, 0x3E, 0x3F, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+  0x48, 0x49, 0x4A, 0x4B, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33,
+  0x34, 0x35, 0x36, 0x37, 0x07, 0x18, 0x15, 0xDD, 0xFF, 0x01, 0x5A, 0x59, 0x58, 0x57, 0x56, 0x55,
+  0x54, 0x53, 0x52, 0x51, 0x50, 0x4F, 0x4E, 0x4D, 0x4C, 0x4B, 0x03, 0x32, 0xEF, 0x80, 0xBB, 0x88,
+  0xFF, 0xC0, 0xFF, 0x03, 0x70, 0x19, 0x78, 0x00, 0xDC, 0x05, 0x02, 0x01, 0x2C, 0x01, 0x01, 0x00,
+  0xD0, 0x07, 0x02, 0x02, 0x64, 0x00, 0x00, 0x03, 0x42, 0x0E, 0x02, 0x01, 0x00, 0x00, 0x40, 0x3C,
+  0x00, 0x00, 0x50, 0x3C, 0x00, 0x00, 0x60, 0x3C, 0x00, 0x00, 0x70, 0x3C, 0x00, 0x00, 0x80, 0x3C,
+  0x00, 0x00, 0x88, 0x3C, 0x00, 0x00, 0x90, 0x3C, 0x00, 0x00, 0x98, 0x3C, 0x00, 0x00, 0xA0, 0x3C,
+  0x00, 0x00, 0xA8, 0x3C, 0x00, 0x00, 0xB0, 0x3C, 0x00, 0x00, 0xB8, 0x3C, 0x00, 0x00, 0xC0, 0x3C,
+  0x00, 0x00, 0xC8, 0x3C, 0x00, 0x00, 0xD0, 0x3C, 0x00, 0x00, 0xD8, 0x3C, 0x00, 0x00, 0xA0, 0xBC,
+  0x00, 0x00, 0xA8, 0xBC, 0x00, 0x00, 0xB0, 0xBC, 0x00, 0x00, 0xB8, 0xBC, 0x00, 0x00, 0xC0, 0xBC,
+  0x00, 0x00, 0xC8, 0xBC, 0x00, 0x00, 0xD0, 0xBC, 0x00, 0x00, 0xD8, 0xBC, 0x00, 0x00, 0xE0, 0xBC,
+  0x00, 0x00, 0xE8, 0xBC, 0x00, 0x00, 0xF0, 0xBC, 0x00, 0x00, 0xF8, 0xBC, 0x00, 0x00, 0x00, 0xBD,
+  0x00, 0x00, 0x04, 0xBD, 0x00, 0x00, 0x08, 0xBD, 0x00, 0x00, 0x0C, 0xBD, 0x00, 0x01, 0x02, 0x00,
+  0x01, 0x02, 0x00, 0x01, 0x02, 0x00, 0x01, 0x02, 0x00, 0x01, 0x02, 0x00, 0x00, 0x01, 0x02, 0x03,
+  0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0xFA, 0x00, 0xFD, 0x00,
+  0x00, 0x01, 0x03, 0x01, 0x06, 0x01, 0x09, 0x01, 0x0C, 0x01, 0x0F, 0x01, 0x12, 0x01, 0x15, 0x01,
+  0x18, 0x01, 0x1B, 0x01, 0x1E, 0x01, 0x21, 0x01, 0x24, 0x01, 0x27, 0x01, 0x01, 0x02, 0x00, 0x01,
+  0x02, 0x00, 0x01, 0x02, 0x00, 0x01, 0x02, 0x00, 0x01, 0x02, 0x00, 0x01, 0x01, 0x02, 0x03, 0x00,
+  0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0x00, 0xD2, 0x04, 0x02, 0x01,
+  0x01, 0xEE, 0xFF, 0xC0, 0x5A, 0x5A, 0x00, 0x01, 0x5B, 0x5A, 0x00, 0x02, 0x5C, 0x5A, 0x00, 0x03,
+  0x5D, 0x5A, 0x00, 0x04, 0x5E, 0x5A, 0x00, 0x05, 0x5F, 0x5A, 0x00, 0x06, 0x60, 0x5A, 0x00, 0x07,
+  0x61, 0x5A, 0x00, 0x08, 0x62, 0x5A, 0x00, 0x09, 0x63, 0x5A, 0x00, 0x0A, 0x64, 0x5A, 0x00, 0x0B,
+  0x65, 0x5A, 0x00, 0x0C, 0x66, 0x5A, 0x00, 0x0D, 0x67, 0x5A, 0x00, 0x0E, 0x68, 0x5A, 0x00, 0x0F,
+  0x69, 0x5A, 0x00, 0x10, 0x80, 0xBB, 0x00, 0x00, 0x00, 0x5E, 0xD0, 0xB2, 0x05, 0x01, 0xD0, 0x12,
+  0x13, 0x00, 0x09, 0x02, 0x0B, 0x05, 0xDD, 0xCC, 0xBB, 0xAA,
+};
+#define EXPECT_FULL_LIM  Smrtchgr
+#define EXPECT_PCHG_LIM  Chgr
+#else
+/* Meas_REG of a discharging pack */
+static const uint8_t measFrame[MEAS_REG_SIZE] = {
+  0xE5, 0x0C, 0xEC, 0x0C, 0xF3, 0x0C, 0xFA, 0x0C, 0x01, 0x0D, 0x08, 0x0D, 0x0F, 0x0D, 0x16, 0x0D,
+  0x1D, 0x0D, 0x24, 0x0D, 0x2B, 0x0D, 0x32, 0x0D, 0x39, 0x0D, 0x40, 0x0D, 0x47, 0x0D, 0x4E, 0x0D,
+  0x98, 0xD1, 0x10, 0xFA, 0xFF, 0xFF, 0x11, 0xFA, 0xFF, 0xFF, 0x12, 0xFA, 0xFF, 0xFF, 0x13, 0xFA,
+  0xFF, 0xFF, 0x14, 0xFA, 0xFF, 0xFF, 0x15, 0xFA, 0xFF, 0xFF, 0x16, 0xFA, 0xFF, 0xFF, 0x17, 0xFA,
+  0xFF, 0xFF, 0x18, 0xFA, 0xFF, 0xFF, 0x19, 0xFA, 0xFF, 0xFF, 0x1A, 0xFA, 0xFF, 0xFF, 0x1B, 0xFA,
+  0xFF, 0xFF, 0x1C, 0xFA, 0xFF, 0xFF, 0x1D, 0xFA, 0xFF, 0xFF, 0x1E, 0xFA, 0xFF, 0xFF, 0x1F, 0xFA,
+  0xFF, 0xFF, 0x10, 0xFA, 0xFF, 0xFF, 0x26, 0xFA, 0xFF, 0xFF, 0xFD, 0x00, 0xF9, 0x00, 0xD3, 0xFF,
+  0x2C, 0x01, 0x9C, 0x01, 0x05, 0x01, 0x01, 0x80, 0x09,
+};
+#define EXPECT_RST  0x8001u
+#define EXPECT_SHW  0x09u
+
+/* def_fg_out of the same pack */
+static const uint8_t fgFrame[FG_OUT_SIZE] = {
+  0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+  0x07, 0x18, 0x15, 0x01, 0x5A, 0x59, 0x58, 0x57, 0x56, 0x55, 0x54, 0x53, 0x52, 0x51, 0x50, 0x4F,
+  0x4E, 0x4D, 0x4C, 0x4B, 0x03, 0x32, 0xEF, 0x00, 0xDC, 0x05, 0x2C, 0x01, 0xD0, 0x07, 0x64, 0x00,
+  0x42, 0x0E, 0x78, 0x00, 0x70, 0x19, 0x3C, 0x3D, 0x3E, 0x3F, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45,
+  0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x01, 0xEE, 0xFF, 0xC0, 0x5A, 0x5A, 0x00, 0x01, 0x5B, 0x5A,
+  0x00, 0x02, 0x5C, 0x5A, 0x00, 0x03, 0x5D, 0x5A, 0x00, 0x04, 0x5E, 0x5A, 0x00, 0x05, 0x5F, 0x5A,
+  0x00, 0x06, 0x60, 0x5A, 0x00, 0x07, 0x61, 0x5A, 0x00, 0x08, 0x62, 0x5A, 0x00, 0x09, 0x63, 0x5A,
+  0x00, 0x0A, 0x64, 0x5A, 0x00, 0x0B, 0x65, 0x5A, 0x00, 0x0C, 0x66, 0x5A, 0x00, 0x0D, 0x67, 0x5A,
+  0x00, 0x0E, 0x68, 0x5A, 0x00, 0x0F, 0x69, 0x5A, 0x00, 0x10, 0x80, 0xBB, 0x00, 0x00, 0x00, 0x5E,
+  0xD0, 0xB2, 0x05, 0x01, 0xD0, 0x12, 0x13, 0x00, 0x09, 0x00, 0x01, 0xDD, 0xCC, 0xBB, 0xAA,
+};
+#define EXPECT_FULL_LIM  Cell
+#define EXPECT_PCHG_LIM  Cell
+#endif
+
+static const int16_t expectTemp[4] = {253, 249, -45, 300};
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+/**
+ * @brief Check every Meas_REG accessor on one copy of the frame
+ */
+static void check_meas_frame(const uint8_t* buf)
+{
+  Meas_REG meas;
+  uint8_t i;
+
+  memcpy(&meas, buf, sizeof(meas));
+
+  for (i = 0; i < SETMAX_NCELLS_SER; i++) {
+    CHECK(mpf4279x_meas_cell(buf, i) == 3301 + 7 * i);
+    CHECK(mpf4279x_meas_cell(buf, i) == meas.Cells[i]);
+    CHECK(mpf4279x_meas_current(buf, i) == -1520 + i);
+    CHECK(mpf4279x_meas_current(buf, i) == meas.Current[i]);
+  }
+  CHECK(mpf4279x_meas_vpack(buf) == 53656);
+  CHECK(mpf4279x_meas_vpack(buf) == meas.VPack);
+  CHECK(mpf4279x_meas_pack_current(buf) == -1520);
+  CHECK(mpf4279x_meas_pack_current(buf) == meas.PackCurrent);
+  CHECK(mpf4279x_meas_i_cc(buf) == -1498);
+  CHECK(mpf4279x_meas_i_cc(buf) == meas.I_CC);
+  for (i = 0; i < 4; i++) {
+    CHECK(mpf4279x_meas_temp(buf, i) == expectTemp[i]);
+    CHECK(mpf4279x_meas_temp(buf, i) == meas.TempVect[i]);
+  }
+  CHECK(mpf4279x_meas_tchip(buf) == 412);
+  CHECK(mpf4279x_meas_tchip(buf) == meas.TChip);
+  CHECK(mpf4279x_meas_cells_balancing(buf) == 0x0105);
+  CHECK(mpf4279x_meas_cells_balancing(buf) == meas.CellsBalancing);
+  CHECK(mpf4279x_meas_rst(buf) == EXPECT_RST);
+  CHECK(mpf4279x_meas_shw(buf) == EXPECT_SHW);
+  CHECK(meas.shw.pchg == (EXPECT_SHW & 1u));
+  CHECK(meas.shw.pdis == ((EXPECT_SHW >> 1) & 1u));
+#ifdef FG_NewGen
+  CHECK(mpf4279x_meas_tamb(buf) == 251);
+  CHECK(mpf4279x_meas_tamb(buf) == meas.Tamb);
+#endif
+}
+
+#ifdef FG_NewGen
+/**
+ * @brief Check one learning block: value, state and result
+ */
+static void check_learning(const uint8_t* buf, uint32_t blockOff, uint16_t value,
+                           def_fg_lrn state, def_fg_rslt result)
+{
+  def_fg_lrn gotState = Disabled;
+  def_fg_rslt gotResult = Default;
+
+  CHECK(mpf4279x_fg_learning(buf, blockOff, NULL, NULL) == value);
+  CHECK(mpf4279x_fg_learning(buf, blockOff, &gotState, &gotResult) == value);
+  CHECK(gotState == state);
+  CHECK(gotResult == result);
+}
+#endif
+
+/**
+ * @brief Check every def_fg_out accessor on one copy of the frame
+ */
+static void check_fg_frame(const uint8_t* buf)
+{
+  def_fg_out fg;
+  uint8_t i;
+
+  memcpy(&fg, buf, sizeof(fg));
+
+  CHECK(mpf4279x_fg_status(buf) == DISCHARGE);
+  CHECK(mpf4279x_fg_status(buf) == (def_fg_status)fg.status);
+  for (i = 0; i < SETMAX_NCELLS_SER; i++) {
+    CHECK(mpf4279x_fg_soc_cell(buf, i) == 60 + i);
+    CHECK(mpf4279x_fg_soc_cell(buf, i) == fg.soc_abs_cells[i]);
+    CHECK(mpf4279x_fg_soh_cell(buf, i) == 0x01000000u * (i + 1) + 0x5A5Au + i);
+    CHECK(mpf4279x_fg_soh_cell(buf, i) == fg.soh_cells[i]);
+    CHECK(fg.emty_soc_cells[i] == 40 + i);
+    CHECK(fg.full_soc_cells[i] == 90 - i);
+  }
+  CHECK(mpf4279x_fg_soc_pack(buf) == 6512);
+  CHECK(mpf4279x_fg_soc_pack(buf) == fg.soc_pack);
+  CHECK(mpf4279x_fg_soc_pack_unavbl(buf) == 120);
+  CHECK(mpf4279x_fg_soc_pack_unavbl(buf) == fg.soc_pack_unavbl);
+  CHECK(mpf4279x_fg_emty_rtime(buf) == 5400);
+  CHECK(mpf4279x_fg_emty_rtime(buf) == fg.emty_rtime);
+  CHECK(mpf4279x_fg_emty_lim(buf) == Pack);
+  CHECK(mpf4279x_fg_emty_lim(buf) == (def_fg_lim)fg.emty_lim);
+  CHECK(mpf4279x_fg_full_rtime(buf) == 61234);
+  CHECK(mpf4279x_fg_full_rtime(buf) == fg.full_rtime);
+  CHECK(mpf4279x_fg_full_lim(buf) == EXPECT_FULL_LIM);
+  CHECK(mpf4279x_fg_full_lim(buf) == (def_fg_lim)fg.full_lim);
+  CHECK(mpf4279x_fg_soh_pack(buf) == 0xC0FFEE01u);
+  CHECK(mpf4279x_fg_soh_pack(buf) == fg.soh_pack);
+  CHECK(mpf4279x_fg_prdg(buf) == 48000u);
+  CHECK(mpf4279x_fg_prdg(buf) == fg.prdg);
+  CHECK(mpf4279x_fg_pdis(buf) == 3000000000u);
+  CHECK(mpf4279x_fg_pdis(buf) == fg.pdis);
+  CHECK(mpf4279x_fg_pchg(buf) == 1250000u);
+  CHECK(mpf4279x_fg_pchg(buf) == fg.pchg);
+  CHECK(mpf4279x_fg_iteration(buf) == 0xAABBCCDDu);
+  CHECK(mpf4279x_fg_iteration(buf) == fg.iteration);
+  CHECK(fg.emty_id == 7 && fg.full_id == 3);
+  CHECK(fg.pdis_id == 5 && fg.pdis_lim == Pack);
+  CHECK(fg.pchg_id == 9 && fg.pchg_lim == EXPECT_PCHG_LIM);
+#ifdef FG_NewGen
+  CHECK(mpf4279x_fg_intr(buf) == 0x2A0C5u);
+  CHECK(fg.intr.iteration == 1 && fg.intr.status == 0 && fg.intr.emty_lim == 1);
+  CHECK(fg.intr.OT_warn == 0 && fg.intr.idis_avg == 1 && fg.intr.idis_end == 1);
+  CHECK(fg.intr.vchg_cv == 0 && fg.intr.hconv == 1 && fg.intr.pchg_lim == 1);
+  CHECK(mpf4279x_fg_emty_dT(buf) == -35);
+  CHECK(mpf4279x_fg_emty_dT(buf) == fg.emty_dT);
+  CHECK(mpf4279x_fg_full_dT(buf) == -120);
+  CHECK(mpf4279x_fg_full_dT(buf) == fg.full_dT);
+  CHECK(fg.full_rtime_cc == 48000 && fg.full_dT_cc == -64);
+  check_learning(buf, FG_OFF_IDIS_AVG, 1500, Ongoing, Updated);
+  check_learning(buf, FG_OFF_IDIS_END, 300, Paused, Default);
+  check_learning(buf, FG_OFF_ICHG_CC, 2000, Ongoing, Updated2Max);
+  check_learning(buf, FG_OFF_ICHG_END, 100, Disabled, Updated2Min);
+  check_learning(buf, FG_OFF_VCHG_CV, 3650, Ongoing, Updated);
+  CHECK(fg.idis_avg == 1500 && fg.vchg_cv == 3650 && fg.vchg_cv_rslt == Updated);
+  for (i = 0; i < SETMAX_NCELLS_SER; i++) {
+    /* n/1024 is exact in binary, so the floats compare exactly */
+    CHECK(mpf4279x_fg_soresr_dis(buf, i) == (float)(12 + i) / 1024.0f);
+    CHECK(mpf4279x_fg_soresr_dis(buf, i) == fg.soresr_dis_cells[i]);
+    CHECK(mpf4279x_fg_soresr_chg(buf, i) == -(float)(20 + i) / 1024.0f);
+    CHECK(mpf4279x_fg_soresr_chg(buf, i) == fg.soresr_chg_cells[i]);
+    CHECK(mpf4279x_fg_rcxn(buf, i) == 250 + 3 * i);
+    CHECK(mpf4279x_fg_rcxn(buf, i) == fg.rcxn_cells[i]);
+    CHECK(fg.soresr_lrn_cells[i] == i % 3 && fg.soresr_rslt_cells[i] == i % 4);
+    CHECK(fg.rcxn_lrn_cells[i] == (i + 1) % 3 && fg.rcxn_rslt_cells[i] == (i + 1) % 4);
+  }
+  CHECK(mpf4279x_fg_hconv(buf) == 1234);
+  CHECK(mpf4279x_fg_hconv(buf) == fg.hconv);
+  CHECK(fg.hconv_lrn == Ongoing && fg.hconv_rslt == Updated);
+  CHECK(mpf4279x_fg_ot_warn(buf) == 0x050Bu);
+  CHECK(fg.OT_warn.id == 11);
+  CHECK(fg.OT_warn.chg_cc == 1 && fg.OT_warn.chg_end == 0 && fg.OT_warn.dis == 1);
+#endif
+}
+
+int main(void)
+{
+  uint8_t shifted[FG_OUT_SIZE + 1];
+
+  check_meas_frame(measFrame);
+  check_fg_frame(fgFrame);
+
+  /* DMA buffers may start anywhere */
+  memcpy(shifted + 1, measFrame, sizeof(measFrame));
+  check_meas_frame(shifted + 1);
+  memcpy(shifted + 1, fgFrame, sizeof(fgFrame));
+  check_fg_frame(shifted + 1);
+
+#ifdef FG_NewGen
+  printf("new generation layout, %u/%u byte frames: ", (unsigned)MEAS_REG_SIZE, (unsigned)FG_OUT_SIZE);
+#else
+  printf("layout, %u/%u byte frames: ", (unsigned)MEAS_REG_SIZE, (unsigned)FG_OUT_SIZE);
+#endif
+  printf("%s\n", failures == 0 ? "pass" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
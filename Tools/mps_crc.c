@@ -17,8 +17,10 @@
 **/
 
 #include "mps_crc.h"
+#ifndef MPS_CRC_HOST
 #include "n32h47x_48x_crc.h"  // 添加CRC硬件功能相关的头文件
 #include "n32h47x_48x_rcc.h"  // 添加RCC时钟控制相关的头文件
+#endif
 
 /**
 *\*\name    Calculate_CRC32.
@@ -162,6 +164,7 @@ uint8_t Calculate_CRC8(uint16_t reg_addr, uint8_t length, uint8_t* data)
 
 
 
+#ifndef MPS_CRC_HOST
 /**
 *\*\name    Calculate_CRC32_HW.
 *\*\fun     Calculate CRC32 using hardware CRC unit.
@@ -203,4 +206,4 @@ uint32_t Calculate_CRC32_HW(uint16_t reg_addr, uint8_t length, uint8_t* data)
     
     return crc32Value;
 }
-
+#endif /* MPS_CRC_HOST */
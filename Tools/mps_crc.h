@@ -19,7 +19,11 @@
 #ifndef __MPS_CRC_H__
 #define __MPS_CRC_H__
 
+#ifdef MPS_CRC_HOST
+#include <stdint.h>   /* Host build: software CRC only */
+#else
 #include "main.h"
+#endif
 
 /** CRC Configuration **/
 /* CRC-32 Configuration */
@@ -42,7 +46,9 @@
 
 /* CRC Function Declarations */
 uint32_t Calculate_CRC32(uint16_t reg_addr, uint8_t length, uint8_t* data);
+#ifndef MPS_CRC_HOST
 uint32_t Calculate_CRC32_HW(uint16_t reg_addr, uint8_t length, uint8_t* data);
+#endif
 uint16_t Calculate_CRC16(uint16_t reg_addr, uint8_t length, uint8_t* data);
 uint8_t Calculate_CRC8(uint16_t reg_addr, uint8_t length, uint8_t* data);
 
@@ -0,0 +1,176 @@
+/**
+*\*\file ring_stress.c
+*\*\brief Host stress test of the lock-free SPSC ring (N32H474/mps_ring.c)
+*
+* A producer thread and a consumer thread move a known byte sequence through
+* a small ring as fast as they can, each side alternating between the copy
+* and the zero-copy (peek/commit) calls with random chunk sizes. The consumer
+* checks every byte, so any lost, duplicated or torn update shows up as a
+* sequence error. The free-running indices start just below 2^32 to cover
+* their wrap as well. A side that finds the ring full or empty yields, so the
+* test also makes progress on a single core.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -I../N32H474 ring_stress.c ../N32H474/mps_ring.c -o ring_stress -lpthread
+*
+* Usage:
+*   ring_stress [megabytes] [ringSize]       default 64 MB through a 64 byte ring
+**/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mps_ring.h"
+
+static mps_ring_t ring;
+static uint64_t total;
+static volatile int failed = 0;
+
+/* Byte n of the test sequence, not periodic in the ring size */
+static uint8_t sequence_byte(uint64_t n)
+{
+  return (uint8_t)((n * 2654435761u) >> 13);
+}
+
+/* Per-thread xorshift, no shared state between the two sides */
+static uint32_t next_random(uint32_t* state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static void* producer(void* arg)
+{
+  uint32_t seed = 0x12345678u;
+  uint64_t sent = 0;
+  uint8_t chunk[256];
+
+  (void)arg;
+  while (sent < total && !failed) {
+    uint32_t want = 1 + next_random(&seed) % (ring.size + ring.size / 2);
+    uint32_t i;
+
+    if (want > total - sent) {
+      want = (uint32_t)(total - sent);
+    }
+    if (next_random(&seed) & 1) {
+      uint32_t done;
+
+      if (want > sizeof(chunk)) {
+        want = sizeof(chunk);
+      }
+      for (i = 0; i < want; i++) {
+        chunk[i] = sequence_byte(sent + i);
+      }
+      done = ring_write(&ring, chunk, want);
+      sent += done;
+      if (done == 0) {
+        sched_yield();
+      }
+    } else {
+      uint32_t span;
+      uint8_t* dst = ring_write_peek(&ring, &span);
+
+      if (span > want) {
+        span = want;
+      }
+      for (i = 0; i < span; i++) {
+        dst[i] = sequence_byte(sent + i);
+      }
+      ring_write_commit(&ring, span);
+      sent += span;
+      if (span == 0) {
+        sched_yield();
+      }
+    }
+  }
+  return NULL;
+}
+
+static void* consumer(void* arg)
+{
+  uint32_t seed = 0x9E3779B9u;
+  uint64_t received = 0;
+  uint8_t chunk[256];
+
+  (void)arg;
+  while (received < total && !failed) {
+    uint32_t want = 1 + next_random(&seed) % (ring.size + ring.size / 2);
+    const uint8_t* src;
+    uint32_t got;
+    uint32_t i;
+    bool peek = (next_random(&seed) & 1) != 0;
+
+    if (peek) {
+      src = ring_read_peek(&ring, &got);
+      if (got > want) {
+        got = want;
+      }
+    } else {
+      if (want > sizeof(chunk)) {
+        want = sizeof(chunk);
+      }
+      got = ring_read(&ring, chunk, want);
+      src = chunk;
+    }
+    for (i = 0; i < got; i++) {
+      if (src[i] != sequence_byte(received + i)) {
+        printf("FAIL: byte %llu is 0x%02X, expected 0x%02X\n",
+               (unsigned long long)(received + i), src[i], sequence_byte(received + i));
+        failed = 1;
+        return NULL;
+      }
+    }
+    if (peek) {
+      ring_read_commit(&ring, got);
+    }
+    received += got;
+    if (got == 0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t size = 64;
+  uint8_t* storage;
+  pthread_t tx;
+  pthread_t rx;
+
+  total = 64ull << 20;
+  if (argc > 1) {
+    total = strtoull(argv[1], NULL, 0) << 20;
+  }
+  if (argc > 2) {
+    size = (uint32_t)strtoul(argv[2], NULL, 0);
+  }
+  storage = malloc(size);
+  if (storage == NULL || !ring_init(&ring, storage, size)) {
+    printf("ring size must be a power of two\n");
+    return 2;
+  }
+
+  /* Start close to the 2^32 wrap of the free-running indices */
+  ring.head = 0xFFFFFF00u;
+  ring.tail = 0xFFFFFF00u;
+
+  pthread_create(&tx, NULL, producer, NULL);
+  pthread_create(&rx, NULL, consumer, NULL);
+  pthread_join(tx, NULL);
+  pthread_join(rx, NULL);
+
+  printf("%llu MB through a %u byte ring: %s\n",
+         (unsigned long long)(total >> 20), (unsigned)size, failed ? "FAIL" : "pass");
+  free(storage);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/**
+*\*\file swtimer_sim.c
+*\*\brief Host simulation of the software timer wheel (N32H474/mps_swtimer.c)
+*
+* Drives the wheel with simulated time and random start, restart and stop
+* operations, and checks every callBack against a reference model: each
+* expiry must run exactly at its tick, once, and stopped timers must stay
+* quiet. Delays reach past the wheel range to exercise parking and
+* re-cascading, callBacks restart and stop other timers, and the wheel time
+* crosses the 2^32 wrap. Runs once with a fixed-rate tick and once tickless,
+* where a simulated hardware timer honours the requested schedule.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -I../N32H474 swtimer_sim.c ../N32H474/mps_swtimer.c -o swtimer_sim
+*
+* Usage:
+*   swtimer_sim [operations] [seed]           default 2000000 operations, seed 1
+**/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mps_swtimer.h"
+
+#define TIMERS        64
+
+typedef struct {
+  swtimer_t timer;
+  int index;
+  int running;                  /* Reference model: expected to fire */
+  uint32_t expected;            /* Next expiry tick */
+  uint32_t period;
+} sim_timer_t;
+
+static sim_timer_t timers[TIMERS];
+static uint32_t rng;
+static unsigned long errors = 0;
+static unsigned long expiries = 0;
+
+/* Simulated tickless hardware */
+static uint32_t hwPending;      /* Ticks since the last advance */
+static uint32_t hwScheduled;    /* Requested advance point */
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void report(const sim_timer_t* t, const char* what)
+{
+  if (errors < 10) {
+    printf("FAIL timer %d: %s (now %lu, expected %lu)\n", t->index, what,
+           (unsigned long)swtimer_now(), (unsigned long)t->expected);
+  }
+  errors++;
+}
+
+/* Random delay: mostly short, sometimes across levels or beyond the wheel */
+static uint32_t random_delay(void)
+{
+  switch (next_random() % 8) {
+    case 0:  return next_random() % (3 * SWTIMER_RANGE);
+    case 1:
+    case 2:  return next_random() % (1u << 18);
+    default: return next_random() % 200;
+  }
+}
+
+static void sim_start(sim_timer_t* t);
+
+static void on_expiry(void* ctx)
+{
+  sim_timer_t* t = (sim_timer_t*)ctx;
+  sim_timer_t* other = &timers[next_random() % TIMERS];
+
+  expiries++;
+  if (!t->running) {
+    report(t, "fired while stopped");
+    return;
+  }
+  if (swtimer_now() != t->expected) {
+    report(t, "fired at the wrong tick");
+  }
+  if (t->period != 0) {
+    t->expected += t->period;
+  } else {
+    t->running = 0;
+  }
+
+  /* Timers are also started and stopped from callBacks */
+  switch (next_random() % 16) {
+    case 0:
+      swtimer_stop(&other->timer);
+      other->running = 0;
+      break;
+    case 1:
+      sim_start(other);
+      break;
+    case 2:
+      swtimer_stop(&t->timer);
+      t->running = 0;
+      break;
+    default:
+      break;
+  }
+}
+
+static void sim_start(sim_timer_t* t)
+{
+  uint32_t delay = random_delay();
+  uint32_t period = (next_random() % 3 == 0) ? 1 + next_random() % 5000 : 0;
+
+  swtimer_start(&t->timer, delay, period, on_expiry, t);
+  t->running = 1;
+  t->expected = swtimer_now() + (delay == 0 ? 1 : delay);
+  t->period = period;
+}
+
+/* Every timer due by now must have fired */
+static void check_overdue(void)
+{
+  uint32_t now = swtimer_now();
+  int i;
+
+  for (i = 0; i < TIMERS; i++) {
+    if (timers[i].running && (int32_t)(now - timers[i].expected) >= 0) {
+      report(&timers[i], "missed its expiry");
+      timers[i].running = 0;
+      swtimer_stop(&timers[i].timer);
+    }
+    if (timers[i].running != (int)swtimer_active(&timers[i].timer)) {
+      report(&timers[i], "active state differs from the model");
+      timers[i].running = swtimer_active(&timers[i].timer);
+    }
+  }
+}
+
+static uint32_t hw_pending(void)
+{
+  return hwPending;
+}
+
+static void hw_schedule(uint32_t ticks)
+{
+  hwScheduled = ticks;
+}
+
+static void run(int tickless, unsigned long operations)
+{
+  static const swtimer_hw_t hw = {hw_pending, hw_schedule};
+  unsigned long op;
+  int i;
+
+  swtimer_wheel_init(tickless ? &hw : NULL);
+  hwPending = 0;
+  hwScheduled = SWTIMER_RANGE;
+  for (i = 0; i < TIMERS; i++) {
+    timers[i].index = i;
+    timers[i].running = 0;
+    timers[i].timer.active = false;
+  }
+
+  /* Cross the 32-bit wrap of the wheel time early in the run */
+  swtimer_advance(0xFFFF0000u);
+
+  for (op = 0; op < operations; op++) {
+    sim_timer_t* t = &timers[next_random() % TIMERS];
+    uint32_t r = next_random() % 8;
+
+    if (r < 3) {
+      sim_start(t);
+    } else if (r == 3) {
+      swtimer_stop(&t->timer);
+      t->running = 0;
+    } else if (!tickless) {
+      swtimer_advance(1 + next_random() % ((r == 4) ? 100000 : 50));
+    } else {
+      /* Hardware counts some ticks, then fires at the scheduled point or earlier;
+         a point already passed (scheduled while ticks were pending) fires at once */
+      uint32_t elapsed = 1 + next_random() % 50;
+
+      if (hwPending >= hwScheduled) {
+        elapsed = 0;
+      } else if (hwPending + elapsed >= hwScheduled) {
+        elapsed = hwScheduled - hwPending;
+      }
+      hwPending += elapsed;
+      if (hwPending >= hwScheduled || next_random() % 4 == 0) {
+        uint32_t ticks = hwPending;
+
+        hwPending = 0;
+        swtimer_advance(ticks);
+      }
+    }
+    if (hwPending == 0) {
+      check_overdue();
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long operations = 2000000;
+
+  rng = 1;
+  if (argc > 1) {
+    operations = strtoul(argv[1], NULL, 0);
+  }
+  if (argc > 2) {
+    rng = (uint32_t)strtoul(argv[2], NULL, 0) | 1u;
+  }
+
+  run(0, operations);
+  printf("fixed tick: %lu expiries, %lu errors\n", expiries, errors);
+  expiries = 0;
+  run(1, operations);
+  printf("tickless:   %lu expiries, %lu errors\n", expiries, errors);
+
+  printf("%s\n", errors == 0 ? "pass" : "FAIL");
+  return errors == 0 ? 0 : 1;
+}
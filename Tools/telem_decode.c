@@ -0,0 +1,514 @@
+/**
+*\*\file telem_decode.c
+*\*\brief Host-side decoder and link analyzer for the firmware telemetry stream
+*
+* Reads COBS framed telemetry (see N32H474/mps_telemetry_proto.h) from a
+* serial device, a file or a pipe, validates the CRC16 with the shared CRC
+* code and reports frame/byte rates, CRC errors, sequence gaps and per-channel
+* latency histograms.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -DMPS_CRC_HOST -I. -I../N32H474 telem_decode.c mps_crc.c -o telem_decode -lpthread
+*
+* Usage:
+*   telem_decode -d /dev/ttyUSB0 -b 921600 [-c frames.csv] [-w capture.bin]
+*   telem_decode -f capture.bin                  decode a file as fast as possible
+*   telem_decode < capture.bin                   decode a pipe
+*   telem_decode -l capture.bin -b 921600        loopback: replay a capture paced at the baud rate
+**/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mps_crc.h"
+#include "mps_telemetry_proto.h"
+
+/* Latency histogram: bucket k counts latencies in [2^(k-1), 2^k) us, bucket 0 is < 1 us */
+#define LATENCY_BUCKETS     24
+
+/* Bits per byte on the wire for 8N1, used to pace loopback replay */
+#define BITS_PER_BYTE       10
+
+typedef struct {
+  uint64_t frames;
+  uint64_t latency[LATENCY_BUCKETS];
+  uint64_t latencyMax;
+} channel_stats_t;
+
+typedef struct {
+  uint64_t bytes;
+  uint64_t frames;
+  uint64_t crcErrors;
+  uint64_t cobsErrors;       /* Malformed or oversized blocks */
+  uint64_t seqGaps;          /* Gap events */
+  uint64_t framesLost;       /* Frames missing according to seq */
+  int haveSeq;
+  uint8_t lastSeq;
+  int haveOffset;
+  int64_t minOffset;         /* Smallest host - device time seen, latency baseline */
+  channel_stats_t channels[TELEM_TYPE_COUNT + 1];   /* Last entry: unknown types */
+} link_stats_t;
+
+static volatile sig_atomic_t stopRequested = 0;
+static const char* const typeNames[TELEM_TYPE_COUNT + 1] = { "adc", "meas", "hrpwm", "stats", "log", "other" };
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stopRequested = 1;
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint16_t rd_u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd_u32(const uint8_t* p) { return (uint32_t)rd_u16(p) | ((uint32_t)rd_u16(p + 2) << 16); }
+
+static speed_t baud_constant(unsigned baud)
+{
+  switch (baud)
+  {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default: return 0;
+  }
+}
+
+/**
+ * @brief Open a serial device in raw 8N1 mode
+ */
+static int open_serial(const char* path, unsigned baud)
+{
+  struct termios tio;
+  speed_t speed = baud_constant(baud);
+  int fd;
+
+  if (speed == 0)
+  {
+    fprintf(stderr, "unsupported baud rate %u\n", baud);
+    return -1;
+  }
+  fd = open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  if (tcgetattr(fd, &tio) != 0)
+  {
+    perror("tcgetattr");
+    close(fd);
+    return -1;
+  }
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  if (tcsetattr(fd, TCSANOW, &tio) != 0)
+  {
+    perror("tcsetattr");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Loopback replay: a thread writes the capture into a pipe at wire speed */
+typedef struct {
+  int fd;              /* Write end of the pipe */
+  FILE* capture;
+  unsigned baud;
+} replay_t;
+
+static void* replay_thread(void* arg)
+{
+  replay_t* replay = (replay_t*)arg;
+  uint8_t chunk[256];
+  uint64_t bytesPerSecond = replay->baud / BITS_PER_BYTE;
+  uint64_t start = now_us();
+  uint64_t sent = 0;
+  size_t n;
+
+  while (!stopRequested && (n = fread(chunk, 1, sizeof(chunk), replay->capture)) > 0)
+  {
+    uint64_t due;
+
+    if (write(replay->fd, chunk, n) != (ssize_t)n)
+    {
+      break;
+    }
+    sent += n;
+    /* Sleep until the link would have carried the bytes written so far */
+    due = start + sent * 1000000u / bytesPerSecond;
+    while (now_us() < due)
+    {
+      usleep(100);
+    }
+  }
+  close(replay->fd);
+  return NULL;
+}
+
+/**
+ * @brief Write the decoded payload values of one frame as CSV fields
+ */
+static void csv_payload(FILE* csv, uint8_t type, const uint8_t* p, int n)
+{
+  int i;
+
+  switch (type)
+  {
+    case TELEM_TYPE_ADC:
+      for (i = 1; i + 1 < n && (i - 1) / 2 < p[0]; i += 2)
+      {
+        fprintf(csv, ",%u", rd_u16(p + i));
+      }
+      break;
+    case TELEM_TYPE_MEAS:
+      if (n >= 1 && n >= 1 + 2 * p[0] + 2 + 4 + 2 * TELEM_MEAS_TEMPS + 4)
+      {
+        const uint8_t* q = p + 1;
+        for (i = 0; i < p[0]; i++, q += 2) fprintf(csv, ",%u", rd_u16(q));
+        fprintf(csv, ",%u", rd_u16(q)); q += 2;
+        fprintf(csv, ",%d", (int32_t)rd_u32(q)); q += 4;
+        for (i = 0; i < TELEM_MEAS_TEMPS; i++, q += 2) fprintf(csv, ",%d", (int16_t)rd_u16(q));
+        fprintf(csv, ",%d", (int16_t)rd_u16(q)); q += 2;
+        fprintf(csv, ",0x%04x", rd_u16(q));
+      }
+      break;
+    case TELEM_TYPE_HRPWM:
+      for (i = 0; i + TELEM_HRPWM_ENTRY_SIZE <= n; i += TELEM_HRPWM_ENTRY_SIZE)
+      {
+        fprintf(csv, ",%c,%u,%u,%u", 'A' + p[i], rd_u32(p + i + 1), rd_u32(p + i + 5), p[i + 9]);
+      }
+      break;
+    case TELEM_TYPE_STATS:
+      for (i = 0; i + 4 <= n; i += 4)
+      {
+        fprintf(csv, ",%u", rd_u32(p + i));
+      }
+      break;
+    default:
+      for (i = 0; i < n; i++)
+      {
+        fprintf(csv, ",%u", p[i]);
+      }
+      break;
+  }
+}
+
+/**
+ * @brief Validate and account one COBS block (without delimiter)
+ */
+static void handle_block(link_stats_t* st, const uint8_t* block, uint32_t length, uint64_t hostUs, FILE* csv)
+{
+  uint8_t frame[TELEM_MAX_FRAME];
+  channel_stats_t* ch;
+  uint32_t deviceUs;
+  uint16_t crc;
+  int64_t offset;
+  uint64_t latency;
+  uint8_t type;
+  uint8_t seq;
+  int n;
+  int k;
+
+  if (length == 0)
+  {
+    return;  /* Back-to-back delimiters */
+  }
+  if (length > TELEM_MAX_FRAME || (n = telem_cobs_decode(block, length, frame)) < TELEM_HEADER_SIZE + TELEM_CRC_SIZE)
+  {
+    st->cobsErrors++;
+    return;
+  }
+
+  type = frame[0];
+  seq = frame[1];
+  crc = Calculate_CRC16(((uint16_t)seq << 8) | type, (uint8_t)(n - 2 - TELEM_CRC_SIZE), &frame[2]);
+  if (crc != rd_u16(&frame[n - TELEM_CRC_SIZE]))
+  {
+    st->crcErrors++;
+    return;
+  }
+
+  st->frames++;
+  if (st->haveSeq && seq != (uint8_t)(st->lastSeq + 1))
+  {
+    st->seqGaps++;
+    st->framesLost += (uint8_t)(seq - st->lastSeq - 1);
+  }
+  st->haveSeq = 1;
+  st->lastSeq = seq;
+
+  /* Latency relative to the fastest frame seen: clocks are not synchronized,
+     so this measures queuing and transfer delay above the best case */
+  deviceUs = rd_u32(&frame[2]);
+  offset = (int64_t)hostUs - (int64_t)deviceUs;
+  if (!st->haveOffset || offset < st->minOffset)
+  {
+    st->minOffset = offset;
+    st->haveOffset = 1;
+  }
+  latency = (uint64_t)(offset - st->minOffset);
+
+  ch = &st->channels[type < TELEM_TYPE_COUNT ? type : TELEM_TYPE_COUNT];
+  ch->frames++;
+  for (k = 0; k < LATENCY_BUCKETS - 1 && (latency >> k) != 0; k++)
+  {
+  }
+  ch->latency[k]++;
+  if (latency > ch->latencyMax)
+  {
+    ch->latencyMax = latency;
+  }
+
+  if (csv != NULL)
+  {
+    fprintf(csv, "%llu,%s,%u,%u,%llu", (unsigned long long)hostUs,
+            typeNames[type < TELEM_TYPE_COUNT ? type : TELEM_TYPE_COUNT], seq, deviceUs,
+            (unsigned long long)latency);
+    csv_payload(csv, type, &frame[TELEM_HEADER_SIZE], n - TELEM_HEADER_SIZE - TELEM_CRC_SIZE);
+    fputc('\n', csv);
+  }
+}
+
+static void print_report(const link_stats_t* st, const link_stats_t* prev, double seconds, int final)
+{
+  int i;
+  int k;
+
+  fprintf(stderr, "%s frames %llu (%.1f/s)  bytes %llu (%.0f B/s)  crc %llu  cobs %llu  gaps %llu (lost %llu)\n",
+          final ? "[total]" : "[rate] ",
+          (unsigned long long)st->frames, (st->frames - prev->frames) / seconds,
+          (unsigned long long)st->bytes, (st->bytes - prev->bytes) / seconds,
+          (unsigned long long)st->crcErrors, (unsigned long long)st->cobsErrors,
+          (unsigned long long)st->seqGaps, (unsigned long long)st->framesLost);
+  if (!final)
+  {
+    return;
+  }
+  for (i = 0; i <= TELEM_TYPE_COUNT; i++)
+  {
+    const channel_stats_t* ch = &st->channels[i];
+    if (ch->frames == 0)
+    {
+      continue;
+    }
+    fprintf(stderr, "  %-6s frames %llu  latency max %llu us\n", typeNames[i],
+            (unsigned long long)ch->frames, (unsigned long long)ch->latencyMax);
+    for (k = 0; k < LATENCY_BUCKETS; k++)
+    {
+      if (ch->latency[k] != 0)
+      {
+        fprintf(stderr, "    < %8llu us : %llu\n", 1ULL << k, (unsigned long long)ch->latency[k]);
+      }
+    }
+  }
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-d device | -f file | -l capture] [-b baud] [-c out.csv] [-w capture.bin] [-i seconds]\n"
+          "  -d  serial device (raw 8N1)\n"
+          "  -f  read a file as fast as possible ('-' or no source: stdin)\n"
+          "  -l  loopback: replay a capture through a pipe paced at the baud rate\n"
+          "  -b  baud rate for -d and -l (default 921600)\n"
+          "  -c  write one CSV row per valid frame\n"
+          "  -w  record the raw input for later replay\n"
+          "  -i  rate report interval in seconds (default 1, 0 = final report only)\n",
+          prog);
+}
+
+int main(int argc, char** argv)
+{
+  const char* device = NULL;
+  const char* file = NULL;
+  const char* loopback = NULL;
+  const char* csvPath = NULL;
+  const char* recordPath = NULL;
+  unsigned baud = 921600;
+  double interval = 1.0;
+  FILE* csv = NULL;
+  FILE* record = NULL;
+  replay_t replay;
+  pthread_t replayThread;
+  int replaying = 0;
+  link_stats_t stats;
+  link_stats_t prev;
+  uint8_t block[TELEM_MAX_FRAME + 1];
+  uint32_t blockLength = 0;
+  int overlong = 0;
+  uint64_t start;
+  uint64_t lastReport;
+  int fd = STDIN_FILENO;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:f:l:b:c:w:i:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd': device = optarg; break;
+      case 'f': file = optarg; break;
+      case 'l': loopback = optarg; break;
+      case 'b': baud = (unsigned)strtoul(optarg, NULL, 0); break;
+      case 'c': csvPath = optarg; break;
+      case 'w': recordPath = optarg; break;
+      case 'i': interval = atof(optarg); break;
+      default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+    }
+  }
+
+  if (device != NULL)
+  {
+    fd = open_serial(device, baud);
+  }
+  else if (loopback != NULL)
+  {
+    int pipeFd[2];
+    if (baud < BITS_PER_BYTE || pipe(pipeFd) != 0 || (replay.capture = fopen(loopback, "rb")) == NULL)
+    {
+      perror(loopback);
+      return 1;
+    }
+    replay.fd = pipeFd[1];
+    replay.baud = baud;
+    fd = pipeFd[0];
+    pthread_create(&replayThread, NULL, replay_thread, &replay);
+    replaying = 1;
+  }
+  else if (file != NULL && strcmp(file, "-") != 0)
+  {
+    fd = open(file, O_RDONLY);
+    if (fd < 0)
+    {
+      perror(file);
+    }
+  }
+  if (fd < 0)
+  {
+    return 1;
+  }
+  if (csvPath != NULL && (csv = fopen(csvPath, "w")) == NULL)
+  {
+    perror(csvPath);
+    return 1;
+  }
+  if (recordPath != NULL && (record = fopen(recordPath, "wb")) == NULL)
+  {
+    perror(recordPath);
+    return 1;
+  }
+  if (csv != NULL)
+  {
+    fprintf(csv, "host_us,type,seq,device_us,latency_us,values...\n");
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGPIPE, SIG_IGN);
+  memset(&stats, 0, sizeof(stats));
+  prev = stats;
+  start = now_us();
+  lastReport = start;
+
+  while (!stopRequested)
+  {
+    uint8_t chunk[512];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    uint64_t t = now_us();
+    ssize_t i;
+
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      break;
+    }
+    stats.bytes += (uint64_t)n;
+    if (record != NULL)
+    {
+      fwrite(chunk, 1, (size_t)n, record);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      if (chunk[i] == TELEM_DELIMITER)
+      {
+        if (overlong)
+        {
+          stats.cobsErrors++;
+        }
+        else
+        {
+          handle_block(&stats, block, blockLength, t, csv);
+        }
+        blockLength = 0;
+        overlong = 0;
+      }
+      else if (blockLength < sizeof(block))
+      {
+        block[blockLength++] = chunk[i];
+      }
+      else
+      {
+        overlong = 1;
+      }
+    }
+
+    if (interval > 0 && (t - lastReport) >= interval * 1e6)
+    {
+      print_report(&stats, &prev, (t - lastReport) / 1e6, 0);
+      prev = stats;
+      lastReport = t;
+    }
+  }
+
+  {
+    double elapsed = (now_us() - start) / 1e6;
+    memset(&prev, 0, sizeof(prev));
+    print_report(&stats, &prev, elapsed > 0 ? elapsed : 1, 1);
+  }
+
+  if (replaying)
+  {
+    stopRequested = 1;
+    close(fd);
+    pthread_join(replayThread, NULL);
+    fclose(replay.capture);
+  }
+  if (csv != NULL) fclose(csv);
+  if (record != NULL) fclose(record);
+  return (stats.crcErrors || stats.cobsErrors) ? 3 : 0;
+}
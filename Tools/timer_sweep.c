@@ -0,0 +1,154 @@
+/**
+*\*\file timer_sweep.c
+*\*\brief Host sweep of the GTIM period solver (N32H474/mps_timer_solve.c)
+*
+* Solves periods from 1 us up to the largest one that fits, log spaced plus
+* random values, for a few timer clocks. Each result is checked against an
+* exhaustive search over all 65536 prescalers with the nearest reload: the
+* solver must find the same lowest error. Prints the worst and the mean period
+* error (absolute, in ppm) per clock, and the share of exactly hit periods.
+*
+* Build (Linux):
+*   gcc -O2 -Wall -I../N32H474 timer_sweep.c ../N32H474/mps_timer_solve.c -o timer_sweep
+*
+* Usage:
+*   timer_sweep [randomPeriods]                  default 2000 per clock
+**/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mps_timer.h"
+
+static const uint32_t clocks[] = {240000000u, 170666666u, 120000000u, 64000000u, 8000000u};
+
+static unsigned long failures = 0;
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+/* Lowest error in units of 1/1000000 clock, trying every prescaler */
+static uint64_t reference_error(uint32_t timerClock, uint32_t periodUs)
+{
+  uint64_t target = (uint64_t)periodUs * timerClock;
+  uint64_t best = UINT64_MAX;
+  uint32_t prescaler;
+
+  for (prescaler = 1; prescaler <= 65536; prescaler++) {
+    uint64_t step = (uint64_t)prescaler * 1000000ULL;
+    uint64_t reload = (target + step / 2) / step;
+    uint64_t error;
+
+    if (reload == 0) {
+      reload = 1;
+    }
+    if (reload > 65536) {
+      continue;
+    }
+    error = (reload * step > target) ? reload * step - target : target - reload * step;
+    if (error < best) {
+      best = error;
+    }
+  }
+  return best;
+}
+
+typedef struct {
+  unsigned long count;
+  unsigned long exact;
+  double sumPpm;
+  double worstPpm;
+  uint32_t worstPeriodUs;
+} sweep_stats_t;
+
+static void check(uint32_t timerClock, uint32_t periodUs, sweep_stats_t* stats)
+{
+  timer_period_t solved;
+  uint64_t target = (uint64_t)periodUs * timerClock;
+  uint64_t achieved;
+  uint64_t error;
+  uint64_t reference;
+  double ppm;
+  bool inRange = target >= 1000000ULL && target <= 65536ULL * 65536ULL * 1000000ULL;
+
+  if (timer_solve_period(timerClock, periodUs, &solved) != inRange) {
+    printf("FAIL %lu Hz, %lu us: range check\n", (unsigned long)timerClock, (unsigned long)periodUs);
+    failures++;
+    return;
+  }
+  if (!inRange) {
+    return;
+  }
+  if (solved.prescaler < 1 || solved.prescaler > 65536 || solved.reload < 1 || solved.reload > 65536) {
+    printf("FAIL %lu Hz, %lu us: prescaler %lu reload %lu out of range\n", (unsigned long)timerClock,
+           (unsigned long)periodUs, (unsigned long)solved.prescaler, (unsigned long)solved.reload);
+    failures++;
+    return;
+  }
+
+  achieved = (uint64_t)solved.prescaler * solved.reload * 1000000ULL;
+  error = (achieved > target) ? achieved - target : target - achieved;
+  reference = reference_error(timerClock, periodUs);
+  if (error != reference) {
+    if (failures < 10) {
+      printf("FAIL %lu Hz, %lu us: error %.3f clocks, best is %.3f\n", (unsigned long)timerClock,
+             (unsigned long)periodUs, error / 1e6, reference / 1e6);
+    }
+    failures++;
+  }
+
+  stats->count++;
+  stats->exact += (error == 0);
+  ppm = error * 1e6 / target;
+  stats->sumPpm += ppm;
+  if (ppm > stats->worstPpm) {
+    stats->worstPpm = ppm;
+    stats->worstPeriodUs = periodUs;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long randomPeriods = 2000;
+  unsigned long i;
+  size_t c;
+
+  if (argc > 1) {
+    randomPeriods = strtoul(argv[1], NULL, 0);
+  }
+
+  printf("%10s %8s %8s %10s %10s %12s\n", "clock Hz", "periods", "exact", "mean ppm", "worst ppm", "at us");
+  for (c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+    uint32_t timerClock = clocks[c];
+    uint64_t maxUs = 65536ULL * 65536ULL * 1000000ULL / timerClock;
+    sweep_stats_t stats = {0};
+    double periodUs;
+
+    if (maxUs > UINT32_MAX) {
+      maxUs = UINT32_MAX;
+    }
+    /* Log spaced, about 40 points per decade */
+    for (periodUs = 1.0; periodUs <= (double)maxUs; periodUs *= 1.06) {
+      check(timerClock, (uint32_t)periodUs, &stats);
+    }
+    for (i = 0; i < randomPeriods; i++) {
+      /* Uniform in the exponent, so short periods are covered as well */
+      uint32_t bits = 1 + next_random() % 32;
+      uint32_t periodUs32 = next_random() & (uint32_t)((1ULL << bits) - 1);
+
+      check(timerClock, (uint32_t)(1 + periodUs32 % maxUs), &stats);
+    }
+    printf("%10lu %8lu %7.1f%% %10.4f %10.4f %12lu\n", (unsigned long)timerClock, stats.count,
+           100.0 * stats.exact / stats.count, stats.sumPpm / stats.count, stats.worstPpm,
+           (unsigned long)stats.worstPeriodUs);
+  }
+
+  printf("%s\n", failures == 0 ? "pass" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}